@@ -0,0 +1,171 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+#include <SFML/System.hpp>
+
+#include "BenchmarkState.hpp"
+#include "PhysicsBackend.hpp"
+#include "Egg.hpp"
+
+// rays straight down on a grid across the level
+static std::vector<RayQuery> gridRays(const glm::vec2& lower, const glm::vec2& upper) {
+    std::vector<RayQuery> rays;
+    for(float x = lower.x; x <= upper.x; x += 0.5f) {
+        RayQuery ray;
+        ray.from = btVector3(x, lower.y - 1, 0);
+        ray.to = btVector3(x, upper.y + 1, 0);
+        rays.push_back(ray);
+    }
+    return rays;
+}
+
+// an egg that counts how often it starts touching the level
+class ProbeEgg : public Egg {
+public:
+    int begins = 0;
+
+    void onAdd(State* state) override {
+        Egg::onAdd(state);
+        setContactEvents(EntityCollision::BEGIN);
+    }
+
+    bool onCollide(Entity* other, const EntityCollision& c) override {
+        if(other->getTypeFlag() == TYPE_COLLISION_SHAPE) begins++;
+        return false;
+    }
+};
+
+// Drops one egg into an empty 4x4 box and checks what gameplay relies on.
+// Prints the failed checks and returns their number.
+static int behaviourChecks(PhysicsBackend::Type backend) {
+    PhysicsBackend::type = backend;
+
+    BenchmarkState state;
+    state.init();
+    state.buildArena(4, 4);
+
+    auto egg = std::make_shared<ProbeEgg>();
+    state.add(egg);
+    egg->setPhysicsPosition(glm::vec2(2, 2));
+
+    for(int i = 0; i < 300; ++i) {
+        state.step(1);
+        state.updateContacts();
+        state.dispatchContactEvents();
+    }
+
+    int failed = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        if(ok) return;
+        std::cout << "  " << PhysicsBackend::name(backend) << ": " << what << std::endl;
+        failed++;
+    };
+
+    check(egg->begins == 1, "the egg should start touching the floor exactly once, not " + std::to_string(egg->begins) + " times");
+    check(egg->physicsBody()->linearVelocity().length() < 0.1 && egg->position().y > 3 && egg->position().y < 4,
+          "the egg should rest on the floor");
+
+    std::shared_ptr<btCollisionShape> ghostShape = std::make_shared<btSphereShape>(0.35);
+    PhysicsGhost* ghost = state.physics()->createGhost(ghostShape.get());
+    ghost->setTransform(btTransform(btQuaternion::getIdentity(), btVector3(1, 3.8, 0)));
+    state.physics()->addGhost(ghost);
+    state.step(1);
+    int ghostContacts = 0;
+    state.visitGhostContacts(ghost, Entity::TYPE_COLLISION_SHAPE, [&](const EntityCollision& c) {
+        ghostContacts++;
+    });
+    check(ghostContacts > 0, "a ghost touching the floor should find it");
+    state.physics()->removeGhost(ghost);
+    delete ghost;
+
+    RayQuery ray;
+    ray.from = btVector3(0.5, 1, 0);
+    ray.to = btVector3(0.5, 5, 0);
+    state.rayTestBatch(&ray, 1);
+    check(ray.hit && fabs(ray.hitFraction - 0.75) < 0.01, "a ray down to the floor should hit it at 3/4 of its length");
+
+    return failed;
+}
+
+// Runs the same scenes with every physics backend, compares their step cost
+// and checks that they behave alike: leg rays hit the level at the same
+// places, and no more eggs drop out of the level than with the reference.
+// A small scene checks resting bodies, contact events, ghosts and rays on
+// each backend. Returns 1 if a check fails. Usage: backends [eggs] [level...]
+int backendsBenchmark(const std::vector<std::string>& args) {
+    int eggs = args.size() > 0 ? std::stoi(args[0]) : 100;
+    std::vector<std::string> levels = benchmarkLevels();
+    if(args.size() > 1) {
+        levels.assign(args.begin() + 1, args.end());
+    }
+
+    const int frames = 600;
+    const std::vector<PhysicsBackend::Type> backends = {PhysicsBackend::BULLET, PhysicsBackend::NATIVE_2D};
+    bool ok = true;
+
+    std::cout << "behaviour checks:" << std::endl;
+    for(auto backend : backends) {
+        if(behaviourChecks(backend) > 0) ok = false;
+    }
+    std::cout << std::endl;
+
+    std::cout << std::left << std::setw(14) << "level" << std::setw(12) << "backend" << std::setw(12) << "us/frame"
+              << std::setw(10) << "resting" << std::setw(10) << "fallen" << "ray mismatches" << std::endl;
+
+    for(auto level : levels) {
+        std::vector<RayQuery> referenceRays;
+        int referenceFallen = 0;
+
+        for(auto backend : backends) {
+            PhysicsBackend::type = backend;
+
+            BenchmarkState state;
+            state.init();
+            state.loadFromFile("levels/" + level + ".dat");
+
+            glm::vec2 lower, upper;
+            state.getLevelBounds(lower, upper);
+            std::vector<RayQuery> rays = gridRays(lower, upper);
+            state.rayTestBatch(rays.data(), rays.size());
+
+            state.spawnEggs(eggs);
+            sf::Clock clock;
+            state.step(frames);
+            int time = clock.getElapsedTime().asMicroseconds() / frames;
+
+            int resting = 0, fallen = 0;
+            for(auto egg : state.getEntitiesByType<Egg>("Egg")) {
+                glm::vec2 p = egg->position();
+                if(p.x < lower.x - 1 || p.x > upper.x + 1 || p.y < lower.y - 1 || p.y > upper.y + 1) {
+                    fallen++;
+                } else if(egg->physicsBody()->linearVelocity().length() < 0.1) {
+                    resting++;
+                }
+            }
+
+            int mismatches = 0;
+            if(backend == PhysicsBackend::BULLET) {
+                referenceRays = rays;
+                referenceFallen = fallen;
+            } else {
+                for(unsigned int i = 0; i < rays.size(); ++i) {
+                    if(rays[i].hit != referenceRays[i].hit || fabs(rays[i].hitFraction - referenceRays[i].hitFraction) > 0.01) {
+                        mismatches++;
+                    }
+                }
+                if(mismatches > 0 || fallen > referenceFallen) ok = false;
+            }
+
+            std::cout << std::left << std::setw(14) << level << std::setw(12) << PhysicsBackend::name(backend)
+                      << std::setw(12) << time << std::setw(10) << resting << std::setw(10) << fallen
+                      << mismatches << std::endl;
+        }
+    }
+
+    PhysicsBackend::type = PhysicsBackend::BULLET;
+    std::cout << (ok ? "All backends behave alike." : "Backends behave differently.") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#include "BenchmarkState.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "CollisionShape.hpp"
+#include "Egg.hpp"
+#include "Toy.hpp"
+#include "Wall.hpp"
+#include "Pair.hpp"
+#include "Marker.hpp"
+
+#include <SFML/System.hpp>
+
+BenchmarkState::BenchmarkState() {
+    m_zoom = 6;
+}
+
+void BenchmarkState::buildArena(float width, float height) {
+    for(auto entity : m_entities) {
+        removeFromWorld(entity);
+    }
+    m_entities.clear();
+    clearContacts();
+
+    // four walls rather than one box around the inside, which would be
+    // solid with convex pieces
+    float t = 1.f;
+    auto arena = std::make_shared<CollisionShape>();
+    arena->shapes().push_back({glm::vec2(-t, -t), glm::vec2(width + t, -t), glm::vec2(width + t, 0), glm::vec2(-t, 0)});
+    arena->shapes().push_back({glm::vec2(-t, height), glm::vec2(width + t, height), glm::vec2(width + t, height + t), glm::vec2(-t, height + t)});
+    arena->shapes().push_back({glm::vec2(-t, 0), glm::vec2(0, 0), glm::vec2(0, height), glm::vec2(-t, height)});
+    arena->shapes().push_back({glm::vec2(width, 0), glm::vec2(width + t, 0), glm::vec2(width + t, height), glm::vec2(width, height)});
+
+    // pegs in the lower half, offset every other row
+    for(float y = height * 0.5f; y < height - 2; y += 3) {
+        float shift = fmod(y, 6) < 3 ? 0 : 1.5f;
+        for(float x = 2 + shift; x < width - 2; x += 3) {
+            arena->shapes().push_back({
+                glm::vec2(x - 0.3f, y + 0.3f), glm::vec2(x, y - 0.3f), glm::vec2(x + 0.3f, y + 0.3f)
+            });
+        }
+    }
+    add(arena);
+}
+
+void BenchmarkState::spawnEggs(int count) {
+    spawnGrid(count, [](int i) -> std::shared_ptr<Entity> {
+        return std::make_shared<Egg>();
+    });
+}
+
+void BenchmarkState::spawnEggsAndToys(int count) {
+    spawnGrid(count, [](int i) -> std::shared_ptr<Entity> {
+        if(i % 2) return std::make_shared<Toy>();
+        return std::make_shared<Egg>();
+    });
+}
+
+// bodies keep at least this distance from the level geometry when spawned
+static const float SPAWN_CLEARANCE = 0.5f;
+// finest spawn grid tried before giving up on free positions
+static const int MAX_SPAWN_COLUMNS = 1024;
+
+static bool insidePolygon(const glm::vec2& p, const std::vector<glm::vec2>& polygon) {
+    bool inside = false;
+    for(unsigned int i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const glm::vec2& a = polygon[i];
+        const glm::vec2& b = polygon[j];
+        if((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+static float distanceToPolygon(const glm::vec2& p, const std::vector<glm::vec2>& polygon) {
+    float distance = INFINITY;
+    for(unsigned int i = 0; i < polygon.size(); ++i) {
+        const glm::vec2& a = polygon[i];
+        const glm::vec2& b = polygon[(i + 1) % polygon.size()];
+        glm::vec2 d = b - a;
+        float t = glm::dot(d, d) > 0 ? glm::clamp(glm::dot(p - a, d) / glm::dot(d, d), 0.f, 1.f) : 0.f;
+        distance = std::min(distance, glm::length(a + d * t - p));
+    }
+    return distance;
+}
+
+void BenchmarkState::spawnGrid(int count, std::function<std::shared_ptr<Entity>(int)> create) {
+    glm::vec2 lower, upper;
+    getLevelBounds(lower, upper);
+
+    // level polygons in world space
+    std::vector<std::vector<glm::vec2>> polygons;
+    for(auto shape : getEntitiesByType<CollisionShape>("CollisionShape")) {
+        for(auto& points : shape->shapes()) {
+            if(points.size() < 2) continue;
+            std::vector<glm::vec2> polygon;
+            for(auto p : points) polygon.push_back(shape->transformToGlobal(p));
+            polygons.push_back(polygon);
+        }
+    }
+
+    // Convex pieces are solid, so bodies spawned inside polygons would start
+    // deep inside the rock. Such positions are skipped for every cooking, so
+    // all of them get the same bodies; the grid gets finer until there is
+    // room for everything.
+    std::vector<glm::vec2> positions;
+    for(int columns = std::max(1, (int)ceil(sqrt(count))); (int)positions.size() < count && columns <= MAX_SPAWN_COLUMNS; columns *= 2) {
+        positions.clear();
+        glm::vec2 spacing = (upper - lower) / (float)(columns + 1);
+        for(int i = 0; i < columns * columns && (int)positions.size() < count; ++i) {
+            glm::vec2 p = lower + spacing * glm::vec2(1 + i % columns, 1 + i / columns);
+            bool free = true;
+            for(auto& polygon : polygons) {
+                if(insidePolygon(p, polygon) || distanceToPolygon(p, polygon) < SPAWN_CLEARANCE) {
+                    free = false;
+                    break;
+                }
+            }
+            if(free) positions.push_back(p);
+        }
+    }
+    if((int)positions.size() < count) {
+        std::cerr << "Warning: only room for " << positions.size() << " of " << count << " bodies." << std::endl;
+    }
+
+    for(unsigned int i = 0; i < positions.size(); ++i) {
+        auto entity = create(i);
+        add(entity);
+        entity->setPhysicsPosition(positions[i]);
+        entity->setScale(glm::vec2(0.5, 0.5));
+    }
+}
+
+void BenchmarkState::step(int frames, float dt) {
+    for(int i = 0; i < frames; ++i) {
+        m_physics->step(dt, 1, dt);
+    }
+}
+
+void BenchmarkState::loadTimed(const std::vector<std::shared_ptr<Entity>>& entities, long long& cookTime, long long& registerTime) {
+    // an empty level resets the world
+    loadEntities({}, "synthetic");
+    m_entities = entities;
+
+    sf::Clock clock;
+    std::vector<btVector3> inertias;
+    cookEntities(m_entities, inertias);
+    cookTime = clock.restart().asMicroseconds();
+
+    for(unsigned int i = 0; i < m_entities.size(); ++i) {
+        registerEntity(m_entities[i], inertias[i]);
+        m_entities[i]->handleAddedToState(this);
+    }
+    registerTime = clock.getElapsedTime().asMicroseconds();
+}
+
+std::vector<std::string> benchmarkLevels() {
+    return {"spawn", "pairs", "jump-1", "jump-2", "walls", "upside-down"};
+}
+
+std::vector<std::shared_ptr<Entity>> syntheticLevel(int count, int polygonPoints) {
+    static const std::vector<std::string> wallTypes = {"box", "platform-1", "platform-2"};
+
+    std::vector<std::shared_ptr<Entity>> entities;
+    int columns = std::max(1, (int)sqrt(count));
+    for(int i = 0; i < count; ++i) {
+        std::shared_ptr<Entity> entity;
+        if(i == 0 || i == 1) {
+            auto marker = std::make_shared<Marker>();
+            marker->setType(i == 0 ? Marker::SPAWN : Marker::GOAL);
+            entity = marker;
+        } else if(i % 10 < 4) {
+            auto wall = std::make_shared<Wall>();
+            wall->setType(wallTypes[i % wallTypes.size()]);
+            entity = wall;
+        } else if(i % 10 < 6) {
+            auto pair = std::make_shared<Pair>();
+            pair->setType(1 + i % 3);
+            entity = pair;
+        } else if(i % 10 < 9) {
+            // a bumpy ring, so no two neighbouring edges are collinear
+            auto shape = std::make_shared<CollisionShape>();
+            std::vector<glm::vec2> points;
+            for(int p = 0; p < polygonPoints; ++p) {
+                float angle = 2 * M_PI * p / polygonPoints;
+                float radius = p % 2 ? 1.f : 0.8f;
+                points.push_back(glm::vec2(cos(angle), sin(angle)) * radius);
+            }
+            shape->shapes().push_back(points);
+            entity = shape;
+        } else {
+            auto marker = std::make_shared<Marker>();
+            marker->setType(Marker::HELP_TRIGGER);
+            entity = marker;
+        }
+
+        entity->setPosition(glm::vec2(i % columns, i / columns) * 3.f);
+        entities.push_back(entity);
+    }
+    return entities;
+}
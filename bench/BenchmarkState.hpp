@@ -0,0 +1,43 @@
+#ifndef BENCHMARKSTATE_HPP
+#define BENCHMARKSTATE_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "State.hpp"
+
+// A headless state for loading levels and stepping the physics world
+class BenchmarkState : public State {
+public:
+    BenchmarkState();
+
+    // replaces the level with a closed box of the given size, with rows of
+    // pegs inside so falling bodies keep colliding with the level
+    void buildArena(float width, float height);
+
+    // drops count eggs on a grid over the level bounds, leaving out
+    // positions inside or close to the level polygons
+    void spawnEggs(int count);
+    // same, alternating between eggs and toys
+    void spawnEggsAndToys(int count);
+
+    void step(int frames, float dt = 1.f / 60.f);
+
+    // Loads freshly read entities like loadEntities() does, timing the two
+    // phases separately (in microseconds).
+    void loadTimed(const std::vector<std::shared_ptr<Entity>>& entities, long long& cookTime, long long& registerTime);
+
+private:
+    void spawnGrid(int count, std::function<std::shared_ptr<Entity>(int)> create);
+};
+
+// names of the levels shipped in levels/
+std::vector<std::string> benchmarkLevels();
+
+// A level of count entities on a grid: walls, pairs, help markers and
+// collision shapes with polygonPoints points each, plus one spawn and one
+// goal marker.
+std::vector<std::shared_ptr<Entity>> syntheticLevel(int count, int polygonPoints);
+
+#endif
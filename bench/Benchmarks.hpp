@@ -0,0 +1,17 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include <string>
+#include <vector>
+
+// Every benchmark gets the command line arguments following its name and
+// returns the process exit code.
+int collisionBenchmark(const std::vector<std::string>& args);
+int threadsBenchmark(const std::vector<std::string>& args);
+int backendsBenchmark(const std::vector<std::string>& args);
+int broadphaseBenchmark(const std::vector<std::string>& args);
+int reloadBenchmark(const std::vector<std::string>& args);
+int loadBenchmark(const std::vector<std::string>& args);
+int serializationBenchmark(const std::vector<std::string>& args);
+
+#endif
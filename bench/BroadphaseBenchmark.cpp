@@ -0,0 +1,95 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <map>
+
+#include <SFML/System.hpp>
+
+#include "BenchmarkState.hpp"
+#include "PhysicsBackend.hpp"
+#include "PhysicsProfiler.hpp"
+
+// Steps every level with each bullet broadphase and picks the fastest one. With
+// --write the choices are saved to levels/broadphase.txt, where the game
+// picks them up. Usage: broadphase [eggs] [--write] [level...]
+int broadphaseBenchmark(const std::vector<std::string>& args) {
+    int eggs = 20;
+    bool write = false;
+    std::vector<std::string> levels;
+    for(unsigned int i = 0; i < args.size(); ++i) {
+        if(args[i] == "--write") {
+            write = true;
+        } else if(i == 0) {
+            eggs = std::stoi(args[i]);
+        } else {
+            levels.push_back(args[i]);
+        }
+    }
+    if(levels.empty()) {
+        levels = benchmarkLevels();
+    }
+
+    const int frames = 300;
+    std::vector<State::BroadphaseType> types = {State::BROADPHASE_DBVT, State::BROADPHASE_AXIS_SWEEP, State::BROADPHASE_GRID};
+    std::map<std::string, State::BroadphaseType> fastest;
+
+    std::cout << std::left << std::setw(14) << "level" << std::setw(14) << "broadphase"
+              << std::setw(16) << "us/frame" << "pairs" << std::endl;
+
+    PhysicsBackend::type = PhysicsBackend::BULLET;
+    for(auto level : levels) {
+        int fastestTime = -1;
+        for(auto type : types) {
+            State::broadphase = type;
+
+            BenchmarkState state;
+            state.init();
+            state.loadFromFile("levels/" + level + ".dat");
+            state.spawnEggs(eggs);
+            state.step(60);
+
+            sf::Clock clock;
+            state.step(frames);
+            int time = clock.getElapsedTime().asMicroseconds() / frames;
+            PhysicsFrameStats stats;
+            state.physics()->collectStats(stats);
+            int pairs = stats.pairs;
+
+            if(fastestTime < 0 || time < fastestTime) {
+                fastestTime = time;
+                fastest[level] = type;
+            }
+
+            std::cout << std::left << std::setw(14) << level << std::setw(14) << State::broadphaseName(type)
+                      << std::setw(16) << time << pairs << std::endl;
+        }
+    }
+    State::broadphase = State::BROADPHASE_AUTO;
+
+    std::cout << std::endl << "fastest:" << std::endl;
+    for(auto pair : fastest) {
+        std::cout << "  " << std::left << std::setw(14) << pair.first << State::broadphaseName(pair.second) << std::endl;
+    }
+
+    if(write) {
+        // keep the choices for levels that weren't benchmarked this time
+        std::map<std::string, std::string> choices;
+        std::ifstream in("levels/broadphase.txt");
+        std::string level, name;
+        while(in >> level >> name) choices[level] = name;
+        in.close();
+
+        for(auto pair : fastest) choices[pair.first] = State::broadphaseName(pair.second);
+
+        std::ofstream out("levels/broadphase.txt");
+        if(!out) {
+            std::cerr << "Warning: could not write levels/broadphase.txt." << std::endl;
+            return 1;
+        }
+        for(auto pair : choices) out << pair.first << " " << pair.second << std::endl;
+        std::cout << "Written to levels/broadphase.txt." << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+#include <SFML/System.hpp>
+
+#include "BenchmarkState.hpp"
+#include "CollisionShape.hpp"
+#include "BulletPhysicsWorld.hpp"
+#include "PhysicsBackend.hpp"
+
+// Compares contact generation against level geometry for each way of
+// cooking CollisionShapes, with bullet as the backend. Usage: collision [eggs] [level...]
+int collisionBenchmark(const std::vector<std::string>& args) {
+    int eggs = args.size() > 0 ? std::stoi(args[0]) : 200;
+    std::vector<std::string> levels = benchmarkLevels();
+    if(args.size() > 1) {
+        levels.assign(args.begin() + 1, args.end());
+    }
+
+    const int frames = 300;
+    std::vector<std::pair<CollisionShape::Cooking, std::string>> cookings = {
+        {CollisionShape::TRIANGLE_MESH, "triangle-mesh"},
+        {CollisionShape::CONVEX_PIECES, "convex-pieces"},
+        {CollisionShape::EDGE_CHAIN,    "edge-chain"}
+    };
+
+    std::cout << std::left << std::setw(14) << "level" << std::setw(16) << "cooking"
+              << std::setw(16) << "us/frame" << std::setw(12) << "manifolds" << "contacts" << std::endl;
+
+    PhysicsBackend::type = PhysicsBackend::BULLET;
+    for(auto level : levels) {
+        for(auto cooking : cookings) {
+            CollisionShape::cooking = cooking.first;
+
+            BenchmarkState state;
+            state.init();
+            state.loadFromFile("levels/" + level + ".dat");
+            state.spawnEggs(eggs);
+
+            // let the eggs land first
+            state.step(120);
+
+            btDiscreteDynamicsWorld* world = static_cast<BulletPhysicsWorld*>(state.physics())->dynamicsWorld();
+            sf::Clock clock;
+            sf::Time collisionTime;
+            for(int i = 0; i < frames; ++i) {
+                state.step(1);
+                clock.restart();
+                world->performDiscreteCollisionDetection();
+                collisionTime += clock.getElapsedTime();
+            }
+
+            int manifolds = world->getDispatcher()->getNumManifolds();
+            int contacts = 0;
+            for(int i = 0; i < manifolds; ++i) {
+                contacts += world->getDispatcher()->getManifoldByIndexInternal(i)->getNumContacts();
+            }
+
+            std::cout << std::left << std::setw(14) << level << std::setw(16) << cooking.second
+                      << std::setw(16) << collisionTime.asMicroseconds() / frames
+                      << std::setw(12) << manifolds << contacts << std::endl;
+        }
+    }
+
+    CollisionShape::cooking = CollisionShape::EDGE_CHAIN;
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+#include <SFML/System.hpp>
+
+#include "BenchmarkState.hpp"
+#include "CollisionShape.hpp"
+
+// Loads the levels with an increasing number of cooking threads. Convex
+// pieces are used, triangle meshes would mostly come from the bake.
+// Usage: load [rounds] [max threads] [level...]
+int loadBenchmark(const std::vector<std::string>& args) {
+    int rounds = args.size() > 0 ? std::stoi(args[0]) : 10;
+    int maxThreads = args.size() > 1 ? std::stoi(args[1]) : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> levels = benchmarkLevels();
+    if(args.size() > 2) {
+        levels.assign(args.begin() + 2, args.end());
+    }
+
+    CollisionShape::cooking = CollisionShape::CONVEX_PIECES;
+
+    std::vector<int> threadCounts;
+    for(int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << std::left << std::setw(10) << "threads" << std::setw(16) << "us/load" << "speedup" << std::endl;
+
+    float singleTime = 0;
+    for(int threads : threadCounts) {
+        State::loadThreads = threads;
+
+        BenchmarkState state;
+        state.init();
+
+        sf::Clock clock;
+        int loads = 0;
+        for(int round = 0; round < rounds; ++round) {
+            for(auto level : levels) {
+                state.loadFromFile("levels/" + level + ".dat");
+                loads++;
+            }
+        }
+        float time = clock.getElapsedTime().asMicroseconds() / (float)loads;
+        if(threads == 1) singleTime = time;
+
+        std::cout << std::left << std::setw(10) << threads << std::setw(16) << time
+                  << std::setprecision(3) << singleTime / time << std::endl;
+    }
+
+    State::loadThreads = 0;
+    CollisionShape::cooking = CollisionShape::EDGE_CHAIN;
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+#include <SFML/System.hpp>
+
+#include "BenchmarkState.hpp"
+
+// Switches between the levels over and over, once resetting the world in
+// place and once building a new world for every level. Each loaded level
+// is stepped for a few frames so the pools of the world get used.
+// Usage: reload [rounds] [level...]
+int reloadBenchmark(const std::vector<std::string>& args) {
+    int rounds = args.size() > 0 ? std::stoi(args[0]) : 20;
+    std::vector<std::string> levels = benchmarkLevels();
+    if(args.size() > 1) {
+        levels.assign(args.begin() + 1, args.end());
+    }
+
+    std::cout << std::left << std::setw(12) << "world" << std::setw(16) << "us/load" << "us/first frame" << std::endl;
+
+    for(bool reuse : {false, true}) {
+        State::reuseWorld = reuse;
+
+        BenchmarkState state;
+        state.init();
+
+        sf::Clock clock;
+        sf::Time loadTime, frameTime;
+        int loads = 0;
+        for(int round = 0; round < rounds; ++round) {
+            for(auto level : levels) {
+                clock.restart();
+                state.loadFromFile("levels/" + level + ".dat");
+                loadTime += clock.getElapsedTime();
+
+                // the first frame pays for whatever the pools have to allocate
+                state.spawnEggs(20);
+                clock.restart();
+                state.step(1);
+                frameTime += clock.getElapsedTime();
+
+                state.step(29);
+                loads++;
+            }
+        }
+
+        std::cout << std::left << std::setw(12) << (reuse ? "reset" : "rebuild")
+                  << std::setw(16) << loadTime.asMicroseconds() / loads
+                  << frameTime.asMicroseconds() / loads << std::endl;
+    }
+
+    State::reuseWorld = true;
+    return 0;
+}
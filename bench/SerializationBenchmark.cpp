@@ -0,0 +1,118 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include <SFML/System.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/vector.hpp>
+#include <cereal/types/memory.hpp>
+
+#include "BenchmarkState.hpp"
+#include "LevelFile.hpp"
+
+static const int POLYGON_POINTS = 32;
+
+static bool saveLevel(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities) {
+    if(filename.substr(filename.size() - 4) == ".lvl") {
+        return LevelFile::write(filename, entities);
+    }
+
+    std::ofstream stream(filename, std::ios::binary);
+    if(filename.substr(filename.size() - 4) == "json") {
+        cereal::JSONOutputArchive ar(stream);
+        ar(cereal::make_nvp("entities", entities));
+    } else {
+        cereal::PortableBinaryOutputArchive ar(stream);
+        ar(cereal::make_nvp("entities", entities));
+    }
+    return (bool)stream;
+}
+
+static long long fileSize(const std::string& filename) {
+    std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+    return stream ? (long long)stream.tellg() : 0;
+}
+
+// Saves and loads synthetic levels of growing size in every level format.
+// Loading is split into reading the file (deserialize), cooking the shapes
+// (init) and adding the bodies to the world (register). All times are in
+// milliseconds. Prints JSON, to the given file or stdout.
+// Usage: serialization [output.json] [entities...]
+int serializationBenchmark(const std::vector<std::string>& args) {
+    std::string output = args.size() > 0 ? args[0] : "-";
+    std::vector<int> sizes = {1000, 10000, 100000, 1000000};
+    if(args.size() > 1) {
+        sizes.clear();
+        for(unsigned int i = 1; i < args.size(); ++i) sizes.push_back(std::stoi(args[i]));
+    }
+
+    std::vector<std::pair<std::string, std::string>> formats = {
+        {"cereal-json",            "bench-serialization.json"},
+        {"cereal-portable-binary", "bench-serialization.dat"},
+        {"level-file",             "bench-serialization.lvl"}
+    };
+
+    std::ostringstream json;
+    json << "{\n  \"polygonPoints\": " << POLYGON_POINTS << ",\n  \"results\": [";
+    bool first = true;
+
+    BenchmarkState state;
+    state.init();
+
+    for(int size : sizes) {
+        auto level = syntheticLevel(size, POLYGON_POINTS);
+
+        for(auto format : formats) {
+            std::cerr << size << " entities, " << format.first << std::endl;
+
+            sf::Clock clock;
+            if(!saveLevel(format.second, level)) {
+                std::cerr << "Warning: could not write " << format.second << "." << std::endl;
+                continue;
+            }
+            float saveTime = clock.restart().asMicroseconds() / 1000.f;
+
+            std::vector<std::shared_ptr<Entity>> entities;
+            LevelFile::read(format.second, entities);
+            float readTime = clock.restart().asMicroseconds() / 1000.f;
+
+            long long cookTime, registerTime;
+            state.loadTimed(entities, cookTime, registerTime);
+            size_t loaded = entities.size();
+            entities.clear();
+
+            json << (first ? "\n" : ",\n");
+            json << "    {\"entities\": " << size << ", \"format\": \"" << format.first << "\""
+                 << ", \"bytes\": " << fileSize(format.second)
+                 << ", \"loaded\": " << loaded
+                 << ", \"saveMs\": " << saveTime
+                 << ", \"deserializeMs\": " << readTime
+                 << ", \"initMs\": " << cookTime / 1000.f
+                 << ", \"registerMs\": " << registerTime / 1000.f << "}";
+            first = false;
+
+            std::remove(format.second.c_str());
+        }
+
+        // drop the last level before building the next one
+        long long cookTime, registerTime;
+        state.loadTimed({}, cookTime, registerTime);
+    }
+    json << "\n  ]\n}\n";
+
+    if(output == "-") {
+        std::cout << json.str();
+    } else {
+        std::ofstream stream(output);
+        stream << json.str();
+        if(!stream) {
+            std::cerr << "Warning: could not write " << output << "." << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
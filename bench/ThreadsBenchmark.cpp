@@ -0,0 +1,51 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <thread>
+
+#include <SFML/System.hpp>
+
+#include "BenchmarkState.hpp"
+
+// Steps an arena full of eggs and toys with an increasing number of physics
+// threads. Usage: threads [bodies] [max threads]
+int threadsBenchmark(const std::vector<std::string>& args) {
+    int bodies = args.size() > 0 ? std::stoi(args[0]) : 4000;
+    int maxThreads = args.size() > 1 ? std::stoi(args[1]) : std::max(1u, std::thread::hardware_concurrency());
+
+    const int frames = 300;
+    float side = sqrt(bodies) * 1.5f;
+
+    std::cout << std::left << std::setw(10) << "threads" << std::setw(16) << "us/frame" << "speedup" << std::endl;
+
+    // 1, 2, 4, ... and the maximum
+    std::vector<int> threadCounts;
+    for(int threads = 1; threads < maxThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    float singleTime = 0;
+    for(int threads : threadCounts) {
+        State::physicsThreads = threads;
+
+        BenchmarkState state;
+        state.init();
+        state.buildArena(side, side * 1.5f);
+        state.spawnEggsAndToys(bodies);
+
+        // let the pile settle a bit, the first frames are all broadphase work
+        state.step(60);
+
+        sf::Clock clock;
+        state.step(frames);
+        float time = clock.getElapsedTime().asMicroseconds() / (float)frames;
+        if(singleTime == 0) singleTime = time;
+
+        std::cout << std::left << std::setw(10) << threads << std::setw(16) << (int)time
+                  << std::setprecision(3) << singleTime / time << std::endl;
+    }
+
+    State::physicsThreads = 1;
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <iostream>
+#include <map>
+#include <functional>
+
+#include "Root.hpp"
+#include "Benchmarks.hpp"
+
+int main(int argc, char** argv) {
+    std::map<std::string, std::function<int(const std::vector<std::string>&)>> benchmarks;
+    benchmarks["collision"] = collisionBenchmark;
+    benchmarks["threads"] = threadsBenchmark;
+    benchmarks["backends"] = backendsBenchmark;
+    benchmarks["broadphase"] = broadphaseBenchmark;
+    benchmarks["reload"] = reloadBenchmark;
+    benchmarks["load"] = loadBenchmark;
+    benchmarks["serialization"] = serializationBenchmark;
+
+    if(argc < 2 || benchmarks.find(argv[1]) == benchmarks.end()) {
+        std::cerr << "Usage: " << argv[0] << " <benchmark> [args...]" << std::endl;
+        std::cerr << "Benchmarks:";
+        for(auto pair : benchmarks) std::cerr << " " << pair.first;
+        std::cerr << std::endl;
+        return 1;
+    }
+
+    // entities pick their textures and sounds up in their constructors
+    Root().loadResources();
+
+    std::vector<std::string> args(argv + 2, argv + argc);
+    return benchmarks[argv[1]](args);
+}
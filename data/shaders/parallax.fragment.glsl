@@ -0,0 +1,42 @@
+uniform vec4 background;
+
+// layer 0 is blended over the background, 1 and 3 multiply, 2 adds
+uniform sampler2D texture0;
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+uniform sampler2D texture3;
+uniform vec2 offset0;
+uniform vec2 offset1;
+uniform vec2 offset2;
+uniform vec2 offset3;
+uniform float size0;
+uniform float size1;
+uniform float size2;
+uniform float size3;
+uniform vec4 color0;
+uniform vec4 color1;
+uniform vec4 color2;
+uniform vec4 color3;
+
+vec4 layer(sampler2D tex, vec2 pos, vec2 offset, float size, vec4 color) {
+    return texture2D(tex, (pos - offset) / size) * color;
+}
+
+void main() {
+    // world position of the pixel
+    vec2 pos = gl_TexCoord[0].xy;
+    vec3 col = background.rgb;
+    vec4 l;
+
+    l = layer(texture0, pos, offset0, size0, color0);
+    col = mix(col, l.rgb, l.a);
+
+    col *= layer(texture1, pos, offset1, size1, color1).rgb;
+
+    l = layer(texture2, pos, offset2, size2, color2);
+    col += l.rgb * l.a;
+
+    col *= layer(texture3, pos, offset3, size3, color3).rgb;
+
+    gl_FragColor = vec4(col, 1.0);
+}
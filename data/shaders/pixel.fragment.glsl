@@ -1,4 +1,6 @@
 uniform sampler2D texture;
+uniform sampler2D blurred;
+uniform float blur;
 uniform vec2 center;
 uniform vec2 size;
 
@@ -20,6 +22,9 @@ void main() {
     vec4 col = texture2D(texture, coord);
     float f;
 
+    // the blurred image has a lower resolution, its blur grows towards the edges
+    col = mix(col, texture2D(blurred, coord), blur);
+
     // vignette
     vec2 center = vec2(0.5, 0.5);
     f = length(coord - center) / (0.5 * sqrt(2));
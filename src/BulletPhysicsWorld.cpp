@@ -0,0 +1,532 @@
+#include "BulletPhysicsWorld.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <LinearMath/btAabbUtil2.h>
+#include <LinearMath/btQuickprof.h>
+
+#include "EntityMotionState.hpp"
+#include "GridBroadphase.hpp"
+#include "DebugDraw.hpp"
+#include "PhysicsProfiler.hpp"
+
+#if BT_THREADSAFE
+#include <LinearMath/btThreads.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#endif
+
+#if BT_THREADSAFE
+// one scheduler for all worlds, the worker threads are kept alive
+static btITaskScheduler* taskScheduler(int threads) {
+    static btITaskScheduler* scheduler = nullptr;
+    if(!scheduler) {
+        scheduler = btCreateDefaultTaskScheduler();
+        if(!scheduler) return nullptr;
+        btSetTaskScheduler(scheduler);
+    }
+    scheduler->setNumThreadsToUse(std::min(threads, scheduler->getMaxNumThreads()));
+    return scheduler;
+}
+#endif
+
+#ifndef BT_NO_PROFILE
+// Sums up the phases we are interested in from bullet's profile tree. The
+// names are the BT_PROFILE blocks in btCollisionWorld/btDiscreteDynamicsWorld.
+static void collectPhaseTimes(CProfileIterator* it, PhysicsFrameStats& stats) {
+    std::vector<bool> descend;
+    for(it->First(); !it->Is_Done(); it->Next()) {
+        std::string name = it->Get_Current_Name();
+        float time = it->Get_Current_Total_Time();
+        bool phase = true;
+        if(name == "calculateOverlappingPairs") {
+            stats.broadphaseTime += time;
+        } else if(name == "dispatchAllCollisionPairs") {
+            stats.narrowphaseTime += time;
+        } else if(name == "solveConstraints") {
+            stats.solverTime += time;
+        } else {
+            phase = false;
+        }
+        descend.push_back(!phase);
+    }
+
+    for(unsigned int i = 0; i < descend.size(); ++i) {
+        if(!descend[i]) continue;
+        it->Enter_Child(i);
+        collectPhaseTimes(it, stats);
+        it->Enter_Parent();
+    }
+}
+#endif
+
+static PhysicsBody* bodyOf(const btCollisionObject* object) {
+    Entity* entity = static_cast<Entity*>(object->getUserPointer());
+    return entity ? entity->physicsBody() : nullptr;
+}
+
+BulletPhysicsBody::BulletPhysicsBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform)
+    : PhysicsBody(entity.get()) {
+    m_motionState = new EntityMotionState(transform, entity);
+    btRigidBody::btRigidBodyConstructionInfo construction_info(mass, m_motionState, shape, inertia);
+    m_body = new btRigidBody(construction_info);
+
+    // We're in 2D land so don't allow Z movement
+    m_body->setLinearFactor(btVector3(1, 1, 0));
+    m_body->setAngularFactor(btVector3(0, 0, 1));
+
+    // rays and contacts find their way back to the entity through this
+    m_body->setUserPointer((void*)entity.get());
+}
+
+BulletPhysicsBody::~BulletPhysicsBody() {
+    delete m_body;
+    delete m_motionState;
+}
+
+btRigidBody* BulletPhysicsBody::rigidBody() const {
+    return m_body;
+}
+
+bool BulletPhysicsBody::isInWorld() const {
+    return m_body->isInWorld();
+}
+
+bool BulletPhysicsBody::isDynamic() const {
+    return !m_body->isStaticOrKinematicObject();
+}
+
+btTransform BulletPhysicsBody::transform() const {
+    return m_body->getWorldTransform();
+}
+
+void BulletPhysicsBody::setTransform(const btTransform& transform) {
+    m_body->setCenterOfMassTransform(transform);
+}
+
+PhysicsBody::Motion BulletPhysicsBody::motion() const {
+    Motion motion;
+    motion.transform = m_body->getWorldTransform();
+    motion.linearVelocity = m_body->getLinearVelocity();
+    motion.angularVelocity = m_body->getAngularVelocity().z();
+    motion.awake = m_body->isActive();
+    motion.restTime = m_body->getDeactivationTime();
+    return motion;
+}
+
+void BulletPhysicsBody::setMotion(const Motion& motion) {
+    btVector3 angularVelocity(0, 0, motion.angularVelocity);
+    m_body->setWorldTransform(motion.transform);
+    m_body->setInterpolationWorldTransform(motion.transform);
+    m_body->setLinearVelocity(motion.linearVelocity);
+    m_body->setAngularVelocity(angularVelocity);
+    m_body->setInterpolationLinearVelocity(motion.linearVelocity);
+    m_body->setInterpolationAngularVelocity(angularVelocity);
+    m_body->clearForces();
+    m_body->forceActivationState(motion.awake ? ACTIVE_TAG : ISLAND_SLEEPING);
+    m_body->setDeactivationTime(motion.restTime);
+    m_motionState->setWorldTransform(motion.transform);
+}
+
+btVector3 BulletPhysicsBody::linearVelocity() const {
+    return m_body->getLinearVelocity();
+}
+
+void BulletPhysicsBody::setLinearVelocity(const btVector3& velocity) {
+    m_body->setLinearVelocity(velocity);
+}
+
+btScalar BulletPhysicsBody::angularVelocity() const {
+    return m_body->getAngularVelocity().z();
+}
+
+void BulletPhysicsBody::setAngularVelocity(btScalar velocity) {
+    m_body->setAngularVelocity(btVector3(0, 0, velocity));
+}
+
+void BulletPhysicsBody::applyCentralForce(const btVector3& force) {
+    m_body->applyCentralForce(force);
+}
+
+void BulletPhysicsBody::applyCentralImpulse(const btVector3& impulse) {
+    m_body->applyCentralImpulse(impulse);
+}
+
+void BulletPhysicsBody::applyTorque(btScalar torque) {
+    m_body->applyTorque(btVector3(0, 0, torque));
+}
+
+void BulletPhysicsBody::setShape(btCollisionShape* shape, btScalar mass) {
+    // re-adding drops the cached collision algorithms of the old shape, and
+    // puts the body into the collision group of its new mass
+    bool inWorld = m_body->isInWorld();
+    if(inWorld) m_world->removeRigidBody(m_body);
+
+    btVector3 inertia(0, 0, 0);
+    shape->calculateLocalInertia(mass, inertia);
+    m_body->setCollisionShape(shape);
+    m_body->setMassProps(mass, inertia);
+    m_body->updateInertiaTensor();
+
+    if(inWorld) m_world->addRigidBody(m_body);
+}
+
+void BulletPhysicsBody::setFriction(btScalar friction) {
+    m_body->setFriction(friction);
+}
+
+void BulletPhysicsBody::setDamping(btScalar linear, btScalar angular) {
+    m_body->setDamping(linear, angular);
+}
+
+void BulletPhysicsBody::setAngularFactor(btScalar factor) {
+    m_body->setAngularFactor(btVector3(0, 0, factor));
+}
+
+void BulletPhysicsBody::setGravity(const btVector3& gravity) {
+    m_body->setGravity(gravity);
+}
+
+void BulletPhysicsBody::setSensor(bool sensor) {
+    int flags = m_body->getCollisionFlags();
+    if(sensor) {
+        m_body->setCollisionFlags(flags | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+    } else {
+        m_body->setCollisionFlags(flags & ~btCollisionObject::CF_NO_CONTACT_RESPONSE);
+    }
+}
+
+btScalar BulletPhysicsBody::boundingRadius() const {
+    btVector3 center;
+    btScalar radius;
+    m_body->getCollisionShape()->getBoundingSphere(center, radius);
+    return radius;
+}
+
+void BulletPhysicsBody::setCcd(btScalar motionThreshold, btScalar sweptRadius) {
+    m_body->setCcdMotionThreshold(motionThreshold);
+    m_body->setCcdSweptSphereRadius(sweptRadius);
+}
+
+btScalar BulletPhysicsBody::ccdMotionThreshold() const {
+    return m_body->getCcdMotionThreshold();
+}
+
+bool BulletPhysicsBody::isAwake() const {
+    return m_body->isActive();
+}
+
+void BulletPhysicsBody::wake() {
+    m_body->activate();
+}
+
+BulletPhysicsGhost::BulletPhysicsGhost(btCollisionShape* shape) {
+    m_object.setCollisionShape(shape);
+    m_object.setCollisionFlags(m_object.getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+}
+
+bool BulletPhysicsGhost::isInWorld() const {
+    return m_object.getBroadphaseHandle() != nullptr;
+}
+
+btTransform BulletPhysicsGhost::transform() const {
+    return m_object.getWorldTransform();
+}
+
+void BulletPhysicsGhost::setTransform(const btTransform& transform) {
+    m_object.setWorldTransform(transform);
+}
+
+BulletPhysicsWorld::BulletPhysicsWorld(State::BroadphaseType broadphase, const btVector3& lower, const btVector3& upper, int threads) {
+    if(broadphase == State::BROADPHASE_AXIS_SWEEP) {
+        m_broadphase = new btAxisSweep3(lower, upper);
+    } else if(broadphase == State::BROADPHASE_GRID) {
+        m_broadphase = new GridBroadphase();
+    } else {
+        m_broadphase = new btDbvtBroadphase();
+    }
+    m_collisionConfiguration = new btDefaultCollisionConfiguration();
+
+#if BT_THREADSAFE
+    if(threads > 1 && taskScheduler(threads)) {
+        int schedulerThreads = btGetTaskScheduler()->getNumThreads();
+        m_collisionDispatcher = new btCollisionDispatcherMt(m_collisionConfiguration);
+        m_solver = new btConstraintSolverPoolMt(schedulerThreads);
+        m_solverMt = new btSequentialImpulseConstraintSolverMt();
+        m_dynamicsWorld = new btDiscreteDynamicsWorldMt(m_collisionDispatcher, m_broadphase,
+                                                        static_cast<btConstraintSolverPoolMt*>(m_solver), m_solverMt,
+                                                        m_collisionConfiguration);
+    }
+#else
+    if(threads > 1) {
+        std::cerr << "Warning: Bullet was built without BT_THREADSAFE, using a single physics thread." << std::endl;
+    }
+#endif
+
+    if(!m_dynamicsWorld) {
+        m_collisionDispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+        m_solver = new btSequentialImpulseConstraintSolver;
+        m_dynamicsWorld = new btDiscreteDynamicsWorld(m_collisionDispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+    }
+
+    // keeps the overlapping pairs of btPairCachingGhostObjects up to date
+    m_ghostPairCallback = new btGhostPairCallback();
+    m_broadphase->getOverlappingPairCache()->setInternalGhostPairCallback(m_ghostPairCallback);
+}
+
+BulletPhysicsWorld::~BulletPhysicsWorld() {
+    delete m_dynamicsWorld;
+    delete m_solverMt;
+    delete m_solver;
+    delete m_collisionDispatcher;
+    delete m_collisionConfiguration;
+    delete m_broadphase;
+    delete m_ghostPairCallback;
+}
+
+btDiscreteDynamicsWorld* BulletPhysicsWorld::dynamicsWorld() const {
+    return m_dynamicsWorld;
+}
+
+PhysicsBody* BulletPhysicsWorld::createBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform) {
+    return new BulletPhysicsBody(entity, shape, mass, inertia, transform);
+}
+
+void BulletPhysicsWorld::addBody(PhysicsBody* body) {
+    BulletPhysicsBody* b = static_cast<BulletPhysicsBody*>(body);
+    m_dynamicsWorld->addRigidBody(b->m_body);
+    b->m_world = m_dynamicsWorld;
+}
+
+void BulletPhysicsWorld::removeBody(PhysicsBody* body) {
+    m_dynamicsWorld->removeRigidBody(static_cast<BulletPhysicsBody*>(body)->m_body);
+}
+
+PhysicsGhost* BulletPhysicsWorld::createGhost(btCollisionShape* shape) {
+    return new BulletPhysicsGhost(shape);
+}
+
+void BulletPhysicsWorld::addGhost(PhysicsGhost* ghost) {
+    m_dynamicsWorld->addCollisionObject(&static_cast<BulletPhysicsGhost*>(ghost)->m_object, btBroadphaseProxy::SensorTrigger, btBroadphaseProxy::AllFilter & ~btBroadphaseProxy::SensorTrigger);
+}
+
+void BulletPhysicsWorld::removeGhost(PhysicsGhost* ghost) {
+    m_dynamicsWorld->removeCollisionObject(&static_cast<BulletPhysicsGhost*>(ghost)->m_object);
+}
+
+void BulletPhysicsWorld::reset() {
+    for(int i = m_dynamicsWorld->getNumConstraints() - 1; i >= 0; --i) {
+        m_dynamicsWorld->removeConstraint(m_dynamicsWorld->getConstraint(i));
+    }
+
+    // entities are gone already, this catches ghosts and other leftovers
+    btCollisionObjectArray& objects = m_dynamicsWorld->getCollisionObjectArray();
+    for(int i = objects.size() - 1; i >= 0; --i) {
+        btRigidBody* body = btRigidBody::upcast(objects[i]);
+        if(body) {
+            m_dynamicsWorld->removeRigidBody(body);
+        } else {
+            m_dynamicsWorld->removeCollisionObject(objects[i]);
+        }
+    }
+
+    // removing the proxies emptied the pair cache, the pools stay allocated
+    m_broadphase->resetPool(m_collisionDispatcher);
+    m_solver->reset();
+}
+
+void BulletPhysicsWorld::bodiesMoved() {
+    m_dynamicsWorld->updateAabbs();
+    m_solver->reset();
+}
+
+void BulletPhysicsWorld::setGravity(const btVector3& gravity) {
+    m_dynamicsWorld->setGravity(gravity);
+}
+
+int BulletPhysicsWorld::step(btScalar dt, int maxSubsteps, btScalar substep) {
+    return m_dynamicsWorld->stepSimulation(dt, maxSubsteps, substep);
+}
+
+void BulletPhysicsWorld::getContacts(std::vector<PhysicsContact>& contacts) {
+    contacts.clear();
+
+    int numManifolds = m_collisionDispatcher->getNumManifolds();
+    for(int i = 0; i < numManifolds; i++) {
+        btPersistentManifold* manifold = m_collisionDispatcher->getManifoldByIndexInternal(i);
+        if(manifold->getNumContacts() == 0) continue;
+
+        // ghosts have no body
+        PhysicsBody* a = bodyOf(manifold->getBody0());
+        PhysicsBody* b = bodyOf(manifold->getBody1());
+        if(!a || !b) continue;
+
+        for(int j = 0; j < manifold->getNumContacts(); j++) {
+            const btManifoldPoint& pt = manifold->getContactPoint(j);
+
+            PhysicsContact contact;
+            contact.a = a;
+            contact.b = b;
+            contact.positionOnA = pt.getPositionWorldOnA();
+            contact.positionOnB = pt.getPositionWorldOnB();
+            contact.distance = pt.getDistance();
+            contacts.push_back(contact);
+        }
+    }
+}
+
+void BulletPhysicsWorld::getGhostContacts(PhysicsGhost* physicsGhost, int typeMask, std::vector<EntityCollision>& contacts) {
+    contacts.clear();
+
+    // only the pairs overlapping the ghost are looked at
+    btPairCachingGhostObject* ghost = &static_cast<BulletPhysicsGhost*>(physicsGhost)->m_object;
+    btBroadphasePairArray& pairs = ghost->getOverlappingPairCache()->getOverlappingPairArray();
+    for(int i = 0; i < pairs.size(); i++) {
+        const btBroadphasePair& pair = pairs[i];
+        btBroadphasePair* collisionPair = m_dynamicsWorld->getPairCache()->findPair(pair.m_pProxy0, pair.m_pProxy1);
+        if(!collisionPair || !collisionPair->m_algorithm) continue;
+
+        m_manifoldArray.resize(0);
+        collisionPair->m_algorithm->getAllContactManifolds(m_manifoldArray);
+        for(int j = 0; j < m_manifoldArray.size(); j++) {
+            btPersistentManifold* manifold = m_manifoldArray[j];
+            bool ghostIsA = manifold->getBody0() == ghost;
+            const btCollisionObject* other = ghostIsA ? manifold->getBody1() : manifold->getBody0();
+
+            Entity* entity = static_cast<Entity*>(other->getUserPointer());
+            if(!entity || !(entity->getTypeFlag() & typeMask)) continue;
+
+            for(int k = 0; k < manifold->getNumContacts(); k++) {
+                const btManifoldPoint& pt = manifold->getContactPoint(k);
+
+                EntityCollision c;
+                c.other = entity;
+                c.position = ghostIsA ? pt.getPositionWorldOnA() : pt.getPositionWorldOnB();
+                c.otherPosition = ghostIsA ? pt.getPositionWorldOnB() : pt.getPositionWorldOnA();
+                c.distance = pt.getDistance();
+                contacts.push_back(c);
+            }
+        }
+    }
+}
+
+void BulletPhysicsWorld::rayTest(RayQuery* rays, int count) {
+    if(count <= 0) return;
+
+    // the broadphase is only traversed once for the bounding box of the whole batch
+    btVector3 aabbMin = rays[0].from;
+    btVector3 aabbMax = rays[0].from;
+    for(int i = 0; i < count; ++i) {
+        aabbMin.setMin(rays[i].from);
+        aabbMin.setMin(rays[i].to);
+        aabbMax.setMax(rays[i].from);
+        aabbMax.setMax(rays[i].to);
+    }
+
+    struct CandidateCollector : public btBroadphaseAabbCallback {
+        std::vector<RayCandidate>* candidates;
+
+        bool process(const btBroadphaseProxy* proxy) override {
+            btCollisionObject* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+            Entity* entity = static_cast<Entity*>(object->getUserPointer());
+            if(entity) {
+                RayCandidate c;
+                c.object = object;
+                c.typeFlag = entity->getTypeFlag();
+                candidates->push_back(c);
+            }
+            return true;
+        }
+    } collector;
+
+    m_rayCandidates.clear();
+    collector.candidates = &m_rayCandidates;
+    m_broadphase->aabbTest(aabbMin, aabbMax, collector);
+
+    for(int i = 0; i < count; ++i) {
+        RayQuery& ray = rays[i];
+        btTransform fromTransform(btQuaternion::getIdentity(), ray.from);
+        btTransform toTransform(btQuaternion::getIdentity(), ray.to);
+        btCollisionWorld::ClosestRayResultCallback callback(ray.from, ray.to);
+
+        for(auto& c : m_rayCandidates) {
+            if(!(c.typeFlag & ray.typeMask)) continue;
+
+            btBroadphaseProxy* proxy = c.object->getBroadphaseHandle();
+            if(!(proxy->m_collisionFilterGroup & ray.collisionMask) || !(ray.collisionGroup & proxy->m_collisionFilterMask)) continue;
+
+            btScalar fraction = callback.m_closestHitFraction;
+            btVector3 normal;
+            if(!btRayAabb(ray.from, ray.to, proxy->m_aabbMin, proxy->m_aabbMax, fraction, normal)) continue;
+
+            btCollisionWorld::rayTestSingle(fromTransform, toTransform, c.object, c.object->getCollisionShape(), c.object->getWorldTransform(), callback);
+        }
+
+        ray.hit = callback.hasHit();
+        ray.hitFraction = callback.m_closestHitFraction;
+        if(ray.hit) {
+            ray.hitPoint = callback.m_hitPointWorld;
+            ray.hitNormal = callback.m_hitNormalWorld;
+            ray.entity = static_cast<Entity*>(callback.m_collisionObject->getUserPointer());
+        } else {
+            ray.entity = nullptr;
+        }
+    }
+}
+
+void BulletPhysicsWorld::wakeRegion(const btVector3& lower, const btVector3& upper) {
+    struct WakeCallback : public btBroadphaseAabbCallback {
+        bool process(const btBroadphaseProxy* proxy) override {
+            btRigidBody* body = btRigidBody::upcast(static_cast<btCollisionObject*>(proxy->m_clientObject));
+            if(body && !body->isStaticOrKinematicObject() && !body->isActive()) {
+                body->activate();
+            }
+            return true;
+        }
+    } callback;
+
+    m_broadphase->aabbTest(lower, upper, callback);
+}
+
+int BulletPhysicsWorld::countAwake() const {
+    int awake = 0;
+    const btCollisionObjectArray& objects = m_dynamicsWorld->getCollisionObjectArray();
+    for(int i = 0; i < objects.size(); ++i) {
+        if(!objects[i]->isStaticOrKinematicObject() && objects[i]->isActive()) awake++;
+    }
+    return awake;
+}
+
+void BulletPhysicsWorld::collectStats(PhysicsFrameStats& stats) {
+    stats.pairs = m_broadphase->getOverlappingPairCache()->getNumOverlappingPairs();
+
+    stats.manifolds = m_collisionDispatcher->getNumManifolds();
+    for(int i = 0; i < stats.manifolds; ++i) {
+        stats.contacts += m_collisionDispatcher->getManifoldByIndexInternal(i)->getNumContacts();
+    }
+
+    // the union find is sorted by island after each step
+    btUnionFind& unionFind = m_dynamicsWorld->getSimulationIslandManager()->getUnionFind();
+    int lastIsland = -1;
+    for(int i = 0; i < unionFind.getNumElements(); ++i) {
+        int island = unionFind.getElement(i).m_id;
+        if(island != lastIsland) {
+            stats.islands++;
+            lastIsland = island;
+        }
+    }
+
+    stats.awakeBodies = countAwake();
+
+#ifndef BT_NO_PROFILE
+    CProfileIterator* it = CProfileManager::Get_Iterator();
+    collectPhaseTimes(it, stats);
+    CProfileManager::Release_Iterator(it);
+#endif
+}
+
+void BulletPhysicsWorld::debugDraw(DebugDraw* drawer) {
+    m_dynamicsWorld->setDebugDrawer(drawer);
+    m_dynamicsWorld->debugDrawWorld();
+}
@@ -0,0 +1,120 @@
+#ifndef BULLETPHYSICSWORLD_HPP
+#define BULLETPHYSICSWORLD_HPP
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+
+#include "PhysicsWorld.hpp"
+#include "State.hpp"
+
+class EntityMotionState;
+
+class BulletPhysicsBody : public PhysicsBody {
+public:
+    BulletPhysicsBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform);
+    ~BulletPhysicsBody();
+
+    btRigidBody* rigidBody() const;
+
+    bool isInWorld() const override;
+    bool isDynamic() const override;
+
+    btTransform transform() const override;
+    void setTransform(const btTransform& transform) override;
+    Motion motion() const override;
+    void setMotion(const Motion& motion) override;
+
+    btVector3 linearVelocity() const override;
+    void setLinearVelocity(const btVector3& velocity) override;
+    btScalar angularVelocity() const override;
+    void setAngularVelocity(btScalar velocity) override;
+
+    void applyCentralForce(const btVector3& force) override;
+    void applyCentralImpulse(const btVector3& impulse) override;
+    void applyTorque(btScalar torque) override;
+
+    void setShape(btCollisionShape* shape, btScalar mass) override;
+    void setFriction(btScalar friction) override;
+    void setDamping(btScalar linear, btScalar angular) override;
+    void setAngularFactor(btScalar factor) override;
+    void setGravity(const btVector3& gravity) override;
+    void setSensor(bool sensor) override;
+
+    btScalar boundingRadius() const override;
+    void setCcd(btScalar motionThreshold, btScalar sweptRadius) override;
+    btScalar ccdMotionThreshold() const override;
+
+    bool isAwake() const override;
+    void wake() override;
+
+private:
+    EntityMotionState* m_motionState;
+    btRigidBody* m_body;
+    // the world the body was last added to, for cleaning its pairs
+    btDiscreteDynamicsWorld* m_world = nullptr;
+
+    friend class BulletPhysicsWorld;
+};
+
+class BulletPhysicsGhost : public PhysicsGhost {
+public:
+    BulletPhysicsGhost(btCollisionShape* shape);
+
+    bool isInWorld() const override;
+    btTransform transform() const override;
+    void setTransform(const btTransform& transform) override;
+
+    btPairCachingGhostObject m_object;
+};
+
+// The reference backend: bullet with every body locked to the XY plane.
+class BulletPhysicsWorld : public PhysicsWorld {
+public:
+    BulletPhysicsWorld(State::BroadphaseType broadphase, const btVector3& lower, const btVector3& upper, int threads);
+    ~BulletPhysicsWorld();
+
+    // for benchmarks that look into bullet itself
+    btDiscreteDynamicsWorld* dynamicsWorld() const;
+
+    PhysicsBody* createBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform) override;
+    void addBody(PhysicsBody* body) override;
+    void removeBody(PhysicsBody* body) override;
+
+    PhysicsGhost* createGhost(btCollisionShape* shape) override;
+    void addGhost(PhysicsGhost* ghost) override;
+    void removeGhost(PhysicsGhost* ghost) override;
+
+    void reset() override;
+    void bodiesMoved() override;
+
+    void setGravity(const btVector3& gravity) override;
+    int step(btScalar dt, int maxSubsteps, btScalar substep) override;
+
+    void getContacts(std::vector<PhysicsContact>& contacts) override;
+    void getGhostContacts(PhysicsGhost* ghost, int typeMask, std::vector<EntityCollision>& contacts) override;
+    void rayTest(RayQuery* rays, int count) override;
+
+    void wakeRegion(const btVector3& lower, const btVector3& upper) override;
+    int countAwake() const override;
+
+    void collectStats(PhysicsFrameStats& stats) override;
+    void debugDraw(DebugDraw* drawer) override;
+
+private:
+    btBroadphaseInterface* m_broadphase = nullptr;
+    btDefaultCollisionConfiguration* m_collisionConfiguration = nullptr;
+    btCollisionDispatcher* m_collisionDispatcher = nullptr;
+    btConstraintSolver* m_solver = nullptr;
+    btConstraintSolver* m_solverMt = nullptr;
+    btDiscreteDynamicsWorld* m_dynamicsWorld = nullptr;
+    btGhostPairCallback* m_ghostPairCallback = nullptr;
+    btManifoldArray m_manifoldArray;
+
+    struct RayCandidate {
+        btCollisionObject* object;
+        int typeFlag;
+    };
+    std::vector<RayCandidate> m_rayCandidates;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "CollisionBake.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include <LinearMath/btAlignedAllocator.h>
+
+static const char BAKE_MAGIC[8] = {'A', 'R', 'A', 'C', 'B', 'V', 'H', '\0'};
+static const unsigned int BAKE_VERSION = 1;
+static const unsigned int BAKE_ALIGNMENT = 16;
+
+struct BakeHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int count;
+    unsigned long long sourceHash;
+    unsigned long long reserved;
+};
+
+struct BakeEntryHeader {
+    unsigned int size;
+    unsigned int reserved[3];
+};
+
+static unsigned int align(unsigned int size) {
+    return (size + BAKE_ALIGNMENT - 1) & ~(BAKE_ALIGNMENT - 1);
+}
+
+unsigned long long CollisionBake::hashFile(const std::string& filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    unsigned long long hash = 14695981039346656037ULL;
+    char c;
+    while(stream.get(c)) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+CollisionBake::CollisionBake(const std::string& levelFilename)
+    : m_levelFilename(levelFilename),
+      m_filename(levelFilename + ".cooked"),
+      m_sourceHash(0) {}
+
+bool CollisionBake::load() {
+    m_sourceHash = hashFile(m_levelFilename) ^ BAKE_VERSION;
+
+    std::ifstream stream(m_filename, std::ios::binary | std::ios::ate);
+    if(!stream) return false;
+
+    std::streamsize size = stream.tellg();
+    if(size < (std::streamsize)sizeof(BakeHeader)) return false;
+    stream.seekg(0);
+
+    // bullet needs the in-place data 16 byte aligned
+    char* buffer = static_cast<char*>(btAlignedAlloc(size, BAKE_ALIGNMENT));
+    m_data = std::shared_ptr<void>(buffer, [](void* p) { btAlignedFree(p); });
+    if(!stream.read(buffer, size)) return false;
+
+    const BakeHeader* header = reinterpret_cast<const BakeHeader*>(buffer);
+    if(std::memcmp(header->magic, BAKE_MAGIC, sizeof(BAKE_MAGIC)) != 0 || header->version != BAKE_VERSION || header->sourceHash != m_sourceHash) {
+        m_data.reset();
+        return false;
+    }
+
+    std::streamsize offset = sizeof(BakeHeader);
+    for(unsigned int i = 0; i < header->count; ++i) {
+        if(offset + (std::streamsize)sizeof(BakeEntryHeader) > size) break;
+        const BakeEntryHeader* entry = reinterpret_cast<const BakeEntryHeader*>(buffer + offset);
+        offset += sizeof(BakeEntryHeader);
+        if(offset + entry->size > size) break;
+
+        m_baked.push_back(btOptimizedBvh::deSerializeInPlace(buffer + offset, entry->size, false));
+        offset += align(entry->size);
+    }
+
+    if(m_baked.size() != header->count) {
+        std::cerr << "Warning: " << m_filename << " is truncated, rebuilding collision data." << std::endl;
+        m_baked.clear();
+        m_data.reset();
+        return false;
+    }
+    return true;
+}
+
+void CollisionBake::save() {
+    if(std::find(m_built.begin(), m_built.end(), nullptr) != m_built.end()) {
+        std::cerr << "Warning: not all meshes of " << m_levelFilename << " were built, not writing " << m_filename << "." << std::endl;
+        m_built.clear();
+        return;
+    }
+
+    if(m_sourceHash == 0) {
+        m_sourceHash = hashFile(m_levelFilename) ^ BAKE_VERSION;
+    }
+
+    std::ofstream stream(m_filename, std::ios::binary);
+    if(!stream) {
+        std::cerr << "Warning: could not write " << m_filename << "." << std::endl;
+        return;
+    }
+
+    BakeHeader header;
+    std::memcpy(header.magic, BAKE_MAGIC, sizeof(BAKE_MAGIC));
+    header.version = BAKE_VERSION;
+    header.count = m_built.size();
+    header.sourceHash = m_sourceHash;
+    header.reserved = 0;
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for(auto bvh : m_built) {
+        BakeEntryHeader entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.size = bvh->calculateSerializeBufferSize();
+
+        char* buffer = static_cast<char*>(btAlignedAlloc(align(entry.size), BAKE_ALIGNMENT));
+        std::memset(buffer, 0, align(entry.size));
+        bvh->serializeInPlace(buffer, entry.size, false);
+
+        stream.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        stream.write(buffer, align(entry.size));
+        btAlignedFree(buffer);
+    }
+
+    m_built.clear();
+}
+
+void CollisionBake::expect(unsigned int count) {
+    if(isLoaded() && m_baked.size() != count) {
+        std::cerr << "Warning: " << m_filename << " has " << m_baked.size() << " meshes instead of " << count << ", rebuilding collision data." << std::endl;
+        m_baked.clear();
+        m_data.reset();
+    }
+    if(!isLoaded()) {
+        m_built.assign(count, nullptr);
+    }
+}
+
+btOptimizedBvh* CollisionBake::baked(unsigned int index) const {
+    return index < m_baked.size() ? m_baked[index] : nullptr;
+}
+
+void CollisionBake::add(unsigned int index, btOptimizedBvh* bvh) {
+    if(index < m_built.size()) {
+        m_built[index] = bvh;
+    }
+}
+
+bool CollisionBake::isLoaded() const {
+    return m_data != nullptr;
+}
+
+bool CollisionBake::isDirty() const {
+    return std::find_if(m_built.begin(), m_built.end(), [](btOptimizedBvh* bvh) { return bvh != nullptr; }) != m_built.end();
+}
+
+std::shared_ptr<void> CollisionBake::data() const {
+    return m_data;
+}
@@ -0,0 +1,50 @@
+#ifndef COLLISIONBAKE_HPP
+#define COLLISIONBAKE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <btBulletDynamicsCommon.h>
+
+// Keeps the optimized BVHs of a level's triangle meshes in a file next to
+// the level (<level>.cooked), so they don't have to be rebuilt on every
+// load. The BVHs are stored in bullet's in-place serialization format and
+// used straight from the loaded buffer. The file records a hash of the
+// level file and is ignored and rewritten once the level changes.
+class CollisionBake {
+public:
+    CollisionBake(const std::string& levelFilename);
+
+    bool load();
+    void save();
+
+    // Sets the number of meshes in the level. Baked BVHs that don't match
+    // it are dropped. Call after load() and before using the slots below.
+    void expect(unsigned int count);
+    // Returns the baked BVH of a mesh, or nullptr if it has to be built.
+    btOptimizedBvh* baked(unsigned int index) const;
+    // Records a freshly built BVH to be written by save(). Different
+    // indices may be added from different threads.
+    void add(unsigned int index, btOptimizedBvh* bvh);
+
+    // FNV-1a over the whole file
+    static unsigned long long hashFile(const std::string& filename);
+
+    bool isLoaded() const;
+    bool isDirty() const;
+
+    // Buffer the baked BVHs live in, shapes using them must keep it alive.
+    std::shared_ptr<void> data() const;
+
+private:
+    std::string m_levelFilename;
+    std::string m_filename;
+    unsigned long long m_sourceHash;
+
+    std::shared_ptr<void> m_data;
+    std::vector<btOptimizedBvh*> m_baked;
+
+    std::vector<btOptimizedBvh*> m_built;
+};
+
+#endif
@@ -3,36 +3,186 @@
 #include "State.hpp"
 #include "Root.hpp"
 
-CollisionShape::CollisionShape() {
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+CollisionShape::Cooking CollisionShape::cooking = CollisionShape::EDGE_CHAIN;
+CollisionBake* CollisionShape::bake = nullptr;
+
+// depth of the extruded shapes, bodies live at z = 0
+static const float SHAPE_DEPTH = 1.f;
+// half thickness of the boxes in an edge chain
+static const float EDGE_THICKNESS = 0.01f;
+static const float SHAPE_MARGIN = 0.005f;
+
+static float cross(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+static float signedArea(const std::vector<glm::vec2>& points) {
+    float area = 0;
+    for(unsigned int i = 0; i < points.size(); ++i) {
+        area += cross(points[i], points[(i+1)%points.size()]);
+    }
+    return area / 2;
+}
+
+static bool isConvex(const std::vector<glm::vec2>& points) {
+    for(unsigned int i = 0; i < points.size(); ++i) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[(i+1)%points.size()];
+        const glm::vec2& c = points[(i+2)%points.size()];
+        if(cross(b - a, c - b) < -1e-6) return false;
+    }
+    return true;
+}
+
+static bool pointInTriangle(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+    return cross(b - a, p - a) >= 0 && cross(c - b, p - b) >= 0 && cross(a - c, p - c) >= 0;
+}
+
+// Ear clipping, returns counter-clockwise triangles
+static std::vector<std::vector<glm::vec2>> triangulate(std::vector<glm::vec2> polygon) {
+    std::vector<std::vector<glm::vec2>> triangles;
+    if(signedArea(polygon) < 0) {
+        std::reverse(polygon.begin(), polygon.end());
+    }
+
+    while(polygon.size() > 3) {
+        unsigned int n = polygon.size();
+        bool clipped = false;
+        for(unsigned int i = 0; !clipped && i < n; ++i) {
+            const glm::vec2& prev = polygon[(i+n-1)%n];
+            const glm::vec2& cur  = polygon[i];
+            const glm::vec2& next = polygon[(i+1)%n];
+
+            float turn = cross(cur - prev, next - cur);
+            if(fabs(turn) < 1e-6) {
+                // collinear point, just drop it
+                polygon.erase(polygon.begin() + i);
+                clipped = true;
+            } else if(turn > 0) {
+                bool ear = true;
+                for(unsigned int k = 0; ear && k < n; ++k) {
+                    if(k == i || k == (i+1)%n || k == (i+n-1)%n) continue;
+                    ear = !pointInTriangle(polygon[k], prev, cur, next);
+                }
+                if(ear) {
+                    triangles.push_back({prev, cur, next});
+                    polygon.erase(polygon.begin() + i);
+                    clipped = true;
+                }
+            }
+        }
+        if(!clipped) {
+            std::cerr << "Warning: could not triangulate self-intersecting collision polygon." << std::endl;
+            break;
+        }
+    }
+
+    if(polygon.size() == 3 && signedArea(polygon) > 1e-6) {
+        triangles.push_back(polygon);
+    }
+    return triangles;
+}
+
+// Hertel-Mehlhorn: merge pieces across shared edges while the result stays convex
+static std::vector<std::vector<glm::vec2>> mergeConvex(std::vector<std::vector<glm::vec2>> pieces) {
+    bool merged = true;
+    while(merged) {
+        merged = false;
+        for(unsigned int p = 0; !merged && p < pieces.size(); ++p) {
+            for(unsigned int q = p + 1; !merged && q < pieces.size(); ++q) {
+                const auto& P = pieces[p];
+                const auto& Q = pieces[q];
+                for(unsigned int i = 0; !merged && i < P.size(); ++i) {
+                    for(unsigned int j = 0; !merged && j < Q.size(); ++j) {
+                        if(P[i] != Q[(j+1)%Q.size()] || P[(i+1)%P.size()] != Q[j]) continue;
+
+                        // walk P from its edge end back to its start, then the rest of Q
+                        std::vector<glm::vec2> joined;
+                        for(unsigned int k = 0; k < P.size(); ++k) joined.push_back(P[(i+1+k)%P.size()]);
+                        for(unsigned int k = 2; k < Q.size(); ++k) joined.push_back(Q[(j+k)%Q.size()]);
+
+                        if(isConvex(joined)) {
+                            pieces[p] = joined;
+                            pieces.erase(pieces.begin() + q);
+                            merged = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return pieces;
+}
+
+CollisionShape::CollisionShape()
+    : m_bakeIndex(0) {
     m_zLevel = 500;
 }
 
+CollisionShape::~CollisionShape() {
+    deleteChildShapes();
+}
+
 std::string CollisionShape::getTypeName() const {
     return "CollisionShape";
 }
 
+Entity::TypeFlag CollisionShape::getTypeFlag() const {
+    return TYPE_COLLISION_SHAPE;
+}
+
+std::shared_ptr<Entity> CollisionShape::clone() const {
+    auto shape = std::make_shared<CollisionShape>();
+    shape->copySavedFields(*this);
+    shape->m_shapes = m_shapes;
+    return shape;
+}
+
+bool CollisionShape::isScenery() const {
+    return true;
+}
+
 void CollisionShape::onDraw(sf::RenderTarget& target) {
     if(m_state != &Root().editor_state) return;
 
+    // drawn as plain triangles so the overlay is baked with the scenery
+    SpriteBatch& batch = m_state->spriteBatch();
     auto pix = m_state->getPixelSize();
+    float lineWidth = 2 * pix;
+    float pointSize = 10 * pix;
 
     for(auto points : m_shapes) {
-        sf::ConvexShape shape(points.size());
         for(unsigned int i = 0; i < points.size(); ++i) {
-            shape.setPoint(i, sf::Vector2f(points[i].x * m_scale.x, points[i].y * m_scale.y));
+            sf::Vector2f a(m_position.x + points[i].x * m_scale.x, m_position.y + points[i].y * m_scale.y);
+            const glm::vec2& next = points[(i + 1) % points.size()];
+            sf::Vector2f b(m_position.x + next.x * m_scale.x, m_position.y + next.y * m_scale.y);
+
+            sf::Vector2f d = b - a;
+            float length = std::sqrt(d.x * d.x + d.y * d.y);
+            if(length <= 0) continue;
+            sf::Vector2f n(-d.y / length * lineWidth / 2, d.x / length * lineWidth / 2);
+
+            sf::Vertex line[6] = {
+                sf::Vertex(a - n, sf::Color::Cyan), sf::Vertex(b - n, sf::Color::Cyan), sf::Vertex(b + n, sf::Color::Cyan),
+                sf::Vertex(a - n, sf::Color::Cyan), sf::Vertex(b + n, sf::Color::Cyan), sf::Vertex(a + n, sf::Color::Cyan)
+            };
+            batch.draw(line, 6);
         }
-        shape.setPosition(m_position.x, m_position.y);
-        shape.setOutlineThickness(2 * m_state->getPixelSize());
-        shape.setOutlineColor(sf::Color::Cyan);
-        shape.setFillColor(sf::Color::Transparent);
-        target.draw(shape);
 
-        int pointSize = 10;
         for(auto p : points) {
-            sf::RectangleShape r(sf::Vector2f(pointSize*pix, pointSize*pix));
-            r.setPosition(m_position.x + p.x * m_scale.x - pointSize / 2 * pix, m_position.y + p.y * m_scale.y - pointSize / 2 * pix);
-            r.setFillColor(sf::Color::Magenta);
-            target.draw(r);
+            sf::Vector2f c(m_position.x + p.x * m_scale.x, m_position.y + p.y * m_scale.y);
+            sf::Vector2f h(pointSize / 2, pointSize / 2);
+            sf::Vector2f v(pointSize / 2, -pointSize / 2);
+
+            sf::Vertex quad[6] = {
+                sf::Vertex(c - h, sf::Color::Magenta), sf::Vertex(c + v, sf::Color::Magenta), sf::Vertex(c + h, sf::Color::Magenta),
+                sf::Vertex(c - h, sf::Color::Magenta), sf::Vertex(c + h, sf::Color::Magenta), sf::Vertex(c - v, sf::Color::Magenta)
+            };
+            batch.draw(quad, 6);
         }
     }
 }
@@ -40,21 +190,89 @@ void CollisionShape::onDraw(sf::RenderTarget& target) {
 void CollisionShape::onInitialize() {
     btCompoundShape* compound = new btCompoundShape();
 
-    for(auto points : m_shapes) {
-        btTriangleMesh* mesh = new btTriangleMesh();
-        for(unsigned int i = 0; i < points.size(); ++i) {
-            const glm::vec2& p = points[i] * m_scale;
-            const glm::vec2& q = points[(i+1)%points.size()] * m_scale;
+    unsigned int mesh = m_bakeIndex;
+    for(auto shape : m_shapes) {
+        if(shape.size() < 2) continue;
+
+        std::vector<glm::vec2> points;
+        for(auto p : shape) points.push_back(p * m_scale);
+
+        if(cooking == TRIANGLE_MESH) {
+            cookTriangleMesh(compound, points, mesh++);
+        } else if(cooking == CONVEX_PIECES) {
+            cookConvexPieces(compound, points);
+        } else {
+            cookEdgeChain(compound, points);
+        }
+    }
+
+    m_physicsShape = std::shared_ptr<btCollisionShape>(compound);
+}
+
+void CollisionShape::cookTriangleMesh(btCompoundShape* compound, const std::vector<glm::vec2>& points, unsigned int bakeIndex) {
+    btTriangleMesh* mesh = new btTriangleMesh();
+    for(unsigned int i = 0; i < points.size(); ++i) {
+        const glm::vec2& p = points[i];
+        const glm::vec2& q = points[(i+1)%points.size()];
 
-            mesh->addTriangle(btVector3(p.x, p.y, 0), btVector3(q.x, q.y, 0), btVector3(q.x, q.y, 1));
-            mesh->addTriangle(btVector3(q.x, q.y, 1), btVector3(p.x, p.y, 1), btVector3(p.x, p.y, 0));
+        mesh->addTriangle(btVector3(p.x, p.y, 0), btVector3(q.x, q.y, 0), btVector3(q.x, q.y, SHAPE_DEPTH));
+        mesh->addTriangle(btVector3(q.x, q.y, SHAPE_DEPTH), btVector3(p.x, p.y, SHAPE_DEPTH), btVector3(p.x, p.y, 0));
+    }
+
+    btBvhTriangleMeshShape* shape;
+    btOptimizedBvh* baked = bake ? bake->baked(bakeIndex) : nullptr;
+    if(baked) {
+        shape = new btBvhTriangleMeshShape(mesh, true, false);
+        shape->setOptimizedBvh(baked);
+        m_bakedData = bake->data();
+    } else {
+        shape = new btBvhTriangleMeshShape(mesh, true);
+        if(bake) bake->add(bakeIndex, shape->getOptimizedBvh());
+    }
+
+    compound->addChildShape(btTransform::getIdentity(), shape);
+    m_meshes.push_back(mesh);
+    m_childShapes.push_back(shape);
+}
+
+void CollisionShape::cookConvexPieces(btCompoundShape* compound, const std::vector<glm::vec2>& points) {
+    for(auto piece : mergeConvex(triangulate(points))) {
+        btConvexHullShape* hull = new btConvexHullShape();
+        for(auto p : piece) {
+            hull->addPoint(btVector3(p.x, p.y, -SHAPE_DEPTH / 2), false);
+            hull->addPoint(btVector3(p.x, p.y,  SHAPE_DEPTH / 2), false);
         }
+        hull->recalcLocalAabb();
+        hull->setMargin(SHAPE_MARGIN);
+        compound->addChildShape(btTransform::getIdentity(), hull);
+        m_childShapes.push_back(hull);
+    }
+}
 
-        btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(mesh, true);
-        compound->addChildShape(btTransform::getIdentity(), shape);
+void CollisionShape::cookEdgeChain(btCompoundShape* compound, const std::vector<glm::vec2>& points) {
+    for(unsigned int i = 0; i < points.size(); ++i) {
+        const glm::vec2& p = points[i];
+        const glm::vec2& q = points[(i+1)%points.size()];
+        glm::vec2 d = q - p;
+        float length = glm::length(d);
+        if(length < 1e-6) continue;
+
+        // overlap neighbouring boxes a bit so corners are closed
+        btBoxShape* box = new btBoxShape(btVector3(length / 2 + EDGE_THICKNESS, EDGE_THICKNESS, SHAPE_DEPTH / 2));
+        box->setMargin(SHAPE_MARGIN);
+
+        glm::vec2 center = (p + q) * 0.5f;
+        btTransform transform(btQuaternion(btVector3(0, 0, 1), atan2(d.y, d.x)), btVector3(center.x, center.y, 0));
+        compound->addChildShape(transform, box);
+        m_childShapes.push_back(box);
     }
+}
 
-    m_physicsShape = compound;
+void CollisionShape::deleteChildShapes() {
+    for(auto shape : m_childShapes) delete shape;
+    for(auto mesh : m_meshes) delete mesh;
+    m_childShapes.clear();
+    m_meshes.clear();
 }
 
 void CollisionShape::onAdd(State *state) {
@@ -63,3 +281,15 @@ void CollisionShape::onAdd(State *state) {
 std::vector<std::vector<glm::vec2>>& CollisionShape::shapes() {
     return m_shapes;
 }
+
+unsigned int CollisionShape::meshCount() const {
+    unsigned int count = 0;
+    for(auto& shape : m_shapes) {
+        if(shape.size() >= 2) count++;
+    }
+    return count;
+}
+
+void CollisionShape::setBakeIndex(unsigned int index) {
+    m_bakeIndex = index;
+}
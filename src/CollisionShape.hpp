@@ -12,11 +12,27 @@
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
 
 #include "Entity.hpp"
+#include "CollisionBake.hpp"
 
 class CollisionShape : public Entity {
 public:
+    // How the polygons are turned into bullet shapes
+    enum Cooking {
+        TRIANGLE_MESH,  // edges extruded into a concave triangle mesh
+        CONVEX_PIECES,  // polygons split into convex prisms (solid inside)
+        EDGE_CHAIN      // one thin box per edge (hollow, like the mesh)
+    };
+
+    static Cooking cooking;
+    // baked BVHs for triangle meshes of the level being loaded, if any
+    static CollisionBake* bake;
+
     CollisionShape();
+    ~CollisionShape();
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
+    std::shared_ptr<Entity> clone() const override;
+    bool isScenery() const override;
 
     // void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget& target) override;
@@ -25,6 +41,10 @@ public:
 
     std::vector<std::vector<glm::vec2>>& shapes();
 
+    // triangle meshes this shape cooks, and its first slot in the bake
+    unsigned int meshCount() const;
+    void setBakeIndex(unsigned int index);
+
     template<class Archive>
     void serialize(Archive& ar) {
         ar(cereal::make_nvp("entity", cereal::base_class<Entity>(this)));
@@ -32,7 +52,17 @@ public:
     }
 
 private:
+    void cookTriangleMesh(btCompoundShape* compound, const std::vector<glm::vec2>& points, unsigned int bakeIndex);
+    void cookConvexPieces(btCompoundShape* compound, const std::vector<glm::vec2>& points);
+    void cookEdgeChain(btCompoundShape* compound, const std::vector<glm::vec2>& points);
+    void deleteChildShapes();
+
     std::vector<std::vector<glm::vec2>> m_shapes;
+
+    std::vector<btCollisionShape*> m_childShapes;
+    std::vector<btTriangleMesh*> m_meshes;
+    std::shared_ptr<void> m_bakedData;
+    unsigned int m_bakeIndex;
 };
 
 #endif
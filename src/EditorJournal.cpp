@@ -0,0 +1,363 @@
+#include "EditorJournal.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/vector.hpp>
+#include <cereal/types/memory.hpp>
+
+#include "Entity.hpp"
+#include "CollisionBake.hpp"
+
+static const char JOURNAL_MAGIC[8] = {'A', 'R', 'A', 'C', 'J', 'R', 'N', 'L'};
+static const uint32_t JOURNAL_VERSION = 1;
+// records appended before the journal is compacted
+static const int COMPACT_INTERVAL = 64;
+// anything bigger is a torn write, not an entity
+static const uint32_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    unsigned long long baseHash;
+};
+
+struct JournalRecordHeader {
+    uint32_t kind;
+    uint32_t id;
+    uint32_t size;
+    uint32_t checksum;
+};
+
+static uint32_t checksum(const std::string& data) {
+    uint32_t hash = 2166136261u;
+    for(char c : data) {
+        hash ^= (unsigned char)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static unsigned long long baseHash(const std::string& filename) {
+    return CollisionBake::hashFile(filename) ^ JOURNAL_VERSION;
+}
+
+static void writeHeader(std::ostream& stream, unsigned long long hash) {
+    JournalHeader header;
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = JOURNAL_VERSION;
+    header.reserved = 0;
+    header.baseHash = hash;
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+// rename() does not replace existing files everywhere
+static bool replaceFile(const std::string& from, const std::string& to) {
+    if(std::rename(from.c_str(), to.c_str()) == 0) return true;
+    std::remove(to.c_str());
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+EditorJournal::EditorJournal()
+    : m_nextId(0),
+      m_working(false),
+      m_quit(false),
+      m_baseHash(0),
+      m_appended(0) {
+    m_thread = std::thread(&EditorJournal::run, this);
+}
+
+EditorJournal::~EditorJournal() {
+    close();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+bool EditorJournal::open(const std::string& filename, std::vector<std::shared_ptr<Entity>>& entities) {
+    // a save of this level might still be under way
+    flush();
+
+    m_filename = filename;
+    m_nextId = entities.size();
+
+    Records records;
+    bool recovered = read(filename, records) && !records.empty();
+
+    std::vector<std::shared_ptr<Entity>> result;
+    std::vector<uint32_t> ids;
+    if(recovered) {
+        std::map<uint32_t, std::shared_ptr<Entity>> byId;
+        for(unsigned int i = 0; i < entities.size(); ++i) {
+            byId[i] = entities[i];
+        }
+
+        for(auto& pair : records) {
+            const Record& r = pair.second;
+            if(r.kind == Record::ENTITY) {
+                std::shared_ptr<Entity> entity;
+                std::istringstream stream(r.data);
+                cereal::PortableBinaryInputArchive ar(stream);
+                ar(entity);
+                byId[r.id] = entity;
+            } else {
+                byId.erase(r.id);
+            }
+            m_nextId = std::max(m_nextId, r.id + 1);
+        }
+
+        // base entities keep their place, new ones follow in creation order
+        for(auto& pair : byId) {
+            result.push_back(pair.second);
+            ids.push_back(pair.first);
+        }
+        entities = result;
+    } else {
+        for(unsigned int i = 0; i < entities.size(); ++i) {
+            ids.push_back(i);
+        }
+    }
+
+    m_ids.clear();
+    for(unsigned int i = 0; i < entities.size(); ++i) {
+        m_ids[entities[i].get()] = ids[i];
+    }
+
+    Job job;
+    job.kind = recovered ? Job::RESUME : Job::BEGIN;
+    job.filename = filename;
+    push(job);
+    return recovered;
+}
+
+void EditorJournal::close() {
+    if(!isOpen()) return;
+
+    Job job;
+    job.kind = Job::CLOSE;
+    push(job);
+    flush();
+
+    m_filename = "";
+    m_ids.clear();
+}
+
+bool EditorJournal::isOpen() const {
+    return !m_filename.empty();
+}
+
+void EditorJournal::record(std::shared_ptr<Entity> entity) {
+    if(!isOpen() || !entity) return;
+
+    auto it = m_ids.find(entity.get());
+    if(it == m_ids.end()) {
+        it = m_ids.insert(std::make_pair(entity.get(), m_nextId++)).first;
+    }
+
+    std::ostringstream stream;
+    {
+        cereal::PortableBinaryOutputArchive ar(stream);
+        ar(entity);
+    }
+
+    Job job;
+    job.kind = Job::RECORD;
+    job.record.kind = Record::ENTITY;
+    job.record.id = it->second;
+    job.record.data = stream.str();
+    push(job);
+}
+
+void EditorJournal::erase(std::shared_ptr<Entity> entity) {
+    auto it = m_ids.find(entity.get());
+    if(!isOpen() || it == m_ids.end()) return;
+
+    Job job;
+    job.kind = Job::RECORD;
+    job.record.kind = Record::REMOVE;
+    job.record.id = it->second;
+    push(job);
+    m_ids.erase(it);
+}
+
+void EditorJournal::save(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities) {
+    Job job;
+    job.kind = Job::SAVE;
+    job.filename = filename;
+
+    m_filename = filename;
+    m_ids.clear();
+    for(auto entity : entities) {
+        auto copy = entity->clone();
+        if(!copy) {
+            std::cerr << "Warning: " << entity->getTypeName() << " entities are not saved with levels, skipping." << std::endl;
+            continue;
+        }
+        m_ids[entity.get()] = job.entities.size();
+        job.entities.push_back(copy);
+    }
+    m_nextId = job.entities.size();
+
+    push(job);
+}
+
+void EditorJournal::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_jobs.empty() && !m_working; });
+}
+
+std::string EditorJournal::journalFilename(const std::string& filename) {
+    return filename + ".journal";
+}
+
+bool EditorJournal::read(const std::string& filename, Records& records) {
+    std::ifstream stream(journalFilename(filename), std::ios::binary);
+    if(!stream) return false;
+
+    JournalHeader header;
+    if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.version != JOURNAL_VERSION) return false;
+    // the level was saved since
+    if(header.baseHash != baseHash(filename)) return false;
+
+    // a crash can leave the last record incomplete, it is dropped
+    JournalRecordHeader r;
+    while(stream.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+        if(r.size > MAX_RECORD_SIZE) break;
+
+        Record record;
+        record.kind = r.kind;
+        record.id = r.id;
+        record.data.resize(r.size);
+        if(!stream.read(&record.data[0], r.size) || checksum(record.data) != r.checksum) break;
+
+        records[record.id] = record;
+    }
+    return true;
+}
+
+void EditorJournal::push(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void EditorJournal::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        m_wake.wait(lock, [this]() { return !m_jobs.empty() || m_quit; });
+        if(m_jobs.empty()) break;
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_working = true;
+        lock.unlock();
+
+        if(job.kind == Job::BEGIN) {
+            begin(job.filename);
+        } else if(job.kind == Job::RESUME) {
+            m_journalFilename = journalFilename(job.filename);
+            m_baseHash = baseHash(job.filename);
+            m_live.clear();
+            read(job.filename, m_live);
+            // rewriting the journal also drops a torn record at its end
+            compact();
+        } else if(job.kind == Job::RECORD) {
+            append(job.record);
+        } else if(job.kind == Job::SAVE) {
+            std::string tmp = job.filename + ".tmp";
+            std::ofstream stream(tmp, std::ios::binary);
+            {
+                cereal::PortableBinaryOutputArchive ar(stream);
+                ar(cereal::make_nvp("entities", job.entities));
+            }
+            job.entities.clear();
+            stream.close();
+            if(!stream || !replaceFile(tmp, job.filename)) {
+                std::cerr << "Warning: could not write " << job.filename << "." << std::endl;
+            } else {
+                // saved under a new name, e.g. the untitled level, the old journal is covered by it
+                if(!m_journalFilename.empty() && m_journalFilename != journalFilename(job.filename)) {
+                    m_stream.close();
+                    std::remove(m_journalFilename.c_str());
+                }
+                begin(job.filename);
+            }
+        } else if(job.kind == Job::CLOSE) {
+            if(m_stream.is_open()) compact();
+            m_stream.close();
+            m_journalFilename = "";
+        }
+
+        lock.lock();
+        m_working = false;
+        if(m_jobs.empty()) m_idle.notify_all();
+    }
+}
+
+void EditorJournal::begin(const std::string& filename) {
+    m_stream.close();
+    m_journalFilename = journalFilename(filename);
+    m_baseHash = baseHash(filename);
+    m_live.clear();
+    m_appended = 0;
+
+    m_stream.open(m_journalFilename, std::ios::binary | std::ios::trunc);
+    writeHeader(m_stream, m_baseHash);
+    m_stream.flush();
+    if(!m_stream) {
+        std::cerr << "Warning: could not write " << m_journalFilename << ", edits are not autosaved." << std::endl;
+    }
+}
+
+void EditorJournal::append(const Record& record) {
+    if(!m_stream.is_open()) return;
+
+    JournalRecordHeader header;
+    header.kind = record.kind;
+    header.id = record.id;
+    header.size = record.data.size();
+    header.checksum = checksum(record.data);
+    m_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_stream.write(record.data.data(), record.data.size());
+    m_stream.flush();
+
+    m_live[record.id] = record;
+    if(++m_appended >= COMPACT_INTERVAL) {
+        compact();
+    }
+}
+
+void EditorJournal::compact() {
+    std::string tmp = m_journalFilename + ".tmp";
+    std::ofstream stream(tmp, std::ios::binary | std::ios::trunc);
+    writeHeader(stream, m_baseHash);
+    for(auto& pair : m_live) {
+        const Record& record = pair.second;
+        JournalRecordHeader header;
+        header.kind = record.kind;
+        header.id = record.id;
+        header.size = record.data.size();
+        header.checksum = checksum(record.data);
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(record.data.data(), record.data.size());
+    }
+    stream.close();
+
+    m_stream.close();
+    if(!stream || !replaceFile(tmp, m_journalFilename)) {
+        std::cerr << "Warning: could not compact " << m_journalFilename << "." << std::endl;
+    }
+    m_stream.open(m_journalFilename, std::ios::binary | std::ios::app);
+    m_appended = 0;
+}
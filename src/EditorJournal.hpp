@@ -0,0 +1,112 @@
+#ifndef EDITORJOURNAL_HPP
+#define EDITORJOURNAL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Entity;
+
+// Autosave for the editor. Every committed edit is appended to a journal
+// next to the level (<level>.journal) as the new serialized state of the
+// touched entity, or its removal. Entities are identified by their index
+// in the saved level, new ones count on from there. The journal records a
+// hash of the level it applies to, so it is ignored once the level is
+// saved.
+//
+// All file writes happen on a background thread, which also compacts the
+// journal down to the latest record of each entity every now and then.
+// The editor thread only serializes the single entity that changed, saves
+// hand copies of the entities to the background thread.
+class EditorJournal {
+public:
+    EditorJournal();
+    ~EditorJournal();
+
+    // Starts journaling edits of the level in filename, just read into
+    // entities. Edits left over from an earlier session are applied to
+    // entities first, returns whether there were any.
+    bool open(const std::string& filename, std::vector<std::shared_ptr<Entity>>& entities);
+    void close();
+    bool isOpen() const;
+
+    void record(std::shared_ptr<Entity> entity);
+    void erase(std::shared_ptr<Entity> entity);
+
+    // Writes entities to filename in the background, the journal starts
+    // over from the saved level. Entities are cloned, the editor may go on
+    // changing them right away.
+    void save(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities);
+
+    // waits until everything queued is on disk
+    void flush();
+
+private:
+    struct Record {
+        enum Kind {
+            ENTITY = 1,
+            REMOVE = 2
+        };
+
+        uint32_t kind;
+        uint32_t id;
+        std::string data;
+    };
+
+    struct Job {
+        enum Kind {
+            BEGIN,      // start a fresh journal for the level
+            RESUME,     // keep appending to the existing journal
+            RECORD,
+            SAVE,
+            CLOSE
+        };
+
+        Kind kind;
+        std::string filename;
+        Record record;
+        std::vector<std::shared_ptr<Entity>> entities; // SAVE
+    };
+
+    typedef std::map<uint32_t, Record> Records;
+
+    static std::string journalFilename(const std::string& filename);
+    static bool read(const std::string& filename, Records& records);
+
+    void push(Job job);
+    void run();
+    void begin(const std::string& filename);
+    void append(const Record& record);
+    void compact();
+
+    // editor thread
+    std::string m_filename;
+    std::map<const Entity*, uint32_t> m_ids;
+    uint32_t m_nextId;
+
+    // shared
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Job> m_jobs;
+    bool m_working;
+    bool m_quit;
+
+    // writer thread
+    std::string m_journalFilename;
+    std::ofstream m_stream;
+    unsigned long long m_baseHash;
+    Records m_live;
+    int m_appended;
+
+    std::thread m_thread;
+};
+
+#endif
@@ -12,10 +12,14 @@
 #include "Root.hpp"
 #include "CollisionShape.hpp"
 #include "Marker.hpp"
+#include "LevelFile.hpp"
 
 #define GLM_FORCE_RADIANS
 #include <glm/gtx/vector_angle.hpp>
 
+// where edits are journaled before the level gets a name
+static const std::string UNTITLED_LEVEL = "levels/untitled.dat";
+
 EditorState::EditorState() {
     m_zoom = 6;
     m_insertModeCurrentType = WALL;
@@ -58,6 +62,14 @@ EditorState::EditorState() {
 
 void EditorState::onInit() {
     setStatus("Press F1 for Help.");
+
+    std::vector<std::shared_ptr<Entity>> entities;
+    if(m_journal.open(UNTITLED_LEVEL, entities)) {
+        for(auto entity : entities) {
+            add(entity);
+        }
+        setStatus("Recovered unsaved edits. Press F1 for Help.");
+    }
     addPlayer();
 }
 
@@ -98,6 +110,7 @@ void EditorState::onHandleEvent(sf::Event& event) {
             if(m_mode == NONE && m_currentEntity) {
                 setStatus("Setting metadata: " + std::to_string(num));
                 m_currentEntity->setMetadata(num);
+                journal(m_currentEntity);
             }
         }
     }
@@ -130,6 +143,7 @@ void EditorState::onHandleEvent(sf::Event& event) {
                 if(c->shapes().size() > 0 && c->shapes()[0].size() > 0) {
                     c->shapes()[0].erase(c->shapes()[0].begin() + m_addPointInsertIndex);
                     m_addPointInsertIndex = (m_addPointInsertIndex - 1) % c->shapes()[0].size();
+                    journal(c);
                 }
             }
         } else {
@@ -147,6 +161,7 @@ void EditorState::onHandleEvent(sf::Event& event) {
                 if(m_mode == NONE) startMode(INSERT);
             } else if(event.key.code == sf::Keyboard::BackSpace || event.key.code == sf::Keyboard::Delete) {
                 if(m_mode == NONE && m_currentEntity) {
+                    m_journal.erase(m_currentEntity);
                     remove(m_currentEntity);
                     m_currentEntity.reset();
                     setStatus("Deleted.");
@@ -155,12 +170,14 @@ void EditorState::onHandleEvent(sf::Event& event) {
                 if(m_currentEntity) {
                     m_currentZLevel = m_currentEntity->zLevel() + 1;
                     m_currentEntity->setZLevel(m_currentZLevel);
+                    journal(m_currentEntity);
                     setStatus("Z-Level ++ " + std::to_string(m_currentZLevel));
                 }
             } else if(event.key.code == sf::Keyboard::Subtract) {
                 if(m_currentEntity) {
                     m_currentZLevel = m_currentEntity->zLevel() - 1;
                     m_currentEntity->setZLevel(m_currentZLevel);
+                    journal(m_currentEntity);
                     setStatus("Z-Level -- " + std::to_string(m_currentZLevel));
                 }
             } else if(event.key.code == sf::Keyboard::C) {
@@ -191,6 +208,7 @@ void EditorState::onHandleEvent(sf::Event& event) {
                     if(m_currentEntity && m_currentEntity->getTypeName() == "CollisionShape") {
                         auto c = std::static_pointer_cast<CollisionShape>(m_currentEntity);
                         std::reverse(c->shapes()[0].begin(), c->shapes()[0].end());
+                        journal(c);
                         setStatus("Point order reversed.");
                     } else {
                         setStatus("Please select a CollisionShape to reverse the point order.");
@@ -280,6 +298,12 @@ void EditorState::onDraw(sf::RenderTarget& target) {
 
     setView(target);
 
+    // the collision shape overlays are sized in pixels
+    if(m_pixelSize != m_sceneryPixelSize) {
+        m_sceneryPixelSize = m_pixelSize;
+        m_scenery.invalidate();
+    }
+
     drawEntities(target);
 
     // draw current entity highlight
@@ -317,31 +341,33 @@ void EditorState::onDraw(sf::RenderTarget& target) {
 
 
     if(m_mode == FOLLOW) {
-        // draw the number above each entity
+        // draw the number above each entity, all boxes first and then all
+        // numbers, so each takes a single draw call
+        auto& font = *Root().resources.getFont("mono");
+        int b = 2;
+        m_overlayBatch.begin(target);
         for(auto pair: m_entityNumbers) {
             auto p = pair.first->position();
-
-            sf::Text text;
-            text.setFont(* Root().resources.getFont("mono"));
-            text.setPosition(p.x, p.y);
-            text.setString(pair.second);
-            text.setColor(sf::Color(0, 0, 0));
-            text.setCharacterSize(13);
-            text.scale(m_pixelSize, m_pixelSize);
-
-            int b = 2;
-            auto bounds = text.getLocalBounds();
-            sf::RectangleShape shape;
-            shape.setSize(sf::Vector2f(bounds.width + 2 * b, bounds.height + 2 * b));
-            shape.setPosition(sf::Vector2f((bounds.left-b) * m_pixelSize + p.x, (bounds.top-b) * m_pixelSize + p.y));
-            shape.scale(m_pixelSize, m_pixelSize);
-            shape.setFillColor(sf::Color(255, 200, 50, 200));
-            shape.setOutlineColor(sf::Color(255, 200, 50));
-            shape.setOutlineThickness(1);
-
-            target.draw(shape);
-            target.draw(text);
+            auto bounds = Root().text.layout(font, 13, pair.second).bounds;
+            sf::Transform transform;
+            transform.translate(p.x, p.y).scale(m_pixelSize, m_pixelSize);
+
+            // box with a one pixel outline around it
+            sf::FloatRect box(bounds.left - b, bounds.top - b, bounds.width + 2 * b, bounds.height + 2 * b);
+            sf::Color outline(255, 200, 50);
+            m_overlayBatch.drawRect(box, sf::Color(255, 200, 50, 200), transform);
+            m_overlayBatch.drawRect(sf::FloatRect(box.left - 1, box.top - 1, box.width + 2, 1), outline, transform);
+            m_overlayBatch.drawRect(sf::FloatRect(box.left - 1, box.top + box.height, box.width + 2, 1), outline, transform);
+            m_overlayBatch.drawRect(sf::FloatRect(box.left - 1, box.top, 1, box.height), outline, transform);
+            m_overlayBatch.drawRect(sf::FloatRect(box.left + box.width, box.top, 1, box.height), outline, transform);
         }
+        for(auto pair: m_entityNumbers) {
+            auto p = pair.first->position();
+            sf::Transform transform;
+            transform.translate(p.x, p.y).scale(m_pixelSize, m_pixelSize);
+            Root().text.draw(m_overlayBatch, font, 13, pair.second, sf::Color(0, 0, 0), transform);
+        }
+        m_overlayBatch.end();
     } else if(m_mode == ADD_POINT) {
         auto c = std::static_pointer_cast<CollisionShape>(m_currentEntity);
         if(c->shapes().size() > 0) {
@@ -363,22 +389,18 @@ void EditorState::onDraw(sf::RenderTarget& target) {
     // reset the view
     target.setView(target.getDefaultView());
 
+    m_overlayBatch.begin(target);
+    auto& font = *Root().resources.getFont("mono");
+
     // TODO: Replace by experimental threadlet
     if(m_statusTime < 2) {
-        sf::Text text;
-        text.setFont(* Root().resources.getFont("mono"));
-        text.setPosition(5, Root().window->getSize().y - text.getFont()->getLineSpacing(14) - 5);
-        text.setString(m_statusText);
-        text.setColor(sf::Color(255, 255, 255, m_statusTime == 0 ? 255 : 100));
-        text.setCharacterSize(14);
-
-        sf::RectangleShape cmdbox;
-        cmdbox.setSize(sf::Vector2f(Root().window->getSize().x, 20));
-        cmdbox.setPosition(0, Root().window->getSize().y - cmdbox.getSize().y);
-        cmdbox.setFillColor(sf::Color(0, 0, 0, text.getColor().a));
-
-        target.draw(cmdbox);
-        target.draw(text);
+        sf::Uint8 alpha = m_statusTime == 0 ? 255 : 100;
+        float height = 20;
+        float width = Root().window->getSize().x;
+        float bottom = Root().window->getSize().y;
+
+        m_overlayBatch.drawRect(sf::FloatRect(0, bottom - height, width, height), sf::Color(0, 0, 0, alpha));
+        Root().text.draw(m_overlayBatch, font, 14, m_statusText, sf::Color(255, 255, 255, alpha), sf::Transform().translate(5, bottom - font.getLineSpacing(14) - 5));
     }
 
     if(m_showHelp) {
@@ -386,31 +408,16 @@ void EditorState::onDraw(sf::RenderTarget& target) {
         glm::vec2 size(320, m_keys.size() * 16 + 30);
         pos -= size * 0.5f;
 
-        sf::RectangleShape helpBox;
-        helpBox.setSize(sf::Vector2f(size.x, size.y));
-        helpBox.setPosition(sf::Vector2f(pos.x, pos.y));
-        helpBox.setFillColor(sf::Color(0, 0, 0, 100));
-        target.draw(helpBox);
+        m_overlayBatch.drawRect(sf::FloatRect(pos.x, pos.y, size.x, size.y), sf::Color(0, 0, 0, 100));
 
         int i = 0;
-        sf::Text text;
-        text.setFont(* Root().resources.getFont("mono"));
-        text.setCharacterSize(12);
-
         for(auto pair : m_keys) {
-            text.setPosition(pos.x + 10, pos.y + 10 + 16 * i);
-            text.setString(pair.first);
-            text.setColor(sf::Color::White);
-            target.draw(text);
-
-            text.setPosition(pos.x + 10 + 80, pos.y + 10 + 16 * i);
-            text.setString(pair.second);
-            text.setColor(sf::Color(255, 255, 255, 100));
-            target.draw(text);
-
+            Root().text.draw(m_overlayBatch, font, 12, pair.first, sf::Color::White, sf::Transform().translate(pos.x + 10, pos.y + 10 + 16 * i));
+            Root().text.draw(m_overlayBatch, font, 12, pair.second, sf::Color(255, 255, 255, 100), sf::Transform().translate(pos.x + 10 + 80, pos.y + 10 + 16 * i));
             i++;
         }
     }
+    m_overlayBatch.end();
 
     setView(target);
 }
@@ -520,6 +527,12 @@ void EditorState::updateMode() {
         entity_mouse_length = glm::length(entity_mouse);
     }
 
+    // scenery being edited is baked again every frame until the mode ends
+    bool editing = m_mode == GRAB || m_mode == ROTATE || m_mode == SCALE || m_mode == INSERT;
+    if(m_mode == SCALE_ALL || (editing && m_currentEntity && m_currentEntity->isScenery())) {
+        m_scenery.invalidate();
+    }
+
     if(m_mode == GRAB) {
         glm::vec2 diff = mp - m_modeStartPosition;
 
@@ -600,19 +613,36 @@ void EditorState::updateMode() {
 
 void EditorState::commitMode() {
     if(m_mode == SAVE) {
+        // written in the background, the journal covers it until then
         std::string filename = "levels/" + m_typingString + ".dat";
         auto pos = removePlayer();
-        saveToFile(filename);
+        m_journal.save(filename, m_entities);
         setStatus("Saved to " + filename + ".");
+        m_currentFilename = m_typingString;
         addPlayer(pos);
     } else if(m_mode == LOAD) {
         std::string filename = "levels/" + m_typingString + ".dat";
-        loadFromFile(filename);
+        std::vector<std::shared_ptr<Entity>> entities;
+        if(!LevelFile::read(filename, entities)) {
+            // keep editing the open level
+            setStatus("Could not load " + filename + ".");
+            m_mode = NONE;
+            return;
+        }
+        bool recovered = m_journal.open(filename, entities);
+        loadEntities(entities, filename);
         m_currentEntity.reset();
-        setStatus("Loaded from " + filename + ".");
+        setStatus("Loaded from " + filename + (recovered ? ", recovered unsaved edits." : "."));
         m_currentFilename = m_typingString;
         addPlayer();
+    } else if(m_mode == GRAB || m_mode == ROTATE || m_mode == SCALE) {
+        journal(m_currentEntity);
+    } else if(m_mode == SCALE_ALL) {
+        for(auto entity : m_entities) {
+            journal(entity);
+        }
     } else if(m_mode == INSERT) {
+        journal(m_currentEntity);
         if(m_currentEntity->getTypeName() == "CollisionShape") {
             startMode(ADD_POINT);
             return; // don't reset the mode afterwards
@@ -628,6 +658,7 @@ void EditorState::commitMode() {
             auto& v = c->shapes()[0];
             v.insert(v.begin() + 1 + m_addPointInsertIndex, c->transformToLocal(getMousePosition()));
             m_addPointInsertIndex++;
+            journal(c);
         }
         return; // stay in this mode
     }
@@ -655,9 +686,20 @@ void EditorState::cancelMode() {
     }
 
     m_mode = NONE;
+    m_scenery.invalidate();
     setStatus("Canceled.");
 }
 
+void EditorState::journal(std::shared_ptr<Entity> entity) {
+    // the player is not part of the level
+    if(entity && entity != m_player) {
+        m_journal.record(entity);
+    }
+    if(entity && entity->isScenery()) {
+        m_scenery.invalidate();
+    }
+}
+
 void EditorState::setStatus(const std::string& text) {
     m_statusText = text;
     m_statusTime = 0.f;
@@ -5,6 +5,7 @@
 
 #include "State.hpp"
 #include "Player.hpp"
+#include "EditorJournal.hpp"
 
 class EditorState : public State {
 public:
@@ -55,6 +56,8 @@ protected:
     void setStatus(const std::string& text);
 
     std::shared_ptr<Entity> createNewEntity(EntityType type) const;
+    // autosaves a committed change of the entity
+    void journal(std::shared_ptr<Entity> entity);
 
 private:
     std::shared_ptr<Entity> m_currentEntity;
@@ -81,6 +84,8 @@ private:
     std::vector<std::pair<std::string, std::string>> m_keys;
 
     std::string m_currentFilename;
+    EditorJournal m_journal;
+    float m_sceneryPixelSize = 0.f;
 };
 
 #endif
@@ -1,6 +1,7 @@
 #include "Egg.hpp"
 
 #include "Root.hpp"
+#include "Snapshot.hpp"
 #include <Thor/Math.hpp>
 #include <Thor/Vectors.hpp>
 
@@ -19,27 +20,37 @@ std::string Egg::getTypeName() const {
     return "Egg";
 }
 
+Entity::TypeFlag Egg::getTypeFlag() const {
+    return TYPE_EGG;
+}
+
 void constructHalfSphere(btConvexHullShape* shape, float angle, btVector3 offset) {
     btVector3 s(0.55, 0.85, 1.0);
     for(int i = 0; i <= 12; ++i) {
-        shape->addPoint(offset + btVector3(0.5, 0, 0).rotate(btVector3(0, 0, 1), angle + thor::Pi * ((i+0)%13) / 12.f) * s);
-        shape->addPoint(offset + btVector3(0.5, 0, 0).rotate(btVector3(0, 0, 1), angle + thor::Pi * ((i+1)%13) / 12.f) * s);
-        shape->addPoint(offset + btVector3(0.5, 0, 1).rotate(btVector3(0, 0, 1), angle + thor::Pi * ((i+1)%13) / 12.f) * s);
+        shape->addPoint(offset + btVector3(0.5, 0, 0).rotate(btVector3(0, 0, 1), angle + thor::Pi * ((i+0)%13) / 12.f) * s, false);
+        shape->addPoint(offset + btVector3(0.5, 0, 0).rotate(btVector3(0, 0, 1), angle + thor::Pi * ((i+1)%13) / 12.f) * s, false);
+        shape->addPoint(offset + btVector3(0.5, 0, 1).rotate(btVector3(0, 0, 1), angle + thor::Pi * ((i+1)%13) / 12.f) * s, false);
     }
+    shape->recalcLocalAabb();
 }
 
 void Egg::onInitialize() {
-    auto shape = new btConvexHullShape();
-    if(m_type == FULL) {
-        constructHalfSphere(shape, 0,        btVector3(0, 0, 0));
-        constructHalfSphere(shape, thor::Pi, btVector3(0, 0, 0));
-    } else if(m_type == LOWER) {
-        constructHalfSphere(shape, 0,        btVector3(0, -0.2, 0));
-    } else if(m_type == UPPER) {
-        constructHalfSphere(shape, thor::Pi, btVector3(0, 0.2, 0));
-    }
+    // all eggs of a type share one unscaled hull
+    Type type = m_type;
+    m_hull = Root().shapes.get(ShapeCache::Key("egg", type), [type]() -> btCollisionShape* {
+        auto shape = new btConvexHullShape();
+        if(type == FULL) {
+            constructHalfSphere(shape, 0,        btVector3(0, 0, 0));
+            constructHalfSphere(shape, thor::Pi, btVector3(0, 0, 0));
+        } else if(type == LOWER) {
+            constructHalfSphere(shape, 0,        btVector3(0, -0.2, 0));
+        } else if(type == UPPER) {
+            constructHalfSphere(shape, thor::Pi, btVector3(0, 0.2, 0));
+        }
+        return shape;
+    });
 
-    m_physicsShape = shape;
+    updateShape();
 
     // if(m_type == FULL) {
     //     m_physicsShape = new btSphereShape(0.5);
@@ -49,24 +60,40 @@ void Egg::onInitialize() {
     // }
 }
 
+void Egg::updateShape() {
+    m_shapeScale = m_scale;
+    if(m_scale.x == m_scale.y) {
+        setPhysicsShape(ShapeCache::uniformScaled(m_hull, m_scale.x));
+    } else {
+        // non-uniform scale needs its own copy of the points
+        auto hull = static_cast<btConvexHullShape*>(m_hull.get());
+        auto shape = new btConvexHullShape((const btScalar*)hull->getUnscaledPoints(), hull->getNumPoints(), sizeof(btVector3));
+        shape->setLocalScaling(btVector3(m_scale.x, m_scale.y, 1));
+        setPhysicsShape(std::shared_ptr<btCollisionShape>(shape));
+    }
+}
+
 void Egg::onAdd(State* state) {
-    m_physicsShape->setLocalScaling(btVector3(m_scale.x, m_scale.y, 1));
+    if(m_shapeScale != m_scale) {
+        updateShape();
+    }
     m_physicsBody->setFriction(2.5);
     if(!m_hatching) {
         m_physicsBody->setDamping(0.5, 0.7f);
-    } else {
-        m_physicsBody->forceActivationState(DISABLE_DEACTIVATION);
     }
 }
 
 void Egg::onUpdate(double dt) {
-    m_physicsShape->setLocalScaling(btVector3(m_scale.x, m_scale.y, 1));
+    if(m_shapeScale != m_scale) {
+        updateShape();
+    }
 
     if(m_type == FULL && m_hatching) {
         if(m_lifeTime < 2.f) {
             m_progress = 0.0;
         } else if(m_lifeTime < 4.5f) {
             if(m_progress == 0) {
+                m_state->sleepManager().wake(this);
                 m_sound.setBuffer(*Root().resources.getSound("crack").get());
                 m_sound.play();
             }
@@ -86,14 +113,16 @@ void Egg::onUpdate(double dt) {
                 upper->setPhysicsRotation(m_rotation);
                 m_state->add(upper);
                 // upper->physicsBody()->applyCentralImpulse(btVector3(0, -1, 0).rotate(ZAXIS, m_rotation) * 0.1);
-                upper->physicsBody()->applyTorque(btVector3(0, 0,  1));
+                upper->physicsBody()->applyTorque(1);
 
                 auto lower = std::make_shared<Egg>(LOWER);
                 lower->setPhysicsPosition(m_position + glm::rotate(glm::vec2(0, 0.25 * m_scale.y), m_rotation));
                 lower->setPhysicsRotation(m_rotation);
                 m_state->add(lower);
                 // lower->physicsBody()->applyCentralImpulse(btVector3(0, 1, 0).rotate(ZAXIS, m_rotation) * 0.1);
-                lower->physicsBody()->applyTorque(btVector3(0, 0, -1));
+                lower->physicsBody()->applyTorque(-1);
+
+                m_state->sleepManager().wakeRegion(m_position, 2.f);
             }
             m_progress = 1.0;
         }
@@ -111,7 +140,7 @@ void Egg::onDraw(sf::RenderTarget& target) {
             egg.setOrigin(tex->getSize().x / 2, tex->getSize().y / 2);
             egg.setScale(1.f / tex->getSize().y * m_scale.x, 1.f / tex->getSize().y * m_scale.y);
             egg.setRotation(thor::toDegree(m_rotation));
-            target.draw(egg);
+            m_state->spriteBatch().draw(egg);
         }
 
         if(m_progress > 0 && m_progress < 1) {
@@ -122,8 +151,8 @@ void Egg::onDraw(sf::RenderTarget& target) {
             crack.setScale(1.f / tex->getSize().y * m_scale.x, 1.f / tex->getSize().y * m_scale.y);
             crack.setTextureRect(sf::IntRect(0, 0, tex->getSize().x * m_progress, tex->getSize().y));
             crack.setRotation(thor::toDegree(m_rotation));
-            target.draw(crack);
-            target.draw(crack);
+            m_state->spriteBatch().draw(crack);
+            m_state->spriteBatch().draw(crack);
         }
     } else {
         auto tex = Root().resources.getTexture(m_type == UPPER ? "egg-top" : "egg-bottom");
@@ -132,7 +161,7 @@ void Egg::onDraw(sf::RenderTarget& target) {
         egg.setOrigin(tex->getSize().x / 2, tex->getSize().y * (0.5 + (m_type == UPPER ? -0.2 : 0.2)));
         egg.setScale(1.f / tex->getSize().y * m_scale.x, 1.f / tex->getSize().y * m_scale.y);
         egg.setRotation(thor::toDegree(m_rotation));
-        target.draw(egg);
+        m_state->spriteBatch().draw(egg);
     }
 }
 
@@ -140,6 +169,11 @@ void Egg::onHandleEvent(sf::Event& event) {
 
 }
 
+void Egg::onSnapshot(Snapshot& snapshot) {
+    snapshot.io(m_hatching);
+    snapshot.io(m_progress);
+}
+
 void Egg::setHatching(bool hatching) {
     m_hatching = true;
 }
@@ -16,16 +16,23 @@ public:
 
     Egg(Type type = FULL);
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
 
     void onInitialize() override;
     void onAdd(State* state) override;
     void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget& target) override;
     void onHandleEvent(sf::Event& event) override;
+    void onSnapshot(Snapshot& snapshot) override;
 
     void setHatching(bool hatching);
 
 private:
+    void updateShape();
+
+    std::shared_ptr<btCollisionShape> m_hull;
+    glm::vec2 m_shapeScale = glm::vec2(0, 0);
+
     bool m_hatching;
     float m_progress;
     Type m_type;
@@ -1,6 +1,8 @@
 #include "Entity.hpp"
 
-#include "EntityMotionState.hpp"
+#include "PhysicsWorld.hpp"
+#include "Snapshot.hpp"
+#include "State.hpp"
 
 #define GLM_FORCE_RADIANS
 #include <glm/gtx/vector_angle.hpp>
@@ -12,12 +14,22 @@ Entity::~Entity() {
     // TODO: Do this using shared_ptrs
     if(m_physicsBody)
         delete m_physicsBody;
+}
+
+Entity::TypeFlag Entity::getTypeFlag() const {
+    return TYPE_NONE;
+}
 
-    if(m_motionState)
-        delete m_motionState;
+std::shared_ptr<Entity> Entity::clone() const {
+    return nullptr;
+}
 
-    if(m_physicsShape)
-        delete m_physicsShape;
+void Entity::copySavedFields(const Entity& other) {
+    m_position = other.m_position;
+    m_scale = other.m_scale;
+    m_rotation = other.m_rotation;
+    m_mass = other.m_mass;
+    m_zLevel = other.m_zLevel;
 }
 
 void Entity::handleAddedToState(State* state) {
@@ -39,6 +51,31 @@ void Entity::handleDraw(sf::RenderTarget& target) {
     }
 }
 
+void Entity::handleSnapshot(Snapshot& snapshot) {
+    snapshot.io(m_position);
+    snapshot.io(m_rotation);
+    snapshot.io(m_scale);
+    snapshot.io(m_lifeTime);
+    snapshot.io(m_freshman);
+    snapshot.io(m_deleted);
+
+    if(m_physicsBody) {
+        PhysicsBody::Motion motion = m_physicsBody->motion();
+
+        snapshot.io(motion.transform);
+        snapshot.io(motion.linearVelocity);
+        snapshot.io(motion.angularVelocity);
+        snapshot.io(motion.awake);
+        snapshot.io(motion.restTime);
+
+        if(snapshot.mode() == Snapshot::RESTORE) {
+            m_physicsBody->setMotion(motion);
+        }
+    }
+
+    onSnapshot(snapshot);
+}
+
 void Entity::onUpdate(double dt) {}
 void Entity::onDraw(sf::RenderTarget& target) {}
 void Entity::onHandleEvent(sf::Event& event) {}
@@ -48,9 +85,18 @@ void Entity::onRemove(State* state) {}
 bool Entity::onCollide(Entity* other, const EntityCollision& c) {
     return false;
 }
+void Entity::onSnapshot(Snapshot& snapshot) {}
 
 void Entity::setMetadata(int data) {}
 
+bool Entity::isScenery() const {
+    return false;
+}
+
+void Entity::setContactEvents(int phases) {
+    m_contactEvents = phases;
+}
+
 glm::vec2 Entity::getSize() {
     return glm::vec2(1, 1);
 }
@@ -85,13 +131,9 @@ void Entity::setZLevel(int z_level) {
 
 void Entity::setPhysicsPosition(const glm::vec2& new_position) {
     if(m_physicsBody) {
-//        auto transform = m_physicsBody->getWorldTransform();
-//        transform.setOrigin(btVector3(new_position.x, new_position.y, 0));
-//        m_physicsBody->setWorldTransform(transform);
-
-        auto transform = m_physicsBody->getCenterOfMassTransform();
+        auto transform = m_physicsBody->transform();
         transform.setOrigin(btVector3(new_position.x, new_position.y, 0));
-        m_physicsBody->setCenterOfMassTransform(transform);
+        m_physicsBody->setTransform(transform);
     }
 
     m_position = new_position;
@@ -99,10 +141,9 @@ void Entity::setPhysicsPosition(const glm::vec2& new_position) {
 
 void Entity::setPhysicsRotation(float new_rotation) {
     if(m_physicsBody) {
-        auto& transform = m_physicsBody->getWorldTransform();
-        auto rot = transform.getRotation();
-        rot.setEuler(0, 0, new_rotation);
-        transform.setRotation(rot);
+        auto transform = m_physicsBody->transform();
+        transform.setRotation(btQuaternion(btVector3(0, 0, 1), new_rotation));
+        m_physicsBody->setTransform(transform);
     }
 
     m_rotation = new_rotation;
@@ -117,18 +158,23 @@ void Entity::setScale(const glm::vec2& new_scale) {
 }
 
 btCollisionShape* Entity::physicsShape() const {
-    return m_physicsShape;
+    return m_physicsShape.get();
 }
 
-void Entity::setPhysicsShape(btCollisionShape* new_physicsShape) {
+void Entity::setPhysicsShape(std::shared_ptr<btCollisionShape> new_physicsShape) {
     m_physicsShape = new_physicsShape;
+
+    if(m_physicsBody) {
+        m_physicsBody->setShape(m_physicsShape.get(), m_mass);
+    }
 }
 
-btRigidBody *Entity::physicsBody() const {
+PhysicsBody *Entity::physicsBody() const {
     return m_physicsBody;
 }
 
-void Entity::setPhysicsBody(btRigidBody* new_physicsBody) {
+void Entity::setPhysicsBody(PhysicsBody* new_physicsBody) {
+    delete m_physicsBody;
     m_physicsBody = new_physicsBody;
 }
 
@@ -139,21 +185,11 @@ btScalar Entity::mass() const
 
 void Entity::setMass(const btScalar& new_mass)
 {
-    if(m_physicsBody) {
-        btVector3 inertia(0, 0, 0);
-        m_physicsShape->calculateLocalInertia(m_mass, inertia);
-        m_physicsBody->setMassProps(m_mass, inertia);
-    }
-
     m_mass = new_mass;
-}
-
-EntityMotionState* Entity::motionState() const {
-    return m_motionState;
-}
 
-void Entity::setMotionState(EntityMotionState* new_motionState) {
-    m_motionState = new_motionState;
+    if(m_physicsBody) {
+        m_physicsBody->setShape(m_physicsShape.get(), m_mass);
+    }
 }
 
 void Entity::kill() {
@@ -164,6 +200,10 @@ bool Entity::isDeleted() const {
     return m_deleted;
 }
 
+bool Entity::isFreshman() const {
+    return m_freshman;
+}
+
 glm::vec2 Entity::transformToLocal(const glm::vec2& global) const {
     return glm::rotate(global - m_position, -m_rotation) / m_scale;
 }
@@ -1,6 +1,7 @@
 #ifndef ENTITY_HPP
 #define ENTITY_HPP
 
+#include <memory>
 #include <glm/glm.hpp>
 #include <SFML/Graphics.hpp>
 #include <btBulletDynamicsCommon.h>
@@ -8,29 +9,57 @@
 #include <cereal/types/polymorphic.hpp>
 #include "CerealGLM.hpp"
 
-class EntityMotionState;
+class PhysicsBody;
 class State;
+class Snapshot;
 class Entity;
 
 struct EntityCollision {
+    // Contact event phases, also used as bit flags for Entity::setContactEvents
+    enum Phase {
+        BEGIN   = 1 << 0,
+        PERSIST = 1 << 1,
+        END     = 1 << 2
+    };
+
+    Phase phase;
     Entity* other;
     btVector3 position;
     btVector3 otherPosition;
     btScalar distance;
-    const btCollisionObject* collisionObject;
-    const btCollisionObject* otherCollisionObject;
 };
 
 class Entity {
 public:
+    // Bit flags for cheap type filtering in physics queries
+    enum TypeFlag {
+        TYPE_NONE               = 0,
+        TYPE_WALL               = 1 << 0,
+        TYPE_PAIR               = 1 << 1,
+        TYPE_COLLISION_SHAPE    = 1 << 2,
+        TYPE_MARKER             = 1 << 3,
+        TYPE_PLAYER             = 1 << 4,
+        TYPE_EGG                = 1 << 5,
+        TYPE_TOY                = 1 << 6,
+        TYPE_FOOT               = 1 << 7,
+        TYPE_ALL                = ~0
+    };
+
     Entity();
     virtual ~Entity() = 0;
 
     virtual std::string getTypeName() const = 0;
+    virtual TypeFlag getTypeFlag() const;
+
+    // A new entity with the saved fields of this one, outside of any state,
+    // so levels can be serialized on another thread. nullptr for entities
+    // that are not saved with levels.
+    virtual std::shared_ptr<Entity> clone() const;
 
     void handleAddedToState(State* state);
     void handleDraw(sf::RenderTarget& target);
     void handleUpdate(double dt);
+    void handleSnapshot(Snapshot& snapshot);
 
     virtual void onUpdate(double dt);
     virtual void onDraw(sf::RenderTarget& target);
@@ -39,9 +68,17 @@ public:
     virtual void onAdd(State *state);
     virtual void onRemove(State *state);
     virtual bool onCollide(Entity* other, const EntityCollision& c);
+    virtual void onSnapshot(Snapshot& snapshot);
 
     virtual void setMetadata(int data);
 
+    // Scenery never moves outside the editor and is drawn from the baked
+    // StaticScenery of its state instead of every frame.
+    virtual bool isScenery() const;
+
+    int contactEvents() const { return m_contactEvents; }
+    void setContactEvents(int phases);
+
     virtual glm::vec2 getSize();
 
     glm::vec2 position() const;
@@ -64,13 +101,11 @@ public:
     void setMass(const btScalar &new_mass);
 
     btCollisionShape *physicsShape() const;
-    void setPhysicsShape(btCollisionShape* new_physicsShape);
-
-    EntityMotionState *motionState() const;
-    void setMotionState(EntityMotionState* new_motionState);
+    void setPhysicsShape(std::shared_ptr<btCollisionShape> new_physicsShape);
 
-    btRigidBody *physicsBody() const;
-    void setPhysicsBody(btRigidBody *new_physicsBody);
+    // created by the PhysicsWorld of the state, owned by the entity
+    PhysicsBody *physicsBody() const;
+    void setPhysicsBody(PhysicsBody *new_physicsBody);
 
     template<class Archive>
     void serialize(Archive& ar) {
@@ -83,11 +118,16 @@ public:
 
     void kill();
     bool isDeleted() const;
+    // not updated since it was added, and not drawn yet
+    bool isFreshman() const;
 
     glm::vec2 transformToLocal(const glm::vec2& global) const;
     glm::vec2 transformToGlobal(const glm::vec2& local) const;
 
 protected:
+    // the fields serialize() covers
+    void copySavedFields(const Entity& other);
+
     glm::vec2 m_position = glm::vec2(0, 0);
     float m_rotation = 0.f;
     glm::vec2 m_scale = glm::vec2(1, 1);
@@ -96,12 +136,12 @@ protected:
     double m_lifeTime = 0;
     bool m_freshman = true;
     bool m_deleted = false;
+    int m_contactEvents = 0;
 
     // We check whether we need to initialize physics by checking these members against
     // nullptr, so let's set them to that so that we may check again later.
-    btCollisionShape* m_physicsShape = nullptr;
-    EntityMotionState* m_motionState = nullptr;
-    btRigidBody* m_physicsBody = nullptr;
+    std::shared_ptr<btCollisionShape> m_physicsShape;
+    PhysicsBody* m_physicsBody = nullptr;
 
 public:
     State* m_state;
@@ -8,6 +8,7 @@
 
 #include "Player.hpp"
 #include "Root.hpp"
+#include "Snapshot.hpp"
 
 Foot::Foot(Player* player, int offset, bool background) :
     m_player(player), m_offset(offset), m_background(background)
@@ -17,6 +18,10 @@ std::string Foot::getTypeName() const {
     return "Foot";
 }
 
+Entity::TypeFlag Foot::getTypeFlag() const {
+    return TYPE_FOOT;
+}
+
 void Foot::onUpdate(double dt) {
     int speed = (m_offset % 2 ? -1 : 1) * m_direction;
     float speedFactor = 16; // speed of leg movement
@@ -40,38 +45,22 @@ void Foot::onUpdate(double dt) {
     sf::Vector2f relFootRayEnd = thor::rotatedVector(offsetFootRayEnd, thor::toDegree(m_player->rotation()));
     sf::Vector2f absFootRayEnd(m_player->position().x - relFootRayEnd.x, m_player->position().y - relFootRayEnd.y);
 
-    btVector3 rayStart(m_anklePosition.x, m_anklePosition.y, 0);
-    btVector3 rayEnd(absFootRayEnd.x, absFootRayEnd.y, 0);
-
-    class ClosestNonPlayerRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
-    {
-        public:
-            explicit ClosestNonPlayerRayResultCallback(const btVector3 &rayFromWorld, const btVector3& rayToWorld) :
-                ClosestRayResultCallback(rayFromWorld, rayToWorld)
-            {}
-            virtual ~ClosestNonPlayerRayResultCallback() {}
-
-            virtual bool needsCollision(btBroadphaseProxy* proxy0) const {
-                const btCollisionObject* obj = static_cast<const btCollisionObject*>(proxy0->m_clientObject);
-                const Entity* ent = static_cast<const Entity*>(obj->getUserPointer());
-                if(ent != 0 && ent->getTypeName() != "Player")
-                    return true;
-                else
-                    return false;
-            }
-    };
-    ClosestNonPlayerRayResultCallback rayCallback(rayStart, rayEnd);
-
-    m_player->m_state->dynamicsWorld()->rayTest(rayStart, rayEnd, rayCallback);
-
-    btVector3 hitPoint;
-    if(rayCallback.hasHit()) {
-        hitPoint = rayCallback.m_hitPointWorld;
-        auto new_pos = glm::vec2(hitPoint.x(), hitPoint.y());
+    m_legRay.from = btVector3(m_anklePosition.x, m_anklePosition.y, 0);
+    m_legRay.to = btVector3(absFootRayEnd.x, absFootRayEnd.y, 0);
+    m_legRay.typeMask = TYPE_ALL & ~TYPE_PLAYER;
+}
+
+RayQuery& Foot::legRay() {
+    return m_legRay;
+}
+
+void Foot::onLegRay() {
+    if(m_legRay.hit) {
+        auto new_pos = glm::vec2(m_legRay.hitPoint.x(), m_legRay.hitPoint.y());
         if(glm::length(new_pos - m_position) > 1.f)
             m_position = new_pos;
     } else {
-        m_position = glm::vec2(rayEnd.x(), rayEnd.y());
+        m_position = glm::vec2(m_legRay.to.x(), m_legRay.to.y());
     }
 }
 
@@ -100,7 +89,7 @@ void Foot::onDraw(sf::RenderTarget &target) {
     upperLeg.setScale(scaleFactor / size.x * 2, upperLegLength / size.y);
     upperLeg.setPosition(m_anklePosition.x, m_anklePosition.y);
     upperLeg.setRotation(90 + thor::polarAngle(upperLegVec));
-    target.draw(upperLeg);
+    m_player->m_state->spriteBatch().draw(upperLeg);
 
     tex = Root().resources.getTexture("lower-leg");
     size = tex->getSize();
@@ -109,7 +98,7 @@ void Foot::onDraw(sf::RenderTarget &target) {
     lowerLeg.setScale(scaleFactor / size.x * 2, (lowerLegLength + 0.03) / size.y);
     lowerLeg.setPosition(m_position.x + hitPointOffset.x(), m_position.y + hitPointOffset.y());
     lowerLeg.setRotation(90+thor::polarAngle(lowerLegVec));
-    target.draw(lowerLeg);
+    m_player->m_state->spriteBatch().draw(lowerLeg);
 
     // sf::CircleShape ankle;
     // ankle.setPosition(m_anklePosition.x, m_anklePosition.y);
@@ -128,6 +117,7 @@ void Foot::onDraw(sf::RenderTarget &target) {
     // target.draw(foot);
 
     if(m_player->m_state->m_debugDrawEnabled) {
+        m_player->m_state->spriteBatch().flush();
         sf::CircleShape foot_debug;
         foot_debug.setPosition(m_position.x, m_position.y);
         foot_debug.setRadius(1);
@@ -146,6 +136,12 @@ void Foot::onDraw(sf::RenderTarget &target) {
     }
 }
 
+void Foot::onSnapshot(Snapshot& snapshot) {
+    snapshot.io(m_direction);
+    snapshot.io(m_phase);
+    snapshot.io(m_anklePosition);
+}
+
 void Foot::setDirection(int direction) {
     m_direction = direction;
 }
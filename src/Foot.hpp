@@ -10,9 +10,11 @@ public:
     Foot(Player *player, int offset, bool background);
 
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
 
     void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget &target) override;
+    void onSnapshot(Snapshot& snapshot) override;
 
     // Directions:
     // -1 backward
@@ -20,6 +22,11 @@ public:
     //  0 idle
     void setDirection(int direction);
 
+    // The leg ray is prepared in onUpdate and cast by the player together
+    // with the rays of all other legs, then applied with onLegRay().
+    RayQuery& legRay();
+    void onLegRay();
+
 private:
     Player* m_player;
 
@@ -29,6 +36,7 @@ private:
     float m_phase = 0;
 
     glm::vec2 m_anklePosition;
+    RayQuery m_legRay;
     bool m_background;
 };
 
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <functional>
+#include <random>
 
 #include <Thor/Math.hpp>
 
@@ -14,6 +15,11 @@
 #include "Marker.hpp"
 #include "Toy.hpp"
 #include "CollisionShape.hpp"
+#include "SettledState.hpp"
+#include "LevelFile.hpp"
+
+// seed for the eggs around the spawn egg
+static const unsigned int NEST_SEED = 42;
 
 GameState::GameState() {
     m_zoom = 6;
@@ -21,6 +27,13 @@ GameState::GameState() {
 
     m_currentHelp = "";
 
+    // cave backdrop, tinted per level in onDraw()
+    m_background.setBackground(sf::Color(80, 80, 80));
+    m_background.setLayer(0, {"cave-1", 4.f,  0.2f, sf::Color::White});
+    m_background.setLayer(1, {"perlin", 8.f,  0.1f, sf::Color(128, 128, 128)});
+    m_background.setLayer(2, {"perlin", 8.f, -0.2f, sf::Color(255, 255, 255, 80)});
+    m_background.setLayer(3, {"perlin", 8.f, -0.3f, sf::Color::White});
+
     m_levels.push_back(std::make_pair("spawn", Player::WALK));
     m_levels.push_back(std::make_pair("pairs", Player::WALK));
     m_levels.push_back(std::make_pair("jump-1", Player::JUMP));
@@ -35,8 +48,6 @@ GameState::GameState() {
 }
 
 void GameState::onInit() {
-    resize();
-
     loadLevel(0);
 
     m_rumbleSound.setBuffer(*Root().resources.getSound("rumble"));
@@ -50,13 +61,15 @@ void GameState::onInit() {
 }
 
 void GameState::onUpdate(float dt) {
-    if(m_renderTextures[0].getSize() != Root().window->getSize()) {
-        resize();
+    // levels are loaded from within tween callbacks, so wait until the tweener is done stepping
+    if(m_checkpointPending) {
+        saveCheckpoint();
+        m_checkpointPending = false;
     }
 
     // m_zoom = 6;
     if(m_player) {
-        float targetZoom = 6;// + m_player->physicsBody()->getLinearVelocity().length();
+        float targetZoom = 6;// + m_player->physicsBody()->linearVelocity().length();
         float zoomSpeed = 2;
         m_zoom = m_zoom * (1 - dt * zoomSpeed) + targetZoom * (dt * zoomSpeed);
 
@@ -95,15 +108,8 @@ void GameState::onUpdate(float dt) {
 }
 
 void GameState::onDraw(sf::RenderTarget& target) {
-    float w = target.getSize().x;
-    float h = target.getSize().y;
-    m_renderTextures[0].clear();
-    m_renderTextures[1].clear();
-
-    sf::RenderTarget& t = m_renderTextures[0];
-
     target.clear();
-    t.clear(sf::Color(80, 80, 80));
+    sf::RenderTarget& t = m_postProcessing.begin(target.getSize(), sf::Color(80, 80, 80));
 
     // backdrop
     // t.setView(t.getDefaultView());
@@ -115,97 +121,40 @@ void GameState::onDraw(sf::RenderTarget& target) {
     // shader->setParameter("time", getTime());
     // t.draw(backdrop, shader.get());
 
-    setView(t);
-    int backTiles = 50;
-    float s = 4.0;
-
-    auto tex = Root().resources.getTexture("cave-1");
-    tex->setRepeated(true);
-    sf::Sprite back(*tex.get());
-    back.setTextureRect(sf::IntRect(0, 0, tex->getSize().x * backTiles, tex->getSize().y * backTiles));
-    back.setScale(s / tex->getSize().x, s / tex->getSize().y);
-    back.setPosition(m_center.x * 0.2, m_center.y * 0.2);
-    back.setOrigin(tex->getSize().x / 2 * backTiles, tex->getSize().y / 2 * backTiles);
-
     auto levelColor = {
         sf::Color(100, 20, 0),
         sf::Color(100, 120, 200),
         sf::Color(250, 200, 0),
         sf::Color(255, 0, 128)
     };
-    back.setColor(*(levelColor.begin() + (m_currentLevel) % levelColor.size()));
-    t.draw(back);
+    m_background.layer(0).color = *(levelColor.begin() + (m_currentLevel) % levelColor.size());
 
-    s = 8.0;
-    tex = Root().resources.getTexture("perlin");
-    tex->setRepeated(true);
-    back.setTexture(*tex.get(), false);
-    back.setTextureRect(sf::IntRect(0, 0, tex->getSize().x * backTiles, tex->getSize().y * backTiles));
-    back.setScale(s / tex->getSize().x, s / tex->getSize().y);
-    back.setOrigin(tex->getSize().x / 2 * backTiles, tex->getSize().y / 2 * backTiles);
-    back.setColor(sf::Color(128, 128, 128));
-    back.setPosition(m_center.x * 0.1, m_center.y * 0.1);
-    t.draw(back, sf::BlendMultiply);
-
-    s = 8.0;
-    back.setScale(s / tex->getSize().x, s / tex->getSize().y);
-    back.setPosition(0, 0);
-    back.setColor(sf::Color(255, 255, 255, 80));
-    back.setPosition(-m_center.x * 0.2, -m_center.y * 0.2);
-    t.draw(back, sf::BlendAdd);
-
-    s = 8.0;
-    back.setScale(s / tex->getSize().x, s / tex->getSize().y);
-    back.setPosition(-m_center.x * 0.3, -m_center.y * 0.3);
-    back.setColor(sf::Color(255, 255, 255, 255));
-    t.draw(back, sf::BlendMultiply);
+    setView(t);
+    m_background.draw(t, m_center);
 
     // draw
     setView(t);
     drawEntities(t);
 
-    setView(m_renderTextures[1]);
+    // fog, at a lower resolution
+    sf::RenderTarget& fog = m_postProcessing.fog();
+    setView(fog);
+    int fogTiles = 50;
+    float s = 8.0;
     float f = - 0.2;
+    auto tex = Root().resources.getTexture("perlin");
+    tex->setRepeated(true);
+    sf::Sprite back(*tex.get());
+    back.setTextureRect(sf::IntRect(0, 0, tex->getSize().x * fogTiles, tex->getSize().y * fogTiles));
+    back.setScale(s / tex->getSize().x, s / tex->getSize().y);
+    back.setOrigin(tex->getSize().x / 2 * fogTiles, tex->getSize().y / 2 * fogTiles);
     back.setColor(sf::Color(255, 255, 255, 150));
     back.setPosition(m_center.x * f + m_time * f * 1.5, m_center.y * f);
-    m_renderTextures[1].draw(back, sf::BlendAdd);
-
-    sf::Sprite sprite;
-    sprite = sf::Sprite(m_renderTextures[1].getTexture());
-    Root().resources.getShader("fog")->setParameter("size", sf::Vector2f(m_renderTextures[1].getSize()));
-    t.setView(sf::View(sf::FloatRect(0, h, w, -h)));
-    t.draw(sprite, sf::RenderStates(sf::BlendAdd, sf::RenderStates::Default.transform, sf::RenderStates::Default.texture, Root().resources.getShader("fog").get()));
+    fog.draw(back, sf::BlendAdd);
+    m_postProcessing.applyFog(sf::BlendAdd);
 
     // post-processing
-    target.setView(sf::View(sf::FloatRect(0, h, w, -h)));
- 
-    auto pixel          = Root().resources.getShader("pixel");
-    auto verticalBlur   = Root().resources.getShader("blur-vertical");
-    auto horizontalBlur = Root().resources.getShader("blur-horizontal");
-
-    horizontalBlur->setParameter("blurSize", 2.5 / w);
-    verticalBlur->setParameter("blurSize", 2.5 / h);
-    // pixel->setParameter("center", m_center.x, m_center.y);
-    pixel->setParameter("size", w, h);
-
-    m_renderTextures[0].setView(m_renderTextures[0].getDefaultView());
-    m_renderTextures[1].setView(m_renderTextures[1].getDefaultView());
-    m_renderTextures[0].setSmooth(true);
-    m_renderTextures[1].setSmooth(true);
-
-    if(m_shadersEnabled) {
-        sprite = sf::Sprite(m_renderTextures[0].getTexture());
-        m_renderTextures[1].draw(sprite, horizontalBlur.get());
-
-        sprite = sf::Sprite(m_renderTextures[1].getTexture());
-        m_renderTextures[0].draw(sprite, verticalBlur.get());
-
-        sprite = sf::Sprite(m_renderTextures[0].getTexture());
-        target.draw(sprite, pixel.get());
-    } else {
-        sprite = sf::Sprite(m_renderTextures[0].getTexture());
-        target.draw(sprite);
-    }
+    m_postProcessing.end(target, m_shadersEnabled, m_shadersEnabled);
 
     // help
     setView(target);
@@ -234,42 +183,36 @@ void GameState::onDraw(sf::RenderTarget& target) {
 
     // message
     target.setView(target.getDefaultView());
+    m_overlayBatch.begin(target);
     if(m_message != "") {
         float alpha = fmin(1, fmax(0, m_messageTime)) * fmin(1, fmax(0, 4 - m_messageTime));
         alpha = tween::Cubic().easeOut(alpha, 0, 1, 1);
 
-        sf::Text text;
-        text.setFont(* Root().resources.getFont("default"));
-        text.setCharacterSize(36);
-        text.setString(m_message);
-        text.setStyle(sf::Text::Bold);
-        text.setPosition(sf::Vector2f(target.getSize().x / 2 - text.getLocalBounds().width / 2, target.getSize().y * 0.8 - fabs(sin(m_time)) * 20));
-        text.setColor(sf::Color(255, 255, 255, 255 * alpha));
+        auto& font = *Root().resources.getFont("default");
+        auto bounds = Root().text.layout(font, 36, m_message, sf::Text::Bold).bounds;
+        sf::Vector2f position(target.getSize().x / 2 - bounds.width / 2, target.getSize().y * 0.8 - fabs(sin(m_time)) * 20);
 
         sf::Vector2f b(10, 5);
-        sf::RectangleShape rect(sf::Vector2f(text.getLocalBounds().width + 2 * b.x, text.getLocalBounds().height * 1.5 + 2 * b.y));
-        rect.setPosition(text.getPosition() - b);
-        rect.setFillColor(sf::Color(0, 0, 0, 100 * alpha));
-
-        target.draw(rect);
-        target.draw(text);
+        m_overlayBatch.drawRect(sf::FloatRect(position - b, sf::Vector2f(bounds.width + 2 * b.x, bounds.height * 1.5 + 2 * b.y)), sf::Color(0, 0, 0, 100 * alpha));
+        Root().text.draw(m_overlayBatch, font, 36, m_message, sf::Color(255, 255, 255, 255 * alpha), sf::Transform().translate(position), sf::Text::Bold);
     }
 
     if(Root().debug) {
-        sf::Text text;
-        text.setFont(* Root().resources.getFont("mono"));
-        text.setCharacterSize(20);
-        text.setString(std::to_string(getFPS()) + " FPS");
-        text.setPosition(sf::Vector2f(10, 10));
-        text.setColor(sf::Color(255, 255, 255, 100));
-        target.draw(text);
+        std::string overlay = std::to_string(getFPS()) + " FPS";
+        if(m_debugDrawEnabled) {
+            overlay += "\n" + m_profiler.summary();
+            overlay += "\nentities " + std::to_string(m_spriteBatch.drawCalls()) + " draw calls, " + std::to_string(m_spriteBatch.triangles()) + " triangles";
+            overlay += "\nscenery " + std::to_string(m_scenery.layers().size()) + " layers, baked " + std::to_string(m_scenery.bakes()) + " times";
+            overlay += "\npost-processing " + PostProcessing::qualityName(PostProcessing::quality) + ", " + std::to_string(Root().renderTargets.size()) + " render targets";
+            overlay += "\ntext " + std::to_string(Root().text.size()) + " cached, " + std::to_string(Root().text.layouts()) + " laid out";
+        }
+        Root().text.draw(m_overlayBatch, *Root().resources.getFont("mono"), 20, overlay, sf::Color(255, 255, 255, 100), sf::Transform().translate(10, 10));
     }
 
     if(m_levelFade) {
-        sf::RectangleShape rect(sf::Vector2f(target.getSize()));
-        rect.setFillColor(sf::Color(0, 0, 0, 255 * m_levelFade));
-        target.draw(rect);
+        m_overlayBatch.drawRect(sf::FloatRect(sf::Vector2f(0, 0), sf::Vector2f(target.getSize())), sf::Color(0, 0, 0, 255 * m_levelFade));
     }
+    m_overlayBatch.end();
 }
 
 void GameState::onHandleEvent(sf::Event& event) {
@@ -281,6 +224,9 @@ void GameState::onHandleEvent(sf::Event& event) {
             } else if(event.key.code == sf::Keyboard::Comma) {
                 m_shadersEnabled = !m_shadersEnabled;
                 message("Shaders toggled.");
+            } else if(event.key.code == sf::Keyboard::Slash) {
+                PostProcessing::quality = (PostProcessing::Quality)((PostProcessing::quality + 1) % (PostProcessing::QUALITY_HIGH + 1));
+                message("Quality: " + PostProcessing::qualityName(PostProcessing::quality));
             } else if(event.key.code == sf::Keyboard::Q) {
                 m_player->setAbility((Player::Ability)(((int)m_player->getAbility() + 1) % ((int)Player::RAPPEL + 1)));
                 message("Ability: " + std::to_string(m_player->getAbility()));
@@ -290,6 +236,13 @@ void GameState::onHandleEvent(sf::Event& event) {
                 switchLevel(m_currentLevel + 1);
             } else if(event.key.code == sf::Keyboard::Subtract) {
                 switchLevel(m_currentLevel - 1);
+            } else if(event.key.code == sf::Keyboard::R) {
+                restoreCheckpoint();
+                message("Checkpoint restored.");
+            } else if(event.key.code == sf::Keyboard::P) {
+                m_profiler.writeCsv("physics-" + m_currentLevelName + ".csv");
+                m_profiler.writeJson("physics-" + m_currentLevelName + ".json");
+                message("Physics profile written.");
             } else if(event.key.code == sf::Keyboard::H) {
                 m_currentHelp = m_levelHelp[m_currentLevelName];
             } else if(event.key.code == sf::Keyboard::Tab) {
@@ -301,17 +254,19 @@ void GameState::onHandleEvent(sf::Event& event) {
                 Root().states.pop();
             }
         }
-    } else if(event.type == sf::Event::Resized) {
-        resize();
-    }    
+    }
 }
 
-void GameState::resize() {
-    m_renderTextures[0].create(Root().window->getSize().x, Root().window->getSize().y);
-    m_renderTextures[1].create(Root().window->getSize().x, Root().window->getSize().y);
+void GameState::onSnapshot(Snapshot& snapshot) {
+    snapshot.io(m_player);
+    snapshot.io(m_egg);
+    snapshot.io(m_center);
+    snapshot.io(m_levelFade);
+    snapshot.io(m_helpProgress);
 }
 
 
+
 void GameState::loadLevel(int num) {
     if(Root().game_state.m_player) Root().game_state.m_player->m_walkSound.pause();
     if(num < 0 || num >= m_levels.size()) {
@@ -325,8 +280,18 @@ void GameState::loadLevel(int num) {
     m_helpProgress = 0.f;
     m_currentHelp = "";
 
-    std::string filename = m_currentLevelName + ".dat";
-    loadFromFile("levels/" + filename);
+    // prefer the compiled level, unless the .dat was edited since it was compiled
+    std::string filename = "levels/" + m_currentLevelName + ".lvl";
+    std::string source = "levels/" + m_currentLevelName + ".dat";
+    if(!LevelFile::isCompiledFrom(filename, source)) {
+        if(LevelFile::exists(filename)) {
+            std::cerr << "Warning: " << filename << " is out of date, loading " << source << " instead." << std::endl;
+        }
+        filename = source;
+    }
+    m_currentLevelFile = filename;
+    loadFromFile(filename);
+    m_profiler.clear();
 
     // spawn something
     auto spawn = getMarker(Marker::SPAWN);
@@ -349,6 +314,8 @@ void GameState::loadLevel(int num) {
     p2.addProperty(&m_levelFade, 0.f);
     m_tweener.addTween(p2);
 
+    m_checkpointPending = true;
+
     if(Root().debug && m_debugDrawEnabled) {
         message(m_currentLevelName);
     }
@@ -372,17 +339,28 @@ void GameState::spawnEgg(const glm::vec2& pos) {
     m_egg->setPhysicsRotation(thor::Pi / 2);
     m_center = m_egg->position();
 
+    // the nest is the same on every start, so it only has to settle once
+    std::mt19937 engine(NEST_SEED);
+    auto random = [&engine](float min, float max) -> float {
+        return std::uniform_real_distribution<float>(min, max)(engine);
+    };
+
     for(int i = 0; i < 10; ++i) {
         auto egg = std::make_shared<Egg>();
         add(egg);
-        egg->setPhysicsPosition(pos + glm::vec2(thor::random(-2.5f, -1.0f), thor::random(-0.5f, 0.f)));
-        egg->setPhysicsRotation(thor::random(-thor::Pi, thor::Pi));
-        float s = thor::random(0.5f, 0.7f);
+        egg->setPhysicsPosition(pos + glm::vec2(random(-2.5f, -1.0f), random(-0.5f, 0.f)));
+        egg->setPhysicsRotation(random(-thor::Pi, thor::Pi));
+        float s = random(0.5f, 0.7f);
         egg->setScale(glm::vec2(s, s));
         egg->handleUpdate(0);
     }
 
-    m_dynamicsWorld->stepSimulation(10.f, 100);
+    SettledState settled(m_currentLevelFile, pos, NEST_SEED);
+    if(!settled.load() || !settled.restore(m_entities)) {
+        m_physics->step(10.f, 100, 1.f/60.f);
+        settled.record(m_entities);
+        settled.save();
+    }
 }
 
 
@@ -408,6 +386,15 @@ void GameState::nextLevel() {
     switchLevel(m_currentLevel + 1);
 }
 
+void GameState::saveCheckpoint() {
+    saveSnapshot(m_checkpoint);
+}
+
+void GameState::restoreCheckpoint() {
+    if(m_player) m_player->m_walkSound.pause();
+    restoreSnapshot(m_checkpoint);
+}
+
 void GameState::message(const std::string& msg) {
     if(m_message == msg) return;
 
@@ -7,6 +7,8 @@
 #include "Player.hpp"
 #include "Egg.hpp"
 #include "Marker.hpp"
+#include "PostProcessing.hpp"
+#include "ParallaxBackground.hpp"
 
 class GameState : public State {
 public:
@@ -16,8 +18,7 @@ public:
     void onUpdate(float dt) override;
     void onDraw(sf::RenderTarget& target) override;
     void onHandleEvent(sf::Event& event) override;
-
-    void resize();
+    void onSnapshot(Snapshot& snapshot) override;
 
     void loadLevel(int num);
     void spawnPlayer(const glm::vec2& pos);
@@ -25,6 +26,9 @@ public:
     void switchLevel(int num, bool reset = false);
     void nextLevel();
 
+    void saveCheckpoint();
+    void restoreCheckpoint();
+
     void message(const std::string& msg);
     std::shared_ptr<Marker> getMarker(Marker::Type type);
     std::shared_ptr<Player> m_player;
@@ -32,13 +36,15 @@ public:
 private:
     int m_currentLevel;
     std::string m_currentLevelName;
+    std::string m_currentLevelFile;
     int m_nextLevel;
     std::string m_message;
     float m_messageTime = 0.f;
     bool m_shadersEnabled = true;
 
     std::shared_ptr<Egg> m_egg;
-    sf::RenderTexture m_renderTextures[2];
+    PostProcessing m_postProcessing;
+    ParallaxBackground m_background;
 
     float m_levelFade;
 
@@ -47,6 +53,9 @@ private:
     std::vector<std::pair<std::string, Player::Ability>> m_levels;
     std::map<std::string, std::string> m_levelHelp;
 
+    Snapshot m_checkpoint;
+    bool m_checkpointPending = false;
+
     sf::Sound m_rumbleSound;
     std::shared_ptr<sf::Music> m_music;
 };
@@ -0,0 +1,274 @@
+#include "GridBroadphase.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+
+#include <LinearMath/btAabbUtil2.h>
+
+static const int MAX_CELLS = 4096;
+
+// static and kinematic bodies are added with the static filter group
+static bool isStaticGroup(int group) {
+    return (group & btBroadphaseProxy::StaticFilter) != 0;
+}
+
+GridBroadphase::Proxy::Proxy(const btVector3& aabbMin, const btVector3& aabbMax, void* userPtr, int group, int mask)
+    : btBroadphaseProxy(aabbMin, aabbMax, userPtr, group, mask),
+      isStatic(isStaticGroup(group)),
+      inGrid(false),
+      index(-1),
+      stamp(0) {}
+
+template<typename Visitor>
+void GridBroadphase::visitStatics(const btVector3& aabbMin, const btVector3& aabbMax, Visitor visitor) {
+    for(auto proxy : m_oversized) {
+        if(!visitor(proxy)) return;
+    }
+
+    int x0, y0, x1, y1;
+    if(!cellRange(aabbMin, aabbMax, x0, y0, x1, y1)) {
+        // a huge query, checking every static proxy is cheaper
+        for(auto proxy : m_statics) {
+            if(proxy->inGrid && !visitor(proxy)) return;
+        }
+        return;
+    }
+
+    // proxies spanning several cells are visited only once per query
+    ++m_stamp;
+    for(int y = y0; y <= y1; ++y) {
+        for(int x = x0; x <= x1; ++x) {
+            auto cell = m_cells.find(cellKey(x, y));
+            if(cell == m_cells.end()) continue;
+            for(auto proxy : cell->second) {
+                if(proxy->stamp == m_stamp) continue;
+                proxy->stamp = m_stamp;
+                if(!visitor(proxy)) return;
+            }
+        }
+    }
+}
+
+GridBroadphase::GridBroadphase(btScalar cellSize, btOverlappingPairCache* pairCache)
+    : m_cellSize(cellSize),
+      m_pairCache(pairCache),
+      m_ownsPairCache(false),
+      m_stamp(0),
+      m_nextId(2) {
+    if(!m_pairCache) {
+        void* memory = btAlignedAlloc(sizeof(btHashedOverlappingPairCache), 16);
+        m_pairCache = new(memory) btHashedOverlappingPairCache();
+        m_ownsPairCache = true;
+    }
+}
+
+GridBroadphase::~GridBroadphase() {
+    for(auto proxy : m_movers) delete proxy;
+    for(auto proxy : m_statics) delete proxy;
+
+    if(m_ownsPairCache) {
+        m_pairCache->~btOverlappingPairCache();
+        btAlignedFree(m_pairCache);
+    }
+}
+
+btBroadphaseProxy* GridBroadphase::createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr,
+                                               int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher) {
+    Proxy* proxy = new Proxy(aabbMin, aabbMax, userPtr, collisionFilterGroup, collisionFilterMask);
+    proxy->m_uniqueId = m_nextId++;
+
+    if(proxy->isStatic) {
+        proxy->index = m_statics.size();
+        m_statics.push_back(proxy);
+        insertIntoGrid(proxy);
+    } else {
+        proxy->index = m_movers.size();
+        m_movers.push_back(proxy);
+    }
+    return proxy;
+}
+
+void GridBroadphase::destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher) {
+    Proxy* p = static_cast<Proxy*>(proxy);
+    m_pairCache->removeOverlappingPairsContainingProxy(p, dispatcher);
+
+    if(p->isStatic) {
+        removeFromGrid(p);
+        removeFromList(m_statics, p);
+    } else {
+        removeFromList(m_movers, p);
+    }
+    delete p;
+}
+
+void GridBroadphase::setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher) {
+    Proxy* p = static_cast<Proxy*>(proxy);
+    if(p->isStatic) {
+        // bullet updates static AABBs every step, only re-grid on actual change
+        if(p->m_aabbMin == aabbMin && p->m_aabbMax == aabbMax) return;
+        removeFromGrid(p);
+        p->m_aabbMin = aabbMin;
+        p->m_aabbMax = aabbMax;
+        insertIntoGrid(p);
+    } else {
+        p->m_aabbMin = aabbMin;
+        p->m_aabbMax = aabbMax;
+    }
+}
+
+void GridBroadphase::getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const {
+    aabbMin = proxy->m_aabbMin;
+    aabbMax = proxy->m_aabbMax;
+}
+
+void GridBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback,
+                             const btVector3& aabbMin, const btVector3& aabbMax) {
+    // aabbMin and aabbMax grow the proxies for convex sweeps, like btDbvtBroadphase
+    auto hits = [&](Proxy* proxy) -> bool {
+        btScalar param = 1;
+        btVector3 normal;
+        return btRayAabb(rayFrom, rayTo, proxy->m_aabbMin - aabbMax, proxy->m_aabbMax - aabbMin, param, normal);
+    };
+
+    for(auto proxy : m_movers) {
+        if(hits(proxy) && !rayCallback.process(proxy)) return;
+    }
+
+    // only the cells the ray passes over
+    btVector3 rayMin = rayFrom, rayMax = rayFrom;
+    rayMin.setMin(rayTo);
+    rayMax.setMax(rayTo);
+    visitStatics(rayMin + aabbMin, rayMax + aabbMax, [&](Proxy* proxy) -> bool {
+        return !hits(proxy) || rayCallback.process(proxy);
+    });
+}
+
+void GridBroadphase::aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) {
+    for(auto proxy : m_movers) {
+        if(TestAabbAgainstAabb2(aabbMin, aabbMax, proxy->m_aabbMin, proxy->m_aabbMax)) {
+            callback.process(proxy);
+        }
+    }
+
+    visitStatics(aabbMin, aabbMax, [&](Proxy* proxy) -> bool {
+        if(TestAabbAgainstAabb2(aabbMin, aabbMax, proxy->m_aabbMin, proxy->m_aabbMax)) {
+            callback.process(proxy);
+        }
+        return true;
+    });
+}
+
+void GridBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher) {
+    // movers against movers, there are only a few of them
+    for(unsigned int i = 0; i < m_movers.size(); ++i) {
+        for(unsigned int j = i + 1; j < m_movers.size(); ++j) {
+            addPair(m_movers[i], m_movers[j], dispatcher);
+        }
+    }
+
+    // movers against the static proxies in their cells
+    for(auto mover : m_movers) {
+        visitStatics(mover->m_aabbMin, mover->m_aabbMax, [&](Proxy* proxy) -> bool {
+            addPair(mover, proxy, dispatcher);
+            return true;
+        });
+    }
+
+    // drop pairs that stopped overlapping
+    btBroadphasePairArray& pairs = m_pairCache->getOverlappingPairArray();
+    for(int i = 0; i < pairs.size(); ) {
+        btBroadphasePair& pair = pairs[i];
+        if(!TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin, pair.m_pProxy0->m_aabbMax, pair.m_pProxy1->m_aabbMin, pair.m_pProxy1->m_aabbMax)) {
+            // swaps the last pair into place i
+            m_pairCache->removeOverlappingPair(pair.m_pProxy0, pair.m_pProxy1, dispatcher);
+        } else {
+            ++i;
+        }
+    }
+}
+
+btOverlappingPairCache* GridBroadphase::getOverlappingPairCache() {
+    return m_pairCache;
+}
+
+const btOverlappingPairCache* GridBroadphase::getOverlappingPairCache() const {
+    return m_pairCache;
+}
+
+void GridBroadphase::getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const {
+    aabbMin.setValue(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+    aabbMax.setValue(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+}
+
+void GridBroadphase::printStats() {
+    std::cout << "GridBroadphase: " << m_movers.size() << " movers, " << m_statics.size() << " statics in "
+              << m_cells.size() << " cells, " << m_pairCache->getNumOverlappingPairs() << " pairs" << std::endl;
+}
+
+GridBroadphase::CellKey GridBroadphase::cellKey(int x, int y) const {
+    // shifted unsigned, shifting a negative x is undefined
+    return ((CellKey)(unsigned int)x << 32) | (CellKey)(unsigned int)y;
+}
+
+bool GridBroadphase::cellRange(const btVector3& aabbMin, const btVector3& aabbMax, int& x0, int& y0, int& x1, int& y1) const {
+    btScalar cellsX = floor(aabbMax.x() / m_cellSize) - floor(aabbMin.x() / m_cellSize) + 1;
+    btScalar cellsY = floor(aabbMax.y() / m_cellSize) - floor(aabbMin.y() / m_cellSize) + 1;
+    if(!(cellsX * cellsY <= MAX_CELLS)) return false;
+
+    x0 = (int)floor(aabbMin.x() / m_cellSize);
+    y0 = (int)floor(aabbMin.y() / m_cellSize);
+    x1 = (int)floor(aabbMax.x() / m_cellSize);
+    y1 = (int)floor(aabbMax.y() / m_cellSize);
+    return true;
+}
+
+void GridBroadphase::insertIntoGrid(Proxy* proxy) {
+    int x0, y0, x1, y1;
+    if(!cellRange(proxy->m_aabbMin, proxy->m_aabbMax, x0, y0, x1, y1)) {
+        m_oversized.push_back(proxy);
+        return;
+    }
+
+    for(int y = y0; y <= y1; ++y) {
+        for(int x = x0; x <= x1; ++x) {
+            m_cells[cellKey(x, y)].push_back(proxy);
+        }
+    }
+    proxy->inGrid = true;
+}
+
+void GridBroadphase::removeFromGrid(Proxy* proxy) {
+    if(!proxy->inGrid) {
+        m_oversized.erase(std::remove(m_oversized.begin(), m_oversized.end(), proxy), m_oversized.end());
+        return;
+    }
+
+    int x0, y0, x1, y1;
+    cellRange(proxy->m_aabbMin, proxy->m_aabbMax, x0, y0, x1, y1);
+    for(int y = y0; y <= y1; ++y) {
+        for(int x = x0; x <= x1; ++x) {
+            auto cell = m_cells.find(cellKey(x, y));
+            if(cell == m_cells.end()) continue;
+            cell->second.erase(std::remove(cell->second.begin(), cell->second.end(), proxy), cell->second.end());
+            if(cell->second.empty()) m_cells.erase(cell);
+        }
+    }
+    proxy->inGrid = false;
+}
+
+void GridBroadphase::removeFromList(std::vector<Proxy*>& list, Proxy* proxy) {
+    // swap with the last one to keep the indices dense
+    Proxy* last = list.back();
+    list[proxy->index] = last;
+    last->index = proxy->index;
+    list.pop_back();
+}
+
+void GridBroadphase::addPair(Proxy* a, Proxy* b, btDispatcher* dispatcher) {
+    if(!TestAabbAgainstAabb2(a->m_aabbMin, a->m_aabbMax, b->m_aabbMin, b->m_aabbMax)) return;
+    if(!m_pairCache->needsBroadphaseCollision(a, b)) return;
+    if(!m_pairCache->findPair(a, b)) {
+        m_pairCache->addOverlappingPair(a, b);
+    }
+}
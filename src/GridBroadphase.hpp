@@ -0,0 +1,71 @@
+#ifndef GRIDBROADPHASE_HPP
+#define GRIDBROADPHASE_HPP
+
+#include <unordered_map>
+#include <vector>
+#include <btBulletDynamicsCommon.h>
+
+// A broadphase for levels made of static geometry and a handful of moving
+// bodies. Static proxies are put into a uniform grid in the XY plane once
+// and only re-inserted when their AABB changes. Moving proxies are kept in
+// a list and each frame they are tested against each other and against the
+// static proxies in the cells they cover.
+class GridBroadphase : public btBroadphaseInterface {
+public:
+    GridBroadphase(btScalar cellSize = 4, btOverlappingPairCache* pairCache = nullptr);
+    ~GridBroadphase();
+
+    btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr,
+                                   int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher) override;
+    void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher) override;
+    void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher) override;
+    void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const override;
+
+    void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback,
+                 const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0)) override;
+    void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) override;
+
+    void calculateOverlappingPairs(btDispatcher* dispatcher) override;
+
+    btOverlappingPairCache* getOverlappingPairCache() override;
+    const btOverlappingPairCache* getOverlappingPairCache() const override;
+    void getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const override;
+    void printStats() override;
+
+private:
+    struct Proxy : public btBroadphaseProxy {
+        Proxy(const btVector3& aabbMin, const btVector3& aabbMax, void* userPtr, int group, int mask);
+
+        bool isStatic;
+        bool inGrid; // static proxies too large for the grid are kept in m_oversized
+
+        int index; // in m_movers or m_statics
+        unsigned int stamp;
+    };
+
+    typedef unsigned long long CellKey;
+    CellKey cellKey(int x, int y) const;
+    // false if the AABB covers too many cells to visit them one by one
+    bool cellRange(const btVector3& aabbMin, const btVector3& aabbMax, int& x0, int& y0, int& x1, int& y1) const;
+    // calls visitor(Proxy*) for the static proxies that may overlap the AABB,
+    // until it returns false
+    template<typename Visitor>
+    void visitStatics(const btVector3& aabbMin, const btVector3& aabbMax, Visitor visitor);
+    void insertIntoGrid(Proxy* proxy);
+    void removeFromGrid(Proxy* proxy);
+    void removeFromList(std::vector<Proxy*>& list, Proxy* proxy);
+    void addPair(Proxy* a, Proxy* b, btDispatcher* dispatcher);
+
+    btScalar m_cellSize;
+    btOverlappingPairCache* m_pairCache;
+    bool m_ownsPairCache;
+    unsigned int m_stamp;
+    int m_nextId;
+
+    std::vector<Proxy*> m_movers;
+    std::vector<Proxy*> m_statics;
+    std::vector<Proxy*> m_oversized;
+    std::unordered_map<CellKey, std::vector<Proxy*>> m_cells;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "LevelCompiler.hpp"
+
+#include <iostream>
+#include <cmath>
+
+#include "Entity.hpp"
+#include "Marker.hpp"
+#include "CollisionShape.hpp"
+
+static const float MIN_AREA = 1e-6;
+// sine of the largest angle between two edges that still counts as straight
+static const float COLLINEAR_EPSILON = 1e-4;
+
+static float signedArea(const std::vector<glm::vec2>& points) {
+    float area = 0;
+    for(unsigned int i = 0; i < points.size(); ++i) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[(i + 1) % points.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return area * 0.5f;
+}
+
+// Removes vertices that lie on the line through their neighbours, including
+// duplicates and back-and-forth spikes. Returns the number removed.
+static int mergeCollinear(std::vector<glm::vec2>& points) {
+    int removed = 0;
+    bool changed = true;
+    while(changed && points.size() >= 3) {
+        changed = false;
+        for(unsigned int i = 0; i < points.size() && points.size() >= 3; ++i) {
+            const glm::vec2& prev = points[(i + points.size() - 1) % points.size()];
+            const glm::vec2& next = points[(i + 1) % points.size()];
+            glm::vec2 a = points[i] - prev;
+            glm::vec2 b = next - points[i];
+            float cross = a.x * b.y - a.y * b.x;
+            if(std::abs(cross) <= COLLINEAR_EPSILON * glm::length(a) * glm::length(b)) {
+                points.erase(points.begin() + i);
+                removed++;
+                changed = true;
+                break;
+            }
+        }
+    }
+    return removed;
+}
+
+void LevelCompiler::validate(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities, Report& report) {
+    int spawns = 0, goals = 0;
+    for(auto entity : entities) {
+        if(entity->getTypeName() != "Marker") continue;
+        auto marker = std::static_pointer_cast<Marker>(entity);
+        if(marker->getType() == Marker::SPAWN) spawns++;
+        if(marker->getType() == Marker::GOAL) goals++;
+    }
+
+    if(spawns != 1) {
+        std::cerr << "Error: " << filename << " has " << spawns << " spawn markers, needs exactly one." << std::endl;
+        report.errors++;
+    }
+    if(goals < 1) {
+        std::cerr << "Error: " << filename << " has no goal marker, needs at least one." << std::endl;
+        report.errors++;
+    }
+}
+
+void LevelCompiler::optimize(std::vector<std::shared_ptr<Entity>>& entities, Report& report) {
+    std::vector<std::shared_ptr<Entity>> kept;
+    for(auto entity : entities) {
+        if(entity->getTypeName() != "CollisionShape") {
+            kept.push_back(entity);
+            continue;
+        }
+
+        auto& polygons = std::static_pointer_cast<CollisionShape>(entity)->shapes();
+        std::vector<std::vector<glm::vec2>> cleaned;
+        for(auto points : polygons) {
+            report.mergedVertices += mergeCollinear(points);
+            if(points.size() < 3 || std::abs(signedArea(points)) < MIN_AREA) {
+                report.removedPolygons++;
+            } else {
+                cleaned.push_back(points);
+            }
+        }
+        polygons = cleaned;
+
+        if(polygons.empty()) {
+            report.removedShapes++;
+        } else {
+            kept.push_back(entity);
+        }
+    }
+    entities = kept;
+}
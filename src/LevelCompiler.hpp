@@ -0,0 +1,29 @@
+#ifndef LEVELCOMPILER_HPP
+#define LEVELCOMPILER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Entity;
+
+// The offline checks and clean-ups arachnonoia-levelc runs on editor levels
+// before they are written in the runtime format.
+class LevelCompiler {
+public:
+    struct Report {
+        int errors = 0;
+        int mergedVertices = 0;     // dropped from collinear edges
+        int removedPolygons = 0;    // degenerate, zero area
+        int removedShapes = 0;      // collision shapes left without polygons
+    };
+
+    // A level needs exactly one spawn marker and at least one goal marker,
+    // levels may offer several ways out. Problems are printed and counted
+    // in the report.
+    static void validate(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities, Report& report);
+    // Merges collinear collision edges and removes zero area polygons.
+    static void optimize(std::vector<std::shared_ptr<Entity>>& entities, Report& report);
+};
+
+#endif
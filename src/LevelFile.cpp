@@ -0,0 +1,396 @@
+#include "LevelFile.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#include <cereal/archives/json.hpp>
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/vector.hpp>
+#include <cereal/types/memory.hpp>
+
+#include "Entity.hpp"
+#include "Wall.hpp"
+#include "Pair.hpp"
+#include "Marker.hpp"
+#include "CollisionShape.hpp"
+#include "CollisionBake.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define LEVELFILE_MMAP
+#endif
+
+static const char LEVEL_MAGIC[8] = {'A', 'R', 'A', 'C', 'L', 'V', 'L', '\0'};
+static const uint32_t LEVEL_ALIGNMENT = 16;
+
+static_assert(sizeof(LevelHeader) == 48, "LevelHeader layout changed");
+static_assert(sizeof(LevelEntityRecord) == 32, "LevelEntityRecord layout changed");
+
+static uint32_t align(uint32_t size) {
+    return (size + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+}
+
+static LevelEntityRecord entityRecord(const Entity& entity, uint32_t order) {
+    LevelEntityRecord r;
+    r.position[0] = entity.position().x;
+    r.position[1] = entity.position().y;
+    r.scale[0] = entity.scale().x;
+    r.scale[1] = entity.scale().y;
+    r.rotation = entity.rotation();
+    r.mass = entity.mass();
+    r.zLevel = entity.zLevel();
+    r.order = order;
+    return r;
+}
+
+// world space box of an entity, for the level bounds
+static void entityBounds(Entity& entity, glm::vec2& lower, glm::vec2& upper) {
+    std::vector<glm::vec2> points;
+    if(entity.getTypeName() == "CollisionShape") {
+        for(auto& polygon : static_cast<CollisionShape&>(entity).shapes()) {
+            points.insert(points.end(), polygon.begin(), polygon.end());
+        }
+    }
+    if(points.empty()) {
+        points = {glm::vec2(-0.5, -0.5), glm::vec2(0.5, -0.5), glm::vec2(0.5, 0.5), glm::vec2(-0.5, 0.5)};
+    }
+
+    lower = upper = entity.transformToGlobal(points[0]);
+    for(auto p : points) {
+        glm::vec2 g = entity.transformToGlobal(p);
+        lower = glm::min(lower, g);
+        upper = glm::max(upper, g);
+    }
+}
+
+static void applyRecord(Entity& entity, const LevelEntityRecord& r) {
+    entity.setPosition(glm::vec2(r.position[0], r.position[1]));
+    entity.setScale(glm::vec2(r.scale[0], r.scale[1]));
+    entity.setRotation(r.rotation);
+    entity.setMass(r.mass);
+    entity.setZLevel(r.zLevel);
+}
+
+LevelFile::LevelFile()
+    : m_data(nullptr),
+      m_size(0),
+      m_mapped(false) {}
+
+LevelFile::~LevelFile() {
+    close();
+}
+
+bool LevelFile::open(const std::string& filename) {
+    close();
+    m_filename = filename;
+
+#ifdef LEVELFILE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd >= 0) {
+        struct stat info;
+        if(fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data != MAP_FAILED) {
+                m_data = static_cast<const char*>(data);
+                m_size = info.st_size;
+                m_mapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if(!m_data) {
+        std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+        if(!stream) return false;
+        m_buffer.resize(stream.tellg());
+        stream.seekg(0);
+        if(!stream.read(m_buffer.data(), m_buffer.size())) return false;
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    if(m_size < sizeof(LevelHeader)) {
+        close();
+        return false;
+    }
+
+    const LevelHeader& h = header();
+    if(std::memcmp(h.magic, LEVEL_MAGIC, sizeof(LEVEL_MAGIC)) != 0 || h.version != VERSION || h.fileSize != m_size
+            || sizeof(LevelHeader) + h.sectionCount * sizeof(LevelSection) > m_size) {
+        std::cerr << "Warning: " << filename << " is not a level file of version " << VERSION << "." << std::endl;
+        close();
+        return false;
+    }
+
+    const LevelSection* sections = reinterpret_cast<const LevelSection*>(m_data + sizeof(LevelHeader));
+    for(uint32_t i = 0; i < h.sectionCount; ++i) {
+        if((uint64_t)sections[i].offset + (uint64_t)sections[i].count * sections[i].stride > m_size) {
+            std::cerr << "Warning: " << filename << " is truncated." << std::endl;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void LevelFile::close() {
+#ifdef LEVELFILE_MMAP
+    if(m_mapped) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_buffer.clear();
+}
+
+const LevelHeader& LevelFile::header() const {
+    return *reinterpret_cast<const LevelHeader*>(m_data);
+}
+
+const LevelSection* LevelFile::findSection(LevelSection::Type type, uint32_t stride) const {
+    if(!m_data) return nullptr;
+
+    const LevelSection* sections = reinterpret_cast<const LevelSection*>(m_data + sizeof(LevelHeader));
+    for(uint32_t i = 0; i < header().sectionCount; ++i) {
+        if(sections[i].type == (uint32_t)type) {
+            return sections[i].stride == stride ? &sections[i] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void LevelFile::createEntities(std::vector<std::shared_ptr<Entity>>& entities) const {
+    std::vector<std::shared_ptr<Entity>> ordered(header().entityCount);
+    std::vector<std::shared_ptr<Entity>> unordered;
+    auto place = [&](std::shared_ptr<Entity> entity, const LevelEntityRecord& r) {
+        applyRecord(*entity, r);
+        if(r.order < ordered.size() && !ordered[r.order]) {
+            ordered[r.order] = entity;
+        } else {
+            unordered.push_back(entity);
+        }
+    };
+
+    uint32_t stringCount, vertexCount, polygonCount, count;
+    const char* strings = records<char>(LevelSection::STRINGS, stringCount);
+    const float (*vertices)[2] = records<float[2]>(LevelSection::VERTICES, vertexCount);
+    const LevelPolygonRecord* polygons = records<LevelPolygonRecord>(LevelSection::POLYGONS, polygonCount);
+
+    const LevelWallRecord* walls = records<LevelWallRecord>(LevelSection::WALLS, count);
+    for(uint32_t i = 0; i < count; ++i) {
+        auto wall = std::make_shared<Wall>();
+        if((uint64_t)walls[i].typeOffset + walls[i].typeLength <= stringCount) {
+            wall->setType(std::string(strings + walls[i].typeOffset, walls[i].typeLength));
+        }
+        place(wall, walls[i].entity);
+    }
+
+    const LevelPairRecord* pairs = records<LevelPairRecord>(LevelSection::PAIRS, count);
+    for(uint32_t i = 0; i < count; ++i) {
+        auto pair = std::make_shared<Pair>();
+        pair->setType(pairs[i].type);
+        place(pair, pairs[i].entity);
+    }
+
+    const LevelMarkerRecord* markers = records<LevelMarkerRecord>(LevelSection::MARKERS, count);
+    for(uint32_t i = 0; i < count; ++i) {
+        auto marker = std::make_shared<Marker>();
+        marker->setType((Marker::Type)markers[i].type);
+        place(marker, markers[i].entity);
+    }
+
+    const LevelShapeRecord* shapes = records<LevelShapeRecord>(LevelSection::SHAPES, count);
+    for(uint32_t i = 0; i < count; ++i) {
+        auto shape = std::make_shared<CollisionShape>();
+        const LevelShapeRecord& s = shapes[i];
+        for(uint32_t p = s.firstPolygon; p < s.firstPolygon + s.polygonCount && p < polygonCount; ++p) {
+            const LevelPolygonRecord& polygon = polygons[p];
+            if((uint64_t)polygon.firstVertex + polygon.vertexCount > vertexCount) continue;
+
+            std::vector<glm::vec2> points(polygon.vertexCount);
+            for(uint32_t v = 0; v < polygon.vertexCount; ++v) {
+                const float* vertex = vertices[polygon.firstVertex + v];
+                points[v] = glm::vec2(vertex[0], vertex[1]);
+            }
+            shape->shapes().push_back(points);
+        }
+        place(shape, s.entity);
+    }
+
+    entities.clear();
+    for(auto entity : ordered) {
+        if(entity) entities.push_back(entity);
+    }
+    entities.insert(entities.end(), unordered.begin(), unordered.end());
+}
+
+bool LevelFile::read(const std::string& filename, std::vector<std::shared_ptr<Entity>>& entities) {
+    if(filename.size() > 4 && filename.substr(filename.size() - 4) == ".lvl") {
+        LevelFile file;
+        if(!file.open(filename)) return false;
+        file.createEntities(entities);
+        return true;
+    }
+
+    std::ifstream stream(filename);
+    if(!stream) return false;
+
+    if(filename.substr(filename.length() - 4) == "json") {
+        cereal::JSONInputArchive ar(stream);
+        ar(cereal::make_nvp("entities", entities));
+    } else {
+        cereal::PortableBinaryInputArchive ar(stream);
+        ar(cereal::make_nvp("entities", entities));
+    }
+    return true;
+}
+
+bool LevelFile::write(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities, uint64_t sourceHash) {
+    std::vector<LevelWallRecord> walls;
+    std::vector<LevelPairRecord> pairs;
+    std::vector<LevelMarkerRecord> markers;
+    std::vector<LevelShapeRecord> shapes;
+    std::vector<LevelPolygonRecord> polygons;
+    std::vector<float> vertices;
+    std::string strings;
+
+    LevelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LEVEL_MAGIC, sizeof(LEVEL_MAGIC));
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+
+    std::vector<glm::vec2> lowers, uppers;
+    uint32_t order = 0;
+    for(auto entity : entities) {
+        std::string type = entity->getTypeName();
+        if(type == "Wall") {
+            auto wall = std::static_pointer_cast<Wall>(entity);
+            LevelWallRecord r;
+            r.entity = entityRecord(*wall, order);
+            r.typeOffset = strings.size();
+            r.typeLength = wall->getType().size();
+            strings += wall->getType();
+            walls.push_back(r);
+        } else if(type == "Pair") {
+            auto pair = std::static_pointer_cast<Pair>(entity);
+            LevelPairRecord r;
+            r.entity = entityRecord(*pair, order);
+            r.type = pair->getType();
+            pairs.push_back(r);
+        } else if(type == "Marker") {
+            auto marker = std::static_pointer_cast<Marker>(entity);
+            LevelMarkerRecord r;
+            r.entity = entityRecord(*marker, order);
+            r.type = marker->getType();
+            markers.push_back(r);
+        } else if(type == "CollisionShape") {
+            auto shape = std::static_pointer_cast<CollisionShape>(entity);
+            LevelShapeRecord r;
+            r.entity = entityRecord(*shape, order);
+            r.firstPolygon = polygons.size();
+            r.polygonCount = shape->shapes().size();
+            for(auto& points : shape->shapes()) {
+                LevelPolygonRecord polygon;
+                polygon.firstVertex = vertices.size() / 2;
+                polygon.vertexCount = points.size();
+                polygons.push_back(polygon);
+                for(auto p : points) {
+                    vertices.push_back(p.x);
+                    vertices.push_back(p.y);
+                }
+            }
+            shapes.push_back(r);
+        } else {
+            std::cerr << "Warning: " << type << " entities can't be stored in level files, skipping." << std::endl;
+            continue;
+        }
+
+        glm::vec2 lower, upper;
+        entityBounds(*entity, lower, upper);
+        lowers.push_back(lower);
+        uppers.push_back(upper);
+        order++;
+    }
+    header.entityCount = order;
+
+    glm::vec2 levelLower, levelUpper;
+    for(uint32_t i = 0; i < order; ++i) {
+        levelLower = i == 0 ? lowers[i] : glm::min(levelLower, lowers[i]);
+        levelUpper = i == 0 ? uppers[i] : glm::max(levelUpper, uppers[i]);
+    }
+    header.boundsMin[0] = levelLower.x;
+    header.boundsMin[1] = levelLower.y;
+    header.boundsMax[0] = levelUpper.x;
+    header.boundsMax[1] = levelUpper.y;
+
+    struct Blob {
+        LevelSection::Type type;
+        const void* data;
+        uint32_t count;
+        uint32_t stride;
+    };
+    std::vector<Blob> blobs = {
+        {LevelSection::WALLS,    walls.data(),    (uint32_t)walls.size(),        sizeof(LevelWallRecord)},
+        {LevelSection::PAIRS,    pairs.data(),    (uint32_t)pairs.size(),        sizeof(LevelPairRecord)},
+        {LevelSection::MARKERS,  markers.data(),  (uint32_t)markers.size(),      sizeof(LevelMarkerRecord)},
+        {LevelSection::SHAPES,   shapes.data(),   (uint32_t)shapes.size(),       sizeof(LevelShapeRecord)},
+        {LevelSection::POLYGONS, polygons.data(), (uint32_t)polygons.size(),     sizeof(LevelPolygonRecord)},
+        {LevelSection::VERTICES, vertices.data(), (uint32_t)vertices.size() / 2, 2 * sizeof(float)},
+        {LevelSection::STRINGS,  strings.data(),  (uint32_t)strings.size(),      1}
+    };
+
+    header.sectionCount = blobs.size();
+    std::vector<LevelSection> sections;
+    uint32_t offset = align(sizeof(LevelHeader) + blobs.size() * sizeof(LevelSection));
+    for(auto& blob : blobs) {
+        LevelSection section;
+        section.type = blob.type;
+        section.offset = offset;
+        section.count = blob.count;
+        section.stride = blob.stride;
+        sections.push_back(section);
+        offset += align(blob.count * blob.stride);
+    }
+    header.fileSize = offset;
+
+    std::ofstream stream(filename, std::ios::binary);
+    if(!stream) {
+        std::cerr << "Warning: could not write " << filename << "." << std::endl;
+        return false;
+    }
+
+    std::vector<char> padding(LEVEL_ALIGNMENT, 0);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(sections.data()), sections.size() * sizeof(LevelSection));
+    uint32_t written = sizeof(header) + sections.size() * sizeof(LevelSection);
+    stream.write(padding.data(), align(written) - written);
+
+    for(auto& blob : blobs) {
+        uint32_t size = blob.count * blob.stride;
+        stream.write(static_cast<const char*>(blob.data), size);
+        stream.write(padding.data(), align(size) - size);
+    }
+    return (bool)stream;
+}
+
+bool LevelFile::exists(const std::string& filename) {
+    return (bool)std::ifstream(filename);
+}
+
+bool LevelFile::isCompiledFrom(const std::string& filename, const std::string& source) {
+    std::ifstream stream(filename, std::ios::binary);
+    LevelHeader header;
+    if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(std::memcmp(header.magic, LEVEL_MAGIC, sizeof(LEVEL_MAGIC)) != 0 || header.version != VERSION) return false;
+
+    if(!exists(source)) return true;
+    return header.sourceHash == CollisionBake::hashFile(source);
+}
@@ -0,0 +1,124 @@
+#ifndef LEVELFILE_HPP
+#define LEVELFILE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Entity;
+
+// The runtime level format (.lvl). Files are mapped into memory and the
+// entities are built straight from the records, without any parsing. All
+// values are little endian and 4 byte aligned. Sections may come in any
+// order and readers skip section types they don't know.
+//
+//   LevelHeader
+//   LevelSection[sectionCount]
+//   section data, each 16 byte aligned
+struct LevelHeader {
+    char magic[8];          // "ARACLVL\0"
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t entityCount;
+    uint32_t fileSize;
+    float boundsMin[2];     // of all entities
+    float boundsMax[2];
+    uint64_t sourceHash;    // CollisionBake::hashFile of the level it was compiled from, 0 if unknown
+};
+
+struct LevelSection {
+    enum Type {
+        WALLS = 1,          // LevelWallRecord
+        PAIRS = 2,          // LevelPairRecord
+        MARKERS = 3,        // LevelMarkerRecord
+        SHAPES = 4,         // LevelShapeRecord
+        POLYGONS = 5,       // LevelPolygonRecord, referenced by shapes
+        VERTICES = 6,       // float[2], referenced by polygons
+        STRINGS = 7         // char pool, referenced by walls
+    };
+
+    uint32_t type;
+    uint32_t offset;        // from the start of the file
+    uint32_t count;
+    uint32_t stride;        // size of one record
+};
+
+// the serialized Entity fields, shared by all records
+struct LevelEntityRecord {
+    float position[2];
+    float scale[2];
+    float rotation;
+    float mass;
+    int32_t zLevel;
+    uint32_t order;         // index in the entity list of the level
+};
+
+struct LevelWallRecord {
+    LevelEntityRecord entity;
+    uint32_t typeOffset;    // into STRINGS
+    uint32_t typeLength;
+};
+
+struct LevelPairRecord {
+    LevelEntityRecord entity;
+    int32_t type;
+};
+
+struct LevelMarkerRecord {
+    LevelEntityRecord entity;
+    int32_t type;
+};
+
+struct LevelShapeRecord {
+    LevelEntityRecord entity;
+    uint32_t firstPolygon;
+    uint32_t polygonCount;
+};
+
+struct LevelPolygonRecord {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+};
+
+class LevelFile {
+public:
+    static const uint32_t VERSION = 4;
+
+    LevelFile();
+    ~LevelFile();
+
+    // maps the file and checks that all sections lie within it
+    bool open(const std::string& filename);
+    void close();
+
+    const LevelHeader& header() const;
+    // records of a section, nullptr and count 0 if the file has none
+    template<typename T>
+    const T* records(LevelSection::Type type, uint32_t& count) const {
+        const LevelSection* section = findSection(type, sizeof(T));
+        count = section ? section->count : 0;
+        return section ? reinterpret_cast<const T*>(m_data + section->offset) : nullptr;
+    }
+
+    void createEntities(std::vector<std::shared_ptr<Entity>>& entities) const;
+
+    // Reads a level in any format: .lvl is mapped, .json and .dat go through cereal.
+    static bool read(const std::string& filename, std::vector<std::shared_ptr<Entity>>& entities);
+    static bool write(const std::string& filename, const std::vector<std::shared_ptr<Entity>>& entities, uint64_t sourceHash = 0);
+    static bool exists(const std::string& filename);
+    // False if source exists and changed since filename was compiled from
+    // it, or if filename can't be opened. Only the header is read.
+    static bool isCompiledFrom(const std::string& filename, const std::string& source);
+
+private:
+    const LevelSection* findSection(LevelSection::Type type, uint32_t stride) const;
+
+    std::string m_filename;
+    const char* m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::vector<char> m_buffer; // where the file is read to when it can't be mapped
+};
+
+#endif
@@ -12,21 +12,33 @@ std::string Marker::getTypeName() const {
     return "Marker";
 }
 
+Entity::TypeFlag Marker::getTypeFlag() const {
+    return TYPE_MARKER;
+}
+
+std::shared_ptr<Entity> Marker::clone() const {
+    auto marker = std::make_shared<Marker>();
+    marker->copySavedFields(*this);
+    marker->setType(m_type);
+    return marker;
+}
+
 void Marker::onInitialize() {
     if(m_type == GOAL) {
-        m_physicsShape = new btSphereShape(0.01);
+        m_physicsShape = Root().shapes.sphere(0.01);
     }
 }
 
 void Marker::onAdd(State* state) {
     if(m_physicsBody) {
-        m_physicsBody->setCollisionFlags(m_physicsBody->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+        m_physicsBody->setSensor(true);
     }
 }
 
 void Marker::onDraw(sf::RenderTarget& target) {
     if(m_state != &Root().editor_state) return;
 
+    m_state->spriteBatch().flush();
     auto pix = m_state->getPixelSize();
 
     sf::CircleShape shape(pix * 10);
@@ -55,6 +67,10 @@ Marker::Type Marker::getType() const {
     return m_type;
 }
 
+void Marker::setType(Marker::Type type) {
+    m_type = type;
+}
+
 glm::vec2 Marker::getSize() {
     auto s = 20 * m_state->getPixelSize();
     return glm::vec2(s, s);
@@ -25,6 +25,8 @@ public:
 public:
     Marker();
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
+    std::shared_ptr<Entity> clone() const override;
 
     void onInitialize() override;
     void onAdd(State* state) override;
@@ -35,6 +37,7 @@ public:
     glm::vec2 getSize() override;
 
     Type getType() const;
+    void setType(Type type);
 
     template<class Archive>
     void serialize(Archive& ar) {
@@ -9,14 +9,10 @@ void MenuState::onInit() {
     add(m_egg);
     m_center = glm::vec2(0, 0);
     m_zoom = 3;
-    m_dynamicsWorld->setGravity(btVector3(0, 0, 0));
+    m_physics->setGravity(btVector3(0, 0, 0));
 }
 
 void MenuState::onUpdate(float dt) {
-    if(m_renderTextures[0].getSize() != Root().window->getSize()) {
-        resize();
-    }
-
     float t = fmod(m_time, 2) / 2;
     float r = 0.f;
 
@@ -28,18 +24,12 @@ void MenuState::onUpdate(float dt) {
 
 void MenuState::onDraw(sf::RenderTarget &target) {
     target.clear();
-    m_renderTextures[0].clear();
-    m_renderTextures[1].clear();
-
-    auto& t = m_renderTextures[0];
+    auto& scene = m_postProcessing.begin(target.getSize());
     float w = target.getSize().x;
     float h = target.getSize().y;
 
-    auto pixel = Root().resources.getShader("pixel");
-    auto fog = Root().resources.getShader("fog");
-    pixel->setParameter("size", w, h);
-    fog->setParameter("size", w, h);
-
+    // the backdrop is seen through the fog only, so it is drawn at its resolution
+    auto& t = m_postProcessing.fog();
     setView(t);
 
     int backTiles = 20;
@@ -52,54 +42,33 @@ void MenuState::onDraw(sf::RenderTarget &target) {
     back.setPosition(m_center.x * 0.2, m_center.y * 0.2);
     back.setOrigin(tex->getSize().x / 2 * backTiles, tex->getSize().y / 2 * backTiles);
     t.draw(back);
-
-    m_renderTextures[1].setView(sf::View(sf::FloatRect(0, h, w, -h)));
-    m_renderTextures[1].draw(sf::Sprite(m_renderTextures[0].getTexture()), fog.get());
+    m_postProcessing.applyFog(sf::BlendAlpha);
 
     // draw
-    setView(m_renderTextures[1]);
-    drawEntities(m_renderTextures[1]);
+    setView(scene);
+    drawEntities(scene);
 
-    target.setView(sf::View(sf::FloatRect(0, h, w, -h)));
-    target.draw(sf::Sprite(m_renderTextures[1].getTexture()), pixel.get());
+    m_postProcessing.end(target, false);
 
     target.setView(target.getDefaultView());
 
-    sf::Text text;
-    text.setFont(* Root().resources.getFont("default"));
-    text.setCharacterSize(80);
-    text.setString(m_gameOver ? "Game over" : "Arachnonoia");
-    text.setPosition(w / 2 - text.getLocalBounds().width / 2, 100);
-    text.setColor(sf::Color::White);
-    target.draw(text);
-
-    text.setCharacterSize(24);
-    text.setStyle(sf::Text::Bold);
-    text.setString(std::string("Press any key to ") + (m_gameOver ? "play again" : "start the adventure"));
-    text.setPosition(w / 2 - text.getLocalBounds().width / 2, 200);//target.getSize().y - 100);
-    text.setColor(sf::Color(255, 255, 255, fabs(sin(m_time * 2)) * 128 + 127));
-    target.draw(text);
+    // centered lines of text, all in one batch per font size
+    m_overlayBatch.begin(target);
+    auto& font = *Root().resources.getFont("default");
+    auto line = [&](const std::string& string, unsigned int size, sf::Uint32 style, float y, const sf::Color& color) {
+        float width = Root().text.layout(font, size, string, style).bounds.width;
+        Root().text.draw(m_overlayBatch, font, size, string, color, sf::Transform().translate(w / 2 - width / 2, y), style);
+    };
 
+    line(m_gameOver ? "Game over" : "Arachnonoia", 80, sf::Text::Regular, 100, sf::Color::White);
+    line(std::string("Press any key to ") + (m_gameOver ? "play again" : "start the adventure"), 24, sf::Text::Bold, 200, sf::Color(255, 255, 255, fabs(sin(m_time * 2)) * 128 + 127));
     if(!m_gameOver) {
-        text.setCharacterSize(24);
-        text.setString("Oh, and this is you!");
-        text.setStyle(sf::Text::Regular);
-        text.setPosition(w / 2 - text.getLocalBounds().width / 2, h * 0.7);//target.getSize().y - 100);
-        text.setColor(sf::Color::White);
-        target.draw(text);
+        line("Oh, and this is you!", 24, sf::Text::Regular, h * 0.7, sf::Color::White);
     }
 
-    text.setCharacterSize(20);
-    text.setString("Created by Sven-Hendrik 'svenstaro' Haase and Paul 'opatut' Bienkowski");
-    text.setPosition(w / 2 - text.getLocalBounds().width / 2, h - 70);
-    text.setColor(sf::Color::White);
-    text.setStyle(sf::Text::Bold);
-    target.draw(text);
-    text.setString("for \"Programmierung interaktiver Visualisierungen / Game Development\" - University of Hamburg - 2013/14");
-    text.setStyle(sf::Text::Regular);
-    text.setPosition(w / 2 - text.getLocalBounds().width / 2, h - 40);
-    target.draw(text);
-    
+    line("Created by Sven-Hendrik 'svenstaro' Haase and Paul 'opatut' Bienkowski", 20, sf::Text::Bold, h - 70, sf::Color::White);
+    line("for \"Programmierung interaktiver Visualisierungen / Game Development\" - University of Hamburg - 2013/14", 20, sf::Text::Regular, h - 40, sf::Color::White);
+    m_overlayBatch.end();
 }
 
 void MenuState::onHandleEvent(sf::Event& event) {
@@ -110,16 +79,9 @@ void MenuState::onHandleEvent(sf::Event& event) {
             Root().game_state.switchLevel(0, true);
             Root().states.push(&Root().game_state);
         }
-    } else if(event.type == sf::Event::Resized) {
-        resize();
     }
 }
 
-void MenuState::resize() {
-    m_renderTextures[0].create(Root().window->getSize().x, Root().window->getSize().y);
-    m_renderTextures[1].create(Root().window->getSize().x, Root().window->getSize().y);
-}
-
 void MenuState::setGameOver(bool gameOver) {
     m_gameOver = gameOver;
 }
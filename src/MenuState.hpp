@@ -5,6 +5,7 @@
 
 #include "State.hpp"
 #include "Egg.hpp"
+#include "PostProcessing.hpp"
 
 class MenuState : public State {
 public:
@@ -15,12 +16,10 @@ public:
     void onDraw(sf::RenderTarget& target) override;
     void onHandleEvent(sf::Event& event) override;
 
-    void resize();
-
     void setGameOver(bool gameOver);
 
 private:
-    sf::RenderTexture m_renderTextures[2];        
+    PostProcessing m_postProcessing;
     std::shared_ptr<Egg> m_egg;
     bool m_gameOver;
 };
@@ -10,11 +10,12 @@
 #include <CppTweener.h>
 
 #include "Root.hpp"
+#include "Snapshot.hpp"
 
 Pair::Pair() {
     m_type = 1;
     m_mass = 0.f;
-    m_physicsShape = new btSphereShape(0.1);
+    m_physicsShape = Root().shapes.sphere(0.1);
     m_solved = false;
     m_active = false;
     m_solvedTime = 0;
@@ -27,8 +28,26 @@ std::string Pair::getTypeName() const {
     return "Pair";
 }
 
+Entity::TypeFlag Pair::getTypeFlag() const {
+    return TYPE_PAIR;
+}
+
+std::shared_ptr<Entity> Pair::clone() const {
+    auto pair = std::make_shared<Pair>();
+    pair->copySavedFields(*this);
+    pair->setType(m_type);
+    return pair;
+}
+
 void Pair::onAdd(State* state) {
-    m_physicsBody->setCollisionFlags(m_physicsBody->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+    m_physicsBody->setSensor(true);
+}
+
+void Pair::onSnapshot(Snapshot& snapshot) {
+    snapshot.io(m_active);
+    snapshot.io(m_solved);
+    snapshot.io(m_activationTime);
+    snapshot.io(m_solvedTime);
 }
 
 void Pair::setMetadata(int data) {
@@ -58,25 +77,33 @@ void Pair::onDraw(sf::RenderTarget& target) {
     offset *= 0.5 * m_scale.x;
     height *= m_scale.y;
 
+    SpriteBatch& batch = m_state->spriteBatch();
+    sf::Transform transform;
+    transform.translate(root.x, root.y).rotate(thor::toDegree(m_rotation));
+
+    // the two threads and the web in between
     for(int i = 0; i < 2; ++i) {
-        sf::ConvexShape shape(3);
-        shape.setPoint(0, sf::Vector2f(-0.02,  0));
-        shape.setPoint(1, sf::Vector2f(offset * (i == 0 ? -1 : 1), -height));
-        shape.setPoint(2, sf::Vector2f( 0.02,  0));
-        shape.setFillColor(sf::Color::Black);
-        shape.setRotation(thor::toDegree(m_rotation));
-        shape.setPosition(root.x, root.y);
-        target.draw(shape);
+        sf::Vertex thread[3] = {
+            sf::Vertex(sf::Vector2f(-0.02, 0), sf::Color::Black),
+            sf::Vertex(sf::Vector2f(offset * (i == 0 ? -1 : 1), -height), sf::Color::Black),
+            sf::Vertex(sf::Vector2f( 0.02, 0), sf::Color::Black)
+        };
+        batch.draw(thread, 3, transform);
     }
 
-    sf::ConvexShape shape(3);
-    shape.setPoint(0, sf::Vector2f(0, 0));
-    shape.setPoint(1, sf::Vector2f(-offset, -height));
-    shape.setPoint(2, sf::Vector2f( offset, -height));
-    shape.setPosition(root.x, root.y);
-    shape.setRotation(thor::toDegree(m_rotation));
-    shape.setTexture(Root().resources.getTexture("spiderweb").get());
-    target.draw(shape);
+    // texture spans the bounding box of the web, like sf::Shape does it
+    auto web = Root().resources.getTexture("spiderweb");
+    sf::Vector2f size(web->getSize());
+    float u = offset > 0 ? size.x : 0;
+    float v = height > 0 ? size.y : 0;
+    sf::Vertex triangle[3] = {
+        sf::Vertex(sf::Vector2f(0, 0),             sf::Vector2f(u * 0.5f, v)),
+        sf::Vertex(sf::Vector2f(-offset, -height), sf::Vector2f(0, 0)),
+        sf::Vertex(sf::Vector2f( offset, -height), sf::Vector2f(u, 0))
+    };
+    sf::RenderStates states(transform);
+    states.texture = web.get();
+    batch.draw(triangle, 3, states);
 
     if(m_active || m_solved) {
         auto tex = Root().resources.getTexture("blob");
@@ -90,7 +117,7 @@ void Pair::onDraw(sf::RenderTarget& target) {
         sprite.setScale(0.3 / s.x, (0.3 + 0.2 * abs(sin(m_activationTime * 2))) / s.y);
         sprite.setOrigin(0.6 * s.x, 0.6 * s.y);
         sprite.setRotation(thor::toDegree(m_rotation));
-        target.draw(sprite);
+        batch.draw(sprite);
     }
 }
 
@@ -122,12 +149,17 @@ void Pair::setType(int type) {
     m_type = type;
 }
 
+int Pair::getType() const {
+    return m_type;
+}
+
 void Pair::activate() {
     if(m_solved) return;
 
     if(!m_active) {
         m_active = true;
         m_activationTime = 0;
+        m_state->sleepManager().wakeRegion(m_position, 2.f);
 
         deactivateAllOtherPairs();
 
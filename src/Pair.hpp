@@ -14,10 +14,13 @@ public:
     Pair();
 
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
+    std::shared_ptr<Entity> clone() const override;
 
     void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget& target) override;
     void onAdd(State* state);
+    void onSnapshot(Snapshot& snapshot) override;
 
     void setMetadata(int data);
 
@@ -25,6 +28,7 @@ public:
     void deactivateAllOtherPairs();
 
     void setType(int type);
+    int getType() const;
     void activate();
     void deactivate();
     void solve();
@@ -0,0 +1,53 @@
+#include "ParallaxBackground.hpp"
+
+#include "Root.hpp"
+
+ParallaxBackground::ParallaxBackground()
+    : m_background(sf::Color::Black) {
+    for(int i = 0; i < LAYERS; ++i) {
+        m_layers[i].size = 1.f;
+        m_layers[i].parallax = 0.f;
+        m_layers[i].color = sf::Color::White;
+    }
+}
+
+void ParallaxBackground::setLayer(int index, const Layer& layer) {
+    m_layers[index] = layer;
+}
+
+ParallaxBackground::Layer& ParallaxBackground::layer(int index) {
+    return m_layers[index];
+}
+
+void ParallaxBackground::setBackground(const sf::Color& color) {
+    m_background = color;
+}
+
+void ParallaxBackground::draw(sf::RenderTarget& target, const glm::vec2& center) {
+    auto shader = Root().resources.getShader("parallax");
+    shader->setParameter("background", m_background);
+
+    for(int i = 0; i < LAYERS; ++i) {
+        const Layer& layer = m_layers[i];
+        std::string n = std::to_string(i);
+
+        auto tex = Root().resources.getTexture(layer.texture.empty() ? "perlin" : layer.texture);
+        tex->setRepeated(true);
+        shader->setParameter("texture" + n, *tex);
+        shader->setParameter("offset" + n, center.x * layer.parallax, center.y * layer.parallax);
+        shader->setParameter("size" + n, layer.size);
+        shader->setParameter("color" + n, layer.color);
+    }
+
+    // one quad over the view, its texture coordinates are world positions
+    const sf::View& view = target.getView();
+    sf::Vector2f half = view.getSize() / 2.f;
+    sf::Vector2f c = view.getCenter();
+    sf::Vertex quad[4] = {
+        sf::Vertex(sf::Vector2f(c.x - half.x, c.y - half.y), sf::Vector2f(c.x - half.x, c.y - half.y)),
+        sf::Vertex(sf::Vector2f(c.x + half.x, c.y - half.y), sf::Vector2f(c.x + half.x, c.y - half.y)),
+        sf::Vertex(sf::Vector2f(c.x - half.x, c.y + half.y), sf::Vector2f(c.x - half.x, c.y + half.y)),
+        sf::Vertex(sf::Vector2f(c.x + half.x, c.y + half.y), sf::Vector2f(c.x + half.x, c.y + half.y))
+    };
+    target.draw(quad, 4, sf::TrianglesStrip, sf::RenderStates(sf::BlendNone, sf::Transform::Identity, nullptr, shader.get()));
+}
@@ -0,0 +1,37 @@
+#ifndef PARALLAXBACKGROUND_HPP
+#define PARALLAXBACKGROUND_HPP
+
+#include <string>
+#include <SFML/Graphics.hpp>
+#include <glm/glm.hpp>
+
+// Repeated textures that scroll with the camera at their own speed, all
+// composited in a single fullscreen pass of the parallax shader. The
+// shader blends the layers in a fixed way: layer 0 is drawn over the
+// background color, layers 1 and 3 multiply and layer 2 adds.
+class ParallaxBackground {
+public:
+    static const int LAYERS = 4;
+
+    struct Layer {
+        std::string texture;
+        float size;         // world units per texture repeat
+        float parallax;     // offset relative to the camera center
+        sf::Color color;
+    };
+
+    ParallaxBackground();
+
+    void setLayer(int index, const Layer& layer);
+    Layer& layer(int index);
+    void setBackground(const sf::Color& color);
+
+    // fills the current view of target
+    void draw(sf::RenderTarget& target, const glm::vec2& center);
+
+private:
+    Layer m_layers[LAYERS];
+    sf::Color m_background;
+};
+
+#endif
@@ -0,0 +1,469 @@
+#include "Physics2dWorld.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <BulletCollision/CollisionShapes/btTriangleCallback.h>
+
+#include "DebugDraw.hpp"
+#include "PhysicsProfiler.hpp"
+
+// triangle mesh outlines become capsules this thick
+static const float MESH_EDGE_RADIUS = 0.01f;
+
+static const float PI = 3.14159265358979f;
+
+static float angleOf(const btQuaternion& rotation) {
+    float angle = 2 * atan2(rotation.z(), rotation.w());
+    if(angle > PI) angle -= 2 * PI;
+    if(angle < -PI) angle += 2 * PI;
+    return angle;
+}
+
+static btTransform transformOf(const glm::vec2& position, float angle) {
+    return btTransform(btQuaternion(btVector3(0, 0, 1), angle), btVector3(position.x, position.y, 0));
+}
+
+static glm::vec2 toPlane(const btVector3& v) {
+    return glm::vec2(v.x(), v.y());
+}
+
+// the same collision groups bullet gives its bodies
+static void setBulletFilter(World2d::Body& body) {
+    body.group = body.isStatic() ? btBroadphaseProxy::StaticFilter : btBroadphaseProxy::DefaultFilter;
+    body.mask = body.isStatic() ? btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter : btBroadphaseProxy::AllFilter;
+}
+
+// a point of a shape in its parent's space
+static glm::vec2 place(const btTransform& transform, btScalar scale, const btVector3& point) {
+    return toPlane(transform * (point * scale));
+}
+
+// collects the edges of a triangle mesh lying in the XY plane
+struct MeshEdgeCollector : public btInternalTriangleIndexCallback {
+    const btTransform* transform;
+    std::vector<World2d::Shape>* shapes;
+
+    void internalProcessTriangleIndex(btVector3* triangle, int partId, int triangleIndex) override {
+        for(int i = 0; i < 3; ++i) {
+            const btVector3& p = triangle[i];
+            const btVector3& q = triangle[(i + 1) % 3];
+            if(std::abs(p.z()) > 1e-4f || std::abs(q.z()) > 1e-4f) continue;
+            shapes->push_back(World2d::Shape::polygon({place(*transform, 1, p), place(*transform, 1, q)}, MESH_EDGE_RADIUS));
+        }
+    }
+};
+
+void Physics2dWorld::convertShape(const btCollisionShape* shape, const btTransform& transform, btScalar scale, std::vector<World2d::Shape>& shapes) {
+    int type = shape->getShapeType();
+    if(type == SPHERE_SHAPE_PROXYTYPE) {
+        auto sphere = static_cast<const btSphereShape*>(shape);
+        shapes.push_back(World2d::Shape::circle(toPlane(transform.getOrigin()), sphere->getRadius() * scale));
+    } else if(type == BOX_SHAPE_PROXYTYPE) {
+        btVector3 h = static_cast<const btBoxShape*>(shape)->getHalfExtentsWithMargin();
+        shapes.push_back(World2d::Shape::polygon({
+            place(transform, scale, btVector3(-h.x(), -h.y(), 0)), place(transform, scale, btVector3(h.x(), -h.y(), 0)),
+            place(transform, scale, btVector3(h.x(), h.y(), 0)), place(transform, scale, btVector3(-h.x(), h.y(), 0))
+        }));
+    } else if(type == CONVEX_HULL_SHAPE_PROXYTYPE) {
+        // bullet keeps the margin around the hull
+        auto hull = static_cast<const btConvexHullShape*>(shape);
+        std::vector<glm::vec2> points;
+        for(int i = 0; i < hull->getNumPoints(); ++i) {
+            points.push_back(place(transform, scale, hull->getScaledPoint(i)));
+        }
+        shapes.push_back(World2d::Shape::polygon(points, hull->getMargin() * scale));
+    } else if(type == UNIFORM_SCALING_SHAPE_PROXYTYPE) {
+        auto scaling = static_cast<const btUniformScalingShape*>(shape);
+        convertShape(scaling->getChildShape(), transform, scale * scaling->getUniformScalingFactor(), shapes);
+    } else if(type == COMPOUND_SHAPE_PROXYTYPE) {
+        auto compound = static_cast<const btCompoundShape*>(shape);
+        for(int i = 0; i < compound->getNumChildShapes(); ++i) {
+            convertShape(compound->getChildShape(i), transform * compound->getChildTransform(i), scale, shapes);
+        }
+    } else if(type == TRIANGLE_MESH_SHAPE_PROXYTYPE) {
+        // the level outline is the edge at z = 0 of the extruded walls
+        auto mesh = static_cast<const btBvhTriangleMeshShape*>(shape);
+        MeshEdgeCollector collector;
+        collector.transform = &transform;
+        collector.shapes = &shapes;
+        btVector3 large(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+        mesh->getMeshInterface()->InternalProcessAllTriangles(&collector, -large, large);
+    } else {
+        btVector3 center;
+        btScalar radius;
+        shape->getBoundingSphere(center, radius);
+        shapes.push_back(World2d::Shape::circle(place(transform, scale, center), radius * scale));
+        std::cerr << "Warning: " << shape->getName() << " is not supported by the 2D physics, using its bounding circle." << std::endl;
+    }
+}
+
+Physics2dBody::Physics2dBody(Entity* entity, World2d* world, btCollisionShape* shape, btScalar mass, const btTransform& transform)
+    : PhysicsBody(entity),
+      m_world(world) {
+    Physics2dWorld::convertShape(shape, btTransform::getIdentity(), 1, m_body.shapes);
+    m_body.setMass(mass);
+    m_body.position = toPlane(transform.getOrigin());
+    m_body.angle = angleOf(transform.getRotation());
+    m_body.user = this;
+}
+
+bool Physics2dBody::isInWorld() const {
+    return m_body.isInWorld();
+}
+
+bool Physics2dBody::isDynamic() const {
+    return !m_body.isStatic();
+}
+
+btTransform Physics2dBody::transform() const {
+    return transformOf(m_body.position, m_body.angle);
+}
+
+void Physics2dBody::setTransform(const btTransform& transform) {
+    m_body.position = toPlane(transform.getOrigin());
+    m_body.angle = angleOf(transform.getRotation());
+    m_world->moved(&m_body);
+}
+
+PhysicsBody::Motion Physics2dBody::motion() const {
+    Motion motion;
+    motion.transform = transform();
+    motion.linearVelocity = btVector3(m_body.velocity.x, m_body.velocity.y, 0);
+    motion.angularVelocity = m_body.angularVelocity;
+    motion.awake = m_body.awake;
+    motion.restTime = m_body.restTime;
+    return motion;
+}
+
+void Physics2dBody::setMotion(const Motion& motion) {
+    m_body.position = toPlane(motion.transform.getOrigin());
+    m_body.angle = angleOf(motion.transform.getRotation());
+    m_body.velocity = toPlane(motion.linearVelocity);
+    m_body.angularVelocity = motion.angularVelocity;
+    m_body.force = glm::vec2(0, 0);
+    m_body.torque = 0;
+    m_body.awake = motion.awake || m_body.isStatic();
+    m_body.restTime = motion.restTime;
+    m_world->moved(&m_body);
+    syncEntity(0);
+}
+
+btVector3 Physics2dBody::linearVelocity() const {
+    return btVector3(m_body.velocity.x, m_body.velocity.y, 0);
+}
+
+void Physics2dBody::setLinearVelocity(const btVector3& velocity) {
+    m_body.velocity = toPlane(velocity);
+}
+
+btScalar Physics2dBody::angularVelocity() const {
+    return m_body.angularVelocity;
+}
+
+void Physics2dBody::setAngularVelocity(btScalar velocity) {
+    m_body.angularVelocity = velocity;
+}
+
+void Physics2dBody::applyCentralForce(const btVector3& force) {
+    m_body.force += toPlane(force);
+}
+
+void Physics2dBody::applyCentralImpulse(const btVector3& impulse) {
+    m_body.velocity += m_body.invMass * toPlane(impulse);
+}
+
+void Physics2dBody::applyTorque(btScalar torque) {
+    m_body.torque += torque;
+}
+
+void Physics2dBody::setShape(btCollisionShape* shape, btScalar mass) {
+    // re-adding moves the body between the static and dynamic shapes
+    bool inWorld = m_body.isInWorld();
+    if(inWorld) m_world->remove(&m_body);
+
+    m_body.shapes.clear();
+    Physics2dWorld::convertShape(shape, btTransform::getIdentity(), 1, m_body.shapes);
+    m_body.setMass(mass);
+
+    if(inWorld) {
+        setBulletFilter(m_body);
+        m_world->add(&m_body);
+    }
+}
+
+void Physics2dBody::setFriction(btScalar friction) {
+    m_body.friction = friction;
+}
+
+void Physics2dBody::setDamping(btScalar linear, btScalar angular) {
+    m_body.linearDamping = linear;
+    m_body.angularDamping = angular;
+}
+
+void Physics2dBody::setAngularFactor(btScalar factor) {
+    m_body.angularFactor = factor;
+}
+
+void Physics2dBody::setGravity(const btVector3& gravity) {
+    m_body.gravity = toPlane(gravity);
+}
+
+void Physics2dBody::setSensor(bool sensor) {
+    m_body.sensor = sensor;
+}
+
+btScalar Physics2dBody::boundingRadius() const {
+    return m_body.boundingRadius;
+}
+
+void Physics2dBody::setCcd(btScalar motionThreshold, btScalar sweptRadius) {
+    m_ccdMotionThreshold = motionThreshold;
+}
+
+btScalar Physics2dBody::ccdMotionThreshold() const {
+    return m_ccdMotionThreshold;
+}
+
+bool Physics2dBody::isAwake() const {
+    return m_body.awake;
+}
+
+void Physics2dBody::wake() {
+    m_world->wake(&m_body);
+}
+
+void Physics2dBody::syncEntity(float remainder) {
+    m_entity->setPosition(m_body.position + m_body.velocity * remainder);
+    m_entity->setRotation(m_body.angle + m_body.angularVelocity * remainder);
+}
+
+Physics2dGhost::Physics2dGhost(btCollisionShape* shape) {
+    Physics2dWorld::convertShape(shape, btTransform::getIdentity(), 1, m_shapes);
+    m_transform.setIdentity();
+}
+
+bool Physics2dGhost::isInWorld() const {
+    return m_inWorld;
+}
+
+btTransform Physics2dGhost::transform() const {
+    return m_transform;
+}
+
+void Physics2dGhost::setTransform(const btTransform& transform) {
+    m_transform = transform;
+}
+
+PhysicsBody* Physics2dWorld::createBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform) {
+    return new Physics2dBody(entity.get(), &m_world, shape, mass, transform);
+}
+
+void Physics2dWorld::addBody(PhysicsBody* physicsBody) {
+    World2d::Body& body = static_cast<Physics2dBody*>(physicsBody)->m_body;
+    setBulletFilter(body);
+    m_world.add(&body);
+}
+
+void Physics2dWorld::removeBody(PhysicsBody* body) {
+    m_world.remove(&static_cast<Physics2dBody*>(body)->m_body);
+}
+
+PhysicsGhost* Physics2dWorld::createGhost(btCollisionShape* shape) {
+    return new Physics2dGhost(shape);
+}
+
+void Physics2dWorld::addGhost(PhysicsGhost* ghost) {
+    if(ghost->isInWorld()) return;
+    static_cast<Physics2dGhost*>(ghost)->m_inWorld = true;
+    m_ghosts.push_back(static_cast<Physics2dGhost*>(ghost));
+}
+
+void Physics2dWorld::removeGhost(PhysicsGhost* ghost) {
+    static_cast<Physics2dGhost*>(ghost)->m_inWorld = false;
+    m_ghosts.erase(std::remove(m_ghosts.begin(), m_ghosts.end(), ghost), m_ghosts.end());
+}
+
+void Physics2dWorld::reset() {
+    m_world.clear();
+    for(auto ghost : m_ghosts) {
+        ghost->m_inWorld = false;
+    }
+    m_ghosts.clear();
+}
+
+void Physics2dWorld::bodiesMoved() {
+    // every body told the world itself when it was moved
+}
+
+void Physics2dWorld::setGravity(const btVector3& gravity) {
+    m_world.setGravity(toPlane(gravity));
+}
+
+int Physics2dWorld::step(btScalar dt, int maxSubsteps, btScalar substep) {
+    int substeps = m_world.step(dt, maxSubsteps, substep);
+
+    // entities are drawn where their bodies will be at the end of the frame
+    for(auto body : m_world.bodies()) {
+        if(!body->isStatic()) {
+            static_cast<Physics2dBody*>(body->user)->syncEntity(m_world.remainder());
+        }
+    }
+    return substeps;
+}
+
+void Physics2dWorld::getContacts(std::vector<PhysicsContact>& contacts) {
+    contacts.clear();
+
+    for(auto& arbiter : m_world.arbiters()) {
+        for(int i = 0; i < arbiter.count; ++i) {
+            // speculative contacts further apart are not touching yet
+            const World2d::Contact& c = arbiter.contacts[i];
+            if(c.separation > World2d::CONTACT_MARGIN) continue;
+
+            PhysicsContact contact;
+            contact.a = static_cast<Physics2dBody*>(arbiter.a->user);
+            contact.b = static_cast<Physics2dBody*>(arbiter.b->user);
+            contact.positionOnA = btVector3(c.pointA.x, c.pointA.y, 0);
+            contact.positionOnB = btVector3(c.pointB.x, c.pointB.y, 0);
+            contact.distance = c.separation;
+            contacts.push_back(contact);
+        }
+    }
+}
+
+void Physics2dWorld::getGhostContacts(PhysicsGhost* physicsGhost, int typeMask, std::vector<EntityCollision>& contacts) {
+    contacts.clear();
+
+    Physics2dGhost* ghost = static_cast<Physics2dGhost*>(physicsGhost);
+    if(!ghost->m_inWorld) return;
+
+    glm::vec2 position = toPlane(ghost->m_transform.getOrigin());
+    float angle = angleOf(ghost->m_transform.getRotation());
+    for(auto& shape : ghost->m_shapes) {
+        m_world.queryShape(shape, position, angle, btBroadphaseProxy::SensorTrigger, btBroadphaseProxy::AllFilter & ~btBroadphaseProxy::SensorTrigger, m_arbiters);
+
+        for(auto& arbiter : m_arbiters) {
+            Entity* entity = static_cast<Physics2dBody*>(arbiter.b->user)->entity();
+            if(!(entity->getTypeFlag() & typeMask)) continue;
+
+            for(int i = 0; i < arbiter.count; ++i) {
+                const World2d::Contact& contact = arbiter.contacts[i];
+                if(contact.separation > World2d::CONTACT_MARGIN) continue;
+
+                EntityCollision c;
+                c.other = entity;
+                c.position = btVector3(contact.pointA.x, contact.pointA.y, 0);
+                c.otherPosition = btVector3(contact.pointB.x, contact.pointB.y, 0);
+                c.distance = contact.separation;
+                contacts.push_back(c);
+            }
+        }
+    }
+}
+
+void Physics2dWorld::rayTest(RayQuery* rays, int count) {
+    if(count <= 0) return;
+
+    // the shapes are only looked up once for the bounding box of the whole batch
+    World2d::Bounds bounds;
+    bounds.lower = bounds.upper = toPlane(rays[0].from);
+    for(int i = 0; i < count; ++i) {
+        bounds.lower = glm::min(bounds.lower, glm::min(toPlane(rays[i].from), toPlane(rays[i].to)));
+        bounds.upper = glm::max(bounds.upper, glm::max(toPlane(rays[i].from), toPlane(rays[i].to)));
+    }
+    m_world.queryBounds(bounds, m_shapes);
+
+    for(int i = 0; i < count; ++i) {
+        RayQuery& ray = rays[i];
+        glm::vec2 from = toPlane(ray.from);
+        glm::vec2 to = toPlane(ray.to);
+
+        World2d::RayHit closest;
+        closest.body = nullptr;
+        closest.fraction = 1;
+        for(auto& ref : m_shapes) {
+            World2d::Body* body = ref.body;
+            if(!(body->group & ray.collisionMask) || !(ray.collisionGroup & body->mask)) continue;
+            if(!(static_cast<Physics2dBody*>(body->user)->entity()->getTypeFlag() & ray.typeMask)) continue;
+
+            World2d::RayHit hit;
+            if(World2d::rayCast(ref, from, to, closest.fraction, hit)) {
+                closest = hit;
+            }
+        }
+
+        ray.hit = closest.body != nullptr;
+        ray.hitFraction = closest.fraction;
+        if(ray.hit) {
+            ray.hitPoint = ray.from.lerp(ray.to, closest.fraction);
+            ray.hitNormal = btVector3(closest.normal.x, closest.normal.y, 0);
+            ray.entity = static_cast<Physics2dBody*>(closest.body->user)->entity();
+        } else {
+            ray.entity = nullptr;
+        }
+    }
+}
+
+void Physics2dWorld::wakeRegion(const btVector3& lower, const btVector3& upper) {
+    World2d::Bounds bounds;
+    bounds.lower = toPlane(lower);
+    bounds.upper = toPlane(upper);
+    m_world.queryBounds(bounds, m_shapes);
+
+    for(auto& ref : m_shapes) {
+        if(!ref.body->awake) {
+            m_world.wake(ref.body);
+        }
+    }
+}
+
+int Physics2dWorld::countAwake() const {
+    int awake = 0;
+    for(auto body : m_world.bodies()) {
+        if(!body->isStatic() && body->awake) awake++;
+    }
+    return awake;
+}
+
+void Physics2dWorld::collectStats(PhysicsFrameStats& stats) {
+    const World2d::Stats& s = m_world.stats();
+    stats.pairs = s.pairs;
+    stats.manifolds = s.manifolds;
+    stats.contacts = s.contacts;
+    stats.islands = s.islands;
+    stats.awakeBodies = countAwake();
+    stats.broadphaseTime = s.broadphaseTime;
+    stats.narrowphaseTime = s.narrowphaseTime;
+    stats.solverTime = s.solverTime;
+}
+
+void Physics2dWorld::debugDraw(DebugDraw* drawer) {
+    // colored like bullet draws awake and sleeping bodies
+    for(auto body : m_world.bodies()) {
+        btVector3 color = body->awake || body->isStatic() ? btVector3(1, 1, 1) : btVector3(0, 1, 0);
+        btTransform transform = transformOf(body->position, body->angle);
+
+        for(auto& shape : body->shapes) {
+            unsigned int n = shape.vertices.size();
+            if(n == 1) {
+                btVector3 center = transform * btVector3(shape.vertices[0].x, shape.vertices[0].y, 0);
+                drawer->drawSphere(center, shape.radius, color);
+                continue;
+            }
+            for(unsigned int i = 0; i < n; ++i) {
+                const glm::vec2& a = shape.vertices[i];
+                const glm::vec2& b = shape.vertices[(i + 1) % n];
+                drawer->drawLine(transform * btVector3(a.x, a.y, 0), transform * btVector3(b.x, b.y, 0), color);
+            }
+        }
+    }
+
+    for(auto& arbiter : m_world.arbiters()) {
+        for(int i = 0; i < arbiter.count; ++i) {
+            const World2d::Contact& c = arbiter.contacts[i];
+            btVector3 normal(arbiter.normal.x, arbiter.normal.y, 0);
+            drawer->drawContactPoint(btVector3(c.pointB.x, c.pointB.y, 0), -normal, c.separation, 0, btVector3(1, 1, 0));
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef PHYSICS2DWORLD_HPP
+#define PHYSICS2DWORLD_HPP
+
+#include "PhysicsWorld.hpp"
+#include "World2d.hpp"
+
+class Physics2dBody : public PhysicsBody {
+public:
+    Physics2dBody(Entity* entity, World2d* world, btCollisionShape* shape, btScalar mass, const btTransform& transform);
+
+    bool isInWorld() const override;
+    bool isDynamic() const override;
+
+    btTransform transform() const override;
+    void setTransform(const btTransform& transform) override;
+    Motion motion() const override;
+    void setMotion(const Motion& motion) override;
+
+    btVector3 linearVelocity() const override;
+    void setLinearVelocity(const btVector3& velocity) override;
+    btScalar angularVelocity() const override;
+    void setAngularVelocity(btScalar velocity) override;
+
+    void applyCentralForce(const btVector3& force) override;
+    void applyCentralImpulse(const btVector3& impulse) override;
+    void applyTorque(btScalar torque) override;
+
+    void setShape(btCollisionShape* shape, btScalar mass) override;
+    void setFriction(btScalar friction) override;
+    void setDamping(btScalar linear, btScalar angular) override;
+    void setAngularFactor(btScalar factor) override;
+    void setGravity(const btVector3& gravity) override;
+    void setSensor(bool sensor) override;
+
+    btScalar boundingRadius() const override;
+    // Contacts are speculative, nothing tunnels, so this is only remembered
+    void setCcd(btScalar motionThreshold, btScalar sweptRadius) override;
+    btScalar ccdMotionThreshold() const override;
+
+    bool isAwake() const override;
+    void wake() override;
+
+    // moves the entity to where the body will be remainder seconds ahead
+    void syncEntity(float remainder);
+
+private:
+    World2d::Body m_body;
+    World2d* m_world;
+    btScalar m_ccdMotionThreshold = 0;
+
+    friend class Physics2dWorld;
+};
+
+class Physics2dGhost : public PhysicsGhost {
+public:
+    Physics2dGhost(btCollisionShape* shape);
+
+    bool isInWorld() const override;
+    btTransform transform() const override;
+    void setTransform(const btTransform& transform) override;
+
+private:
+    std::vector<World2d::Shape> m_shapes;
+    btTransform m_transform;
+    bool m_inWorld = false;
+
+    friend class Physics2dWorld;
+};
+
+// The native backend: World2d behind the PhysicsWorld interface. Bullet's
+// shapes are flattened into the plane when bodies are created.
+class Physics2dWorld : public PhysicsWorld {
+public:
+    PhysicsBody* createBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform) override;
+    void addBody(PhysicsBody* body) override;
+    void removeBody(PhysicsBody* body) override;
+
+    PhysicsGhost* createGhost(btCollisionShape* shape) override;
+    void addGhost(PhysicsGhost* ghost) override;
+    void removeGhost(PhysicsGhost* ghost) override;
+
+    void reset() override;
+    void bodiesMoved() override;
+
+    void setGravity(const btVector3& gravity) override;
+    int step(btScalar dt, int maxSubsteps, btScalar substep) override;
+
+    void getContacts(std::vector<PhysicsContact>& contacts) override;
+    void getGhostContacts(PhysicsGhost* ghost, int typeMask, std::vector<EntityCollision>& contacts) override;
+    void rayTest(RayQuery* rays, int count) override;
+
+    void wakeRegion(const btVector3& lower, const btVector3& upper) override;
+    int countAwake() const override;
+
+    void collectStats(PhysicsFrameStats& stats) override;
+    void debugDraw(DebugDraw* drawer) override;
+
+    // appends the shapes of a bullet shape placed at transform
+    static void convertShape(const btCollisionShape* shape, const btTransform& transform, btScalar scale, std::vector<World2d::Shape>& shapes);
+
+private:
+    World2d m_world;
+    std::vector<World2d::ShapeRef> m_shapes;
+    std::vector<World2d::Arbiter> m_arbiters;
+    std::vector<Physics2dGhost*> m_ghosts;
+};
+
+#endif
@@ -0,0 +1,8 @@
+#include "PhysicsBackend.hpp"
+
+PhysicsBackend::Type PhysicsBackend::type = PhysicsBackend::BULLET;
+
+std::string PhysicsBackend::name(PhysicsBackend::Type backend) {
+    return backend == NATIVE_2D ? "native-2d" : "bullet";
+}
+
@@ -0,0 +1,21 @@
+#ifndef PHYSICSBACKEND_HPP
+#define PHYSICSBACKEND_HPP
+
+#include <string>
+
+// Selects the simulation behind the PhysicsWorld of new states.
+// BULLET is bullet with the bodies locked to the XY plane, the reference.
+// NATIVE_2D is World2d, a rigid body simulation made for the plane.
+class PhysicsBackend {
+public:
+    enum Type {
+        BULLET,
+        NATIVE_2D
+    };
+
+    // backend for worlds created afterwards
+    static Type type;
+    static std::string name(Type type);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "PhysicsProfiler.hpp"
+#include "PhysicsWorld.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+#include <LinearMath/btQuickprof.h>
+
+PhysicsProfiler::PhysicsProfiler()
+    : m_limitHitCount(0) {}
+
+void PhysicsProfiler::beginFrame() {
+    m_current = PhysicsFrameStats();
+#ifndef BT_NO_PROFILE
+    CProfileManager::Reset();
+#endif
+}
+
+void PhysicsProfiler::recordStepping(float substepSize, float maxSpeed, int ccdBodies) {
+    m_current.substepSize = substepSize;
+    m_current.maxSpeed = maxSpeed;
+    m_current.ccdBodies = ccdBodies;
+}
+
+void PhysicsProfiler::endFrame(PhysicsWorld* world, float time, float dt, int substeps, int maxSubsteps, float stepTime) {
+    PhysicsFrameStats stats = m_current;
+    stats.time = time;
+    stats.dt = dt;
+    stats.substeps = substeps;
+    stats.stepTime = stepTime;
+    world->collectStats(stats);
+
+    m_last = stats;
+    m_history.push_back(stats);
+    m_limitHits.push_back(substeps >= maxSubsteps);
+    if(substeps >= maxSubsteps) m_limitHitCount++;
+
+    if(m_history.size() > HISTORY) {
+        if(m_limitHits.front()) m_limitHitCount--;
+        m_history.pop_front();
+        m_limitHits.pop_front();
+    }
+}
+
+void PhysicsProfiler::clear() {
+    m_history.clear();
+    m_limitHits.clear();
+    m_limitHitCount = 0;
+    m_last = PhysicsFrameStats();
+}
+
+const PhysicsFrameStats& PhysicsProfiler::last() const {
+    return m_last;
+}
+
+const std::deque<PhysicsFrameStats>& PhysicsProfiler::history() const {
+    return m_history;
+}
+
+int PhysicsProfiler::substepLimitHits() const {
+    return m_limitHitCount;
+}
+
+std::string PhysicsProfiler::summary() const {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(2);
+    s << "substeps " << m_last.substeps << " of " << m_last.substepSize * 1000 << " ms (limit hit " << m_limitHitCount << "x)\n";
+    s << "max speed " << m_last.maxSpeed << " sizes/s  ccd " << m_last.ccdBodies << "\n";
+    s << "pairs " << m_last.pairs << "  manifolds " << m_last.manifolds << "  contacts " << m_last.contacts << "\n";
+    s << "islands " << m_last.islands << "  awake " << m_last.awakeBodies << "\n";
+    s << "step " << m_last.stepTime << " ms  broad " << m_last.broadphaseTime
+      << "  narrow " << m_last.narrowphaseTime << "  solver " << m_last.solverTime;
+    return s.str();
+}
+
+bool PhysicsProfiler::writeCsv(const std::string& filename) const {
+    std::ofstream stream(filename);
+    if(!stream) {
+        std::cerr << "Warning: could not write " << filename << "." << std::endl;
+        return false;
+    }
+
+    stream << "time,dt,substeps,substep_size,max_speed,ccd_bodies,pairs,manifolds,contacts,islands,awake,step_ms,broadphase_ms,narrowphase_ms,solver_ms" << std::endl;
+    for(auto& f : m_history) {
+        stream << f.time << "," << f.dt << "," << f.substeps << "," << f.substepSize << "," << f.maxSpeed << ","
+               << f.ccdBodies << "," << f.pairs << "," << f.manifolds << ","
+               << f.contacts << "," << f.islands << "," << f.awakeBodies << "," << f.stepTime << ","
+               << f.broadphaseTime << "," << f.narrowphaseTime << "," << f.solverTime << std::endl;
+    }
+    return true;
+}
+
+bool PhysicsProfiler::writeJson(const std::string& filename) const {
+    std::ofstream stream(filename);
+    if(!stream) {
+        std::cerr << "Warning: could not write " << filename << "." << std::endl;
+        return false;
+    }
+
+    stream << "{\n  \"substepLimitHits\": " << m_limitHitCount << ",\n  \"frames\": [";
+    bool first = true;
+    for(auto& f : m_history) {
+        stream << (first ? "\n" : ",\n");
+        stream << "    {\"time\": " << f.time << ", \"dt\": " << f.dt << ", \"substeps\": " << f.substeps
+               << ", \"substepSize\": " << f.substepSize << ", \"maxSpeed\": " << f.maxSpeed << ", \"ccdBodies\": " << f.ccdBodies
+               << ", \"pairs\": " << f.pairs << ", \"manifolds\": " << f.manifolds << ", \"contacts\": " << f.contacts
+               << ", \"islands\": " << f.islands << ", \"awake\": " << f.awakeBodies << ", \"stepMs\": " << f.stepTime
+               << ", \"broadphaseMs\": " << f.broadphaseTime << ", \"narrowphaseMs\": " << f.narrowphaseTime
+               << ", \"solverMs\": " << f.solverTime << "}";
+        first = false;
+    }
+    stream << "\n  ]\n}" << std::endl;
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef PHYSICSPROFILER_HPP
+#define PHYSICSPROFILER_HPP
+
+#include <deque>
+#include <string>
+
+class PhysicsWorld;
+
+struct PhysicsFrameStats {
+    float time = 0;
+    float dt = 0;
+    int substeps = 0;
+    float substepSize = 0;
+    float maxSpeed = 0;   // fastest body relative to its size, in sizes per second
+    int ccdBodies = 0;
+    int pairs = 0;
+    int manifolds = 0;
+    int contacts = 0;
+    int islands = 0;
+    int awakeBodies = 0;
+
+    // milliseconds, with the bullet backend the phase times need bullet built with profiling
+    float stepTime = 0;
+    float broadphaseTime = 0;
+    float narrowphaseTime = 0;
+    float solverTime = 0;
+};
+
+// Records what the physics world did in each frame, for the debug overlay
+// and for dumps to compare levels. A frame that runs into the substep
+// limit means the simulation can't keep up with real time anymore.
+class PhysicsProfiler {
+public:
+    // number of frames kept in the history
+    static const unsigned int HISTORY = 3600;
+
+    PhysicsProfiler();
+
+    void beginFrame();
+    // how State chose the substeps of the current frame
+    void recordStepping(float substepSize, float maxSpeed, int ccdBodies);
+    void endFrame(PhysicsWorld* world, float time, float dt, int substeps, int maxSubsteps, float stepTime);
+    void clear();
+
+    const PhysicsFrameStats& last() const;
+    const std::deque<PhysicsFrameStats>& history() const;
+    // frames in the history that ran the maximum number of substeps
+    int substepLimitHits() const;
+
+    // multi-line text for the overlay
+    std::string summary() const;
+
+    bool writeCsv(const std::string& filename) const;
+    bool writeJson(const std::string& filename) const;
+
+private:
+    std::deque<PhysicsFrameStats> m_history;
+    std::deque<bool> m_limitHits;
+    int m_limitHitCount;
+    PhysicsFrameStats m_last;
+    PhysicsFrameStats m_current;
+};
+
+#endif
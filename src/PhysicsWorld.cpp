@@ -0,0 +1,14 @@
+#include "PhysicsWorld.hpp"
+
+PhysicsBody::PhysicsBody(Entity* entity)
+    : m_entity(entity) {}
+
+PhysicsBody::~PhysicsBody() {}
+
+Entity* PhysicsBody::entity() const {
+    return m_entity;
+}
+
+PhysicsGhost::~PhysicsGhost() {}
+
+PhysicsWorld::~PhysicsWorld() {}
@@ -0,0 +1,158 @@
+#ifndef PHYSICSWORLD_HPP
+#define PHYSICSWORLD_HPP
+
+#include <memory>
+#include <vector>
+#include <btBulletDynamicsCommon.h>
+
+#include "Entity.hpp"
+
+class DebugDraw;
+struct PhysicsFrameStats;
+
+// One ray of a batched ray test, see PhysicsWorld::rayTest
+struct RayQuery {
+    btVector3 from;
+    btVector3 to;
+    short collisionGroup = btBroadphaseProxy::DefaultFilter;
+    short collisionMask = btBroadphaseProxy::AllFilter;
+    int typeMask = Entity::TYPE_ALL;
+
+    // results
+    bool hit = false;
+    btScalar hitFraction = 1;
+    btVector3 hitPoint;
+    btVector3 hitNormal;
+    Entity* entity = nullptr;
+};
+
+class PhysicsBody;
+
+// a contact point between two bodies after the last step
+struct PhysicsContact {
+    PhysicsBody* a;
+    PhysicsBody* b;
+    btVector3 positionOnA;
+    btVector3 positionOnB;
+    btScalar distance;
+};
+
+// The rigid body of an entity. Bodies live in the XY plane and only turn
+// around Z, so rotations and angular velocities are single angles.
+class PhysicsBody {
+public:
+    // what a snapshot needs to put the body back where it was
+    struct Motion {
+        btTransform transform;
+        btVector3 linearVelocity;
+        btScalar angularVelocity;
+        bool awake;
+        btScalar restTime;
+    };
+
+    PhysicsBody(Entity* entity);
+    virtual ~PhysicsBody();
+
+    Entity* entity() const;
+
+    virtual bool isInWorld() const = 0;
+    // moved by the simulation, as opposed to static level geometry
+    virtual bool isDynamic() const = 0;
+
+    virtual btTransform transform() const = 0;
+    virtual void setTransform(const btTransform& transform) = 0;
+
+    virtual Motion motion() const = 0;
+    // also clears the forces
+    virtual void setMotion(const Motion& motion) = 0;
+
+    virtual btVector3 linearVelocity() const = 0;
+    virtual void setLinearVelocity(const btVector3& velocity) = 0;
+    virtual btScalar angularVelocity() const = 0;
+    virtual void setAngularVelocity(btScalar velocity) = 0;
+
+    // forces last until the end of the next PhysicsWorld::step
+    virtual void applyCentralForce(const btVector3& force) = 0;
+    virtual void applyCentralImpulse(const btVector3& impulse) = 0;
+    virtual void applyTorque(btScalar torque) = 0;
+
+    // mass 0 makes the body static
+    virtual void setShape(btCollisionShape* shape, btScalar mass) = 0;
+    virtual void setFriction(btScalar friction) = 0;
+    virtual void setDamping(btScalar linear, btScalar angular) = 0;
+    virtual void setAngularFactor(btScalar factor) = 0;
+    virtual void setGravity(const btVector3& gravity) = 0;
+    // sensors report contacts, but don't push anything
+    virtual void setSensor(bool sensor) = 0;
+
+    virtual btScalar boundingRadius() const = 0;
+    // Sweeps the body when it moves further than motionThreshold in one
+    // substep, 0 disables it. Backends without tunneling may ignore it.
+    virtual void setCcd(btScalar motionThreshold, btScalar sweptRadius) = 0;
+    virtual btScalar ccdMotionThreshold() const = 0;
+
+    virtual bool isAwake() const = 0;
+    virtual void wake() = 0;
+
+protected:
+    Entity* m_entity;
+};
+
+// A shape that doesn't take part in the simulation, but can be asked what
+// it overlaps. It never touches other ghosts.
+class PhysicsGhost {
+public:
+    virtual ~PhysicsGhost();
+
+    virtual bool isInWorld() const = 0;
+    virtual btTransform transform() const = 0;
+    virtual void setTransform(const btTransform& transform) = 0;
+};
+
+// The physics simulation behind a State. Shapes are described with bullet's
+// collision shapes everywhere, each backend turns them into its own. The
+// bullet backend is the reference, see BulletPhysicsWorld and Physics2dWorld.
+class PhysicsWorld {
+public:
+    virtual ~PhysicsWorld();
+
+    // Builds the body without adding it to the world. Not thread safe,
+    // bullet numbers its bodies from an unguarded counter. inertia is the
+    // shape's local inertia, which is safe to compute up front, backends
+    // that derive their own ignore it. Backends may keep the entity alive
+    // for as long as the body exists.
+    virtual PhysicsBody* createBody(std::shared_ptr<Entity> entity, btCollisionShape* shape, btScalar mass, const btVector3& inertia, const btTransform& transform) = 0;
+    virtual void addBody(PhysicsBody* body) = 0;
+    virtual void removeBody(PhysicsBody* body) = 0;
+
+    virtual PhysicsGhost* createGhost(btCollisionShape* shape) = 0;
+    virtual void addGhost(PhysicsGhost* ghost) = 0;
+    virtual void removeGhost(PhysicsGhost* ghost) = 0;
+
+    // Takes everything out of the world but keeps its memory for the next level.
+    virtual void reset() = 0;
+    // after bodies were moved around by hand, e.g. restoring a snapshot
+    virtual void bodiesMoved() = 0;
+
+    virtual void setGravity(const btVector3& gravity) = 0;
+    // Steps in substeps of the given size like btDynamicsWorld::stepSimulation
+    // and returns the number of substeps that were due.
+    virtual int step(btScalar dt, int maxSubsteps, btScalar substep) = 0;
+
+    // all touching contact points after the last step
+    virtual void getContacts(std::vector<PhysicsContact>& contacts) = 0;
+    // Contacts of the ghost with the bodies of entities matching typeMask.
+    // c.position is the point on the ghost, c.otherPosition the one on the other body.
+    virtual void getGhostContacts(PhysicsGhost* ghost, int typeMask, std::vector<EntityCollision>& contacts) = 0;
+    // Casts all rays against entities matching their filters.
+    virtual void rayTest(RayQuery* rays, int count) = 0;
+
+    virtual void wakeRegion(const btVector3& lower, const btVector3& upper) = 0;
+    virtual int countAwake() const = 0;
+
+    // fills in the pairs, contacts, islands and phase times of the last step
+    virtual void collectStats(PhysicsFrameStats& stats) = 0;
+    virtual void debugDraw(DebugDraw* drawer) = 0;
+};
+
+#endif
@@ -11,6 +11,10 @@
 #include "Marker.hpp"
 #include "Pair.hpp"
 #include "Foot.hpp"
+#include "Snapshot.hpp"
+
+// bodies within this distance of the player are kept awake
+static const float WAKE_RADIUS = 3.f;
 
 Player::Player() {
     m_sprite.setTexture(* Root().resources.getTexture("body").get());
@@ -19,7 +23,7 @@ Player::Player() {
 
     m_mass = 1.f;
     m_ability = WALK;
-    m_physicsShape = new btSphereShape(0.25);
+    m_physicsShape = Root().shapes.sphere(0.25);
 
     // Create foreground feet
     for(size_t i = 0; i < 4; ++i) m_foregroundFeet.push_back(std::make_shared<Foot>(this, i, false));
@@ -31,26 +35,29 @@ Player::Player() {
     m_rotation = thor::Pi;
 }
 
+Player::~Player() {
+    delete m_ghost;
+}
+
 std::string Player::getTypeName() const {
     return "Player";
 }
 
+Entity::TypeFlag Player::getTypeFlag() const {
+    return TYPE_PLAYER;
+}
+
 void Player::onUpdate(double dt) {
     // Check ghost collisions
-    m_ghostObject->setWorldTransform(m_physicsBody->getWorldTransform());
-    auto m = m_state->getBodyContacts(m_ghostObject);
+    m_ghost->setTransform(m_physicsBody->transform());
+    btVector3 origin = m_ghost->transform().getOrigin();
     btVector3 total(0, 0, 0);
-    for(auto pair : m) {
-        if(pair.first == this) continue;
-        for(auto c : pair.second) {
-            if(c.other->getTypeName() == "CollisionShape" || c.other->getTypeName() == "Toy" || c.other->getTypeName() == "Egg") {
-                auto d = c.position - m_ghostObject->getWorldTransform().getOrigin();
-                if(d.y() > 0 || m_ability >= WALLS) {
-                    total += d;
-                }
-            }
+    m_state->visitGhostContacts(m_ghost, TYPE_COLLISION_SHAPE | TYPE_TOY | TYPE_EGG, [&](const EntityCollision& c) {
+        auto d = c.otherPosition - origin;
+        if(d.y() > 0 || m_ability >= WALLS) {
+            total += d;
         }
-    }
+    });
 
     m_onGround = total.length2() > 0;
 
@@ -85,7 +92,7 @@ void Player::onUpdate(double dt) {
         float walkSpeed = 1.5;
         float airAccel = 2.f;
 
-        btVector3 lin = m_physicsBody->getLinearVelocity();
+        btVector3 lin = m_physicsBody->linearVelocity();
         lin = lin.rotate(ZAXIS, -m_rotation);
 
         m_walkSound.pause();
@@ -132,6 +139,15 @@ void Player::onUpdate(double dt) {
     for(auto foot : m_foregroundFeet) foot->handleUpdate(dt);
     for(auto foot : m_backgroundFeet) foot->handleUpdate(dt);
 
+    // cast all leg rays in one batch
+    m_legRays.clear();
+    for(auto foot : m_foregroundFeet) m_legRays.push_back(foot->legRay());
+    for(auto foot : m_backgroundFeet) m_legRays.push_back(foot->legRay());
+    m_state->rayTestBatch(m_legRays.data(), m_legRays.size());
+    size_t ray = 0;
+    for(auto foot : m_foregroundFeet) { foot->legRay() = m_legRays[ray++]; foot->onLegRay(); }
+    for(auto foot : m_backgroundFeet) { foot->legRay() = m_legRays[ray++]; foot->onLegRay(); }
+
     // Apply manual gravity in the direction of current rotation to simulate stickyness to walls
     if(m_ability >= WALLS) {
         m_physicsBody->applyCentralForce(btVector3(0, -9.81, 0));
@@ -157,7 +173,7 @@ void Player::onDraw(sf::RenderTarget& target) {
     m_sprite.setScale(0.4 * m_scale.x / m_sprite.getTexture()->getSize().x * m_direction, 0.4 * m_scale.y / m_sprite.getTexture()->getSize().x);
     m_sprite.setOrigin(m_sprite.getTexture()->getSize().x / 2, m_sprite.getTexture()->getSize().y / 2);
     m_sprite.setRotation(180 + thor::toDegree(m_rotation));
-    target.draw(m_sprite);
+    m_state->spriteBatch().draw(m_sprite);
 
     // Draw foreground legs
     for(auto foot : m_foregroundFeet) foot->handleDraw(target);
@@ -166,15 +182,19 @@ void Player::onDraw(sf::RenderTarget& target) {
 void Player::onAdd(State* state) {
     m_physicsBody->setDamping(0.5, 5);
     m_physicsBody->setAngularFactor(0.2);
-    m_physicsBody->setCollisionFlags(btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK|btCollisionObject::CF_CHARACTER_OBJECT);
-    m_physicsBody->forceActivationState(DISABLE_DEACTIVATION);
+    // the player and everything around it never falls asleep
+    state->sleepManager().addWakeVolume(this, WAKE_RADIUS);
+
+    // pairs and goal markers are reported to the player when touched
+    setContactEvents(EntityCollision::BEGIN);
 
     // set up ghost object
-    m_ghostObject = new btGhostObject();
-    m_ghostObject->setCollisionShape(new btSphereShape(0.35));
-    m_ghostObject->setCollisionFlags(m_ghostObject->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
-    // m_ghostObject->setUserPointer((void*)this);
-    m_state->dynamicsWorld()->addCollisionObject(m_ghostObject, btBroadphaseProxy::SensorTrigger, btBroadphaseProxy::AllFilter & ~btBroadphaseProxy::SensorTrigger);
+    if(!m_ghost) {
+        m_ghostShape = Root().shapes.sphere(0.35);
+        m_ghost = state->physics()->createGhost(m_ghostShape.get());
+    }
+    m_ghost->setTransform(m_physicsBody->transform());
+    state->physics()->addGhost(m_ghost);
 
     m_scale_y = 0.18;
     tween::TweenerParam param(1000, tween::SINE, tween::EASE_IN_OUT);
@@ -183,6 +203,27 @@ void Player::onAdd(State* state) {
     state->m_tweener.addTween(param);
 }
 
+void Player::onRemove(State* state) {
+    state->physics()->removeGhost(m_ghost);
+}
+
+void Player::onSnapshot(Snapshot& snapshot) {
+    snapshot.io(m_ability);
+    snapshot.io(m_springPower);
+    snapshot.io(m_onGround);
+    snapshot.io(m_direction);
+    snapshot.io(m_scale_y);
+
+    for(auto foot : m_foregroundFeet) foot->handleSnapshot(snapshot);
+    for(auto foot : m_backgroundFeet) foot->handleSnapshot(snapshot);
+
+    // the ghost object leaves the world together with the player
+    if(snapshot.mode() == Snapshot::RESTORE && !m_ghost->isInWorld()) {
+        m_state->physics()->addGhost(m_ghost);
+        m_state->sleepManager().addWakeVolume(this, WAKE_RADIUS);
+    }
+}
+
 bool Player::onCollide(Entity* other, const EntityCollision& c) {
     if(m_state == &Root().editor_state) return false;
 
@@ -3,7 +3,6 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
-#include <BulletCollision/CollisionDispatch/btGhostObject.h>
 
 #include "Entity.hpp"
 #include "Foot.hpp"
@@ -11,12 +10,16 @@
 class Player : public Entity {
 public:
     Player();
+    ~Player();
 
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
 
     void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget& target) override;
     void onAdd(State *state) override;
+    void onRemove(State *state) override;
+    void onSnapshot(Snapshot& snapshot) override;
     bool onCollide(Entity* other, const EntityCollision& c) override;
     void onHandleEvent(sf::Event& event) override;
 
@@ -45,13 +48,15 @@ public:
 
 private:
     sf::Sprite m_sprite;
-    btGhostObject* m_ghostObject;
+    PhysicsGhost* m_ghost = nullptr;
+    std::shared_ptr<btCollisionShape> m_ghostShape;
     float m_springPower = 0;
     bool m_onGround = false;
     int m_direction = 1;
 
     std::vector<std::shared_ptr<Foot>> m_foregroundFeet;
     std::vector<std::shared_ptr<Foot>> m_backgroundFeet;
+    std::vector<RayQuery> m_legRays;
 
     Ability m_ability;
 };
@@ -0,0 +1,145 @@
+#include "PostProcessing.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Root.hpp"
+
+PostProcessing::Quality PostProcessing::quality = PostProcessing::QUALITY_HIGH;
+
+// blur radius at the corners of the screen, in window pixels
+static const float BLUR_SIZE = 2.5f;
+
+// pool slots of the textures used within a frame
+enum {
+    SLOT_SCENE,
+    SLOT_FOG,
+    SLOT_BLUR_HORIZONTAL,
+    SLOT_BLUR_VERTICAL
+};
+
+std::string PostProcessing::qualityName(Quality quality) {
+    if(quality == QUALITY_LOW) return "low";
+    if(quality == QUALITY_MEDIUM) return "medium";
+    return "high";
+}
+
+PostProcessing::Quality PostProcessing::qualityByName(const std::string& name) {
+    if(name == "low") return QUALITY_LOW;
+    if(name == "medium") return QUALITY_MEDIUM;
+    if(name != "high") {
+        std::cerr << "Warning: unknown quality " << name << ", using high." << std::endl;
+    }
+    return QUALITY_HIGH;
+}
+
+PostProcessing::Settings PostProcessing::settings(Quality quality) {
+    Settings s;
+    if(quality == QUALITY_LOW) {
+        s.fogScale = 0.25f;
+        s.blurScale = 0.f;
+        s.pixel = false;
+    } else if(quality == QUALITY_MEDIUM) {
+        s.fogScale = 0.5f;
+        s.blurScale = 0.25f;
+        s.pixel = true;
+    } else {
+        s.fogScale = 0.5f;
+        s.blurScale = 0.5f;
+        s.pixel = true;
+    }
+    return s;
+}
+
+PostProcessing::PostProcessing()
+    : m_scene(nullptr),
+      m_fog(nullptr) {}
+
+sf::RenderTexture& PostProcessing::begin(const sf::Vector2u& size, const sf::Color& color) {
+    Root().renderTargets.nextFrame();
+
+    m_settings = settings(quality);
+    m_size = size;
+    m_fog = nullptr;
+    m_scene = &Root().renderTargets.get(size, SLOT_SCENE);
+    m_scene->setView(m_scene->getDefaultView());
+    m_scene->clear(color);
+    return *m_scene;
+}
+
+sf::RenderTexture& PostProcessing::fog() {
+    if(!m_fog) {
+        m_fog = &Root().renderTargets.get(scaled(m_settings.fogScale), SLOT_FOG);
+        m_fog->clear();
+    }
+    return *m_fog;
+}
+
+void PostProcessing::applyFog(const sf::BlendMode& blendMode) {
+    if(!m_fog) return;
+
+    float w = m_size.x;
+    float h = m_size.y;
+    auto shader = Root().resources.getShader("fog");
+    shader->setParameter("size", w, h);
+
+    // bilinear upscaling to the scene size
+    sf::Sprite sprite(m_fog->getTexture());
+    sprite.setScale(w / m_fog->getSize().x, h / m_fog->getSize().y);
+    m_scene->setView(sf::View(sf::FloatRect(0, h, w, -h)));
+    m_scene->draw(sprite, sf::RenderStates(blendMode, sf::RenderStates::Default.transform, sf::RenderStates::Default.texture, shader.get()));
+    m_scene->setView(m_scene->getDefaultView());
+}
+
+void PostProcessing::end(sf::RenderTarget& target, bool blur, bool pixel) {
+    float w = m_size.x;
+    float h = m_size.y;
+    m_scene->setView(m_scene->getDefaultView());
+    target.setView(sf::View(sf::FloatRect(0, h, w, -h)));
+
+    pixel = pixel && m_settings.pixel;
+    blur = blur && pixel && m_settings.blurScale > 0;
+
+    // the blur passes soften the whole frame, so they can run at a
+    // fraction of the resolution and the pixel pass scales them back up
+    const sf::Texture* blurred = &m_scene->getTexture();
+    if(blur) {
+        sf::Vector2u size = scaled(m_settings.blurScale);
+        auto& horizontal = Root().renderTargets.get(size, SLOT_BLUR_HORIZONTAL);
+        auto& vertical = Root().renderTargets.get(size, SLOT_BLUR_VERTICAL);
+
+        auto horizontalBlur = Root().resources.getShader("blur-horizontal");
+        auto verticalBlur   = Root().resources.getShader("blur-vertical");
+        horizontalBlur->setParameter("blurSize", BLUR_SIZE / w);
+        verticalBlur->setParameter("blurSize", BLUR_SIZE / h);
+
+        sf::Sprite sprite(m_scene->getTexture());
+        sprite.setScale((float)size.x / m_size.x, (float)size.y / m_size.y);
+        horizontal.setView(horizontal.getDefaultView());
+        horizontal.draw(sprite, horizontalBlur.get());
+
+        sprite = sf::Sprite(horizontal.getTexture());
+        vertical.setView(vertical.getDefaultView());
+        vertical.draw(sprite, verticalBlur.get());
+
+        blurred = &vertical.getTexture();
+    }
+
+    sf::Sprite sprite(m_scene->getTexture());
+    if(pixel) {
+        auto shader = Root().resources.getShader("pixel");
+        shader->setParameter("size", w, h);
+        shader->setParameter("blurred", *blurred);
+        shader->setParameter("blur", blur ? 1.f : 0.f);
+        target.draw(sprite, shader.get());
+    } else {
+        target.draw(sprite);
+    }
+
+    m_scene = nullptr;
+    m_fog = nullptr;
+}
+
+sf::Vector2u PostProcessing::scaled(float scale) const {
+    return sf::Vector2u(std::max(1u, (unsigned int)(m_size.x * scale)), std::max(1u, (unsigned int)(m_size.y * scale)));
+}
@@ -0,0 +1,52 @@
+#ifndef POSTPROCESSING_HPP
+#define POSTPROCESSING_HPP
+
+#include <string>
+#include <SFML/Graphics.hpp>
+
+// The frame is drawn into a scene texture from the shared render target
+// pool. The fog layer and the blur run on smaller textures and are scaled
+// up with bilinear filtering. The pixel pass then takes the blurred image
+// instead of the scene, if there is one, adds vignette and noise, and draws
+// the result to the window. Which passes run and at what resolution
+// depends on the quality.
+class PostProcessing {
+public:
+    enum Quality {
+        QUALITY_LOW,        // quarter resolution fog, no blur, no pixel pass
+        QUALITY_MEDIUM,     // half resolution fog, quarter resolution blur
+        QUALITY_HIGH        // half resolution fog and blur
+    };
+
+    struct Settings {
+        float fogScale;     // of the window size
+        float blurScale;    // of the window size, 0 disables the blur
+        bool pixel;
+    };
+
+    static Quality quality;
+    static std::string qualityName(Quality quality);
+    static Quality qualityByName(const std::string& name);
+    static Settings settings(Quality quality);
+
+    PostProcessing();
+
+    // Starts a frame of the given size and returns the cleared scene.
+    sf::RenderTexture& begin(const sf::Vector2u& size, const sf::Color& color = sf::Color::Black);
+    // the fog layer of this frame, cleared on first use
+    sf::RenderTexture& fog();
+    // draws the fog layer onto the scene through the fog shader
+    void applyFog(const sf::BlendMode& blendMode);
+    // runs the remaining passes and draws the scene to target
+    void end(sf::RenderTarget& target, bool blur = true, bool pixel = true);
+
+private:
+    sf::Vector2u scaled(float scale) const;
+
+    Settings m_settings;
+    sf::Vector2u m_size;
+    sf::RenderTexture* m_scene;
+    sf::RenderTexture* m_fog;
+};
+
+#endif
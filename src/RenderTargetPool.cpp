@@ -0,0 +1,38 @@
+#include "RenderTargetPool.hpp"
+
+#include <iostream>
+
+RenderTargetPool::RenderTargetPool()
+    : m_frame(0) {}
+
+sf::RenderTexture& RenderTargetPool::get(const sf::Vector2u& size, int slot) {
+    Target& target = m_targets[Key(size.x, size.y, slot)];
+    if(!target.texture) {
+        target.texture.reset(new sf::RenderTexture());
+        if(!target.texture->create(size.x, size.y)) {
+            std::cerr << "Warning: could not create a " << size.x << "x" << size.y << " render texture." << std::endl;
+        }
+        target.texture->setSmooth(true);
+    }
+    target.frame = m_frame;
+    return *target.texture;
+}
+
+void RenderTargetPool::nextFrame() {
+    for(auto it = m_targets.begin(); it != m_targets.end(); ) {
+        if(it->second.frame < m_frame) {
+            it = m_targets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_frame++;
+}
+
+void RenderTargetPool::clear() {
+    m_targets.clear();
+}
+
+size_t RenderTargetPool::size() const {
+    return m_targets.size();
+}
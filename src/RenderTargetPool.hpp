@@ -0,0 +1,36 @@
+#ifndef RENDERTARGETPOOL_HPP
+#define RENDERTARGETPOOL_HPP
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <SFML/Graphics.hpp>
+
+// Render textures shared by all states. Only one state draws per frame, so
+// the game and the menu end up using the same textures. Textures that were
+// not asked for during a whole frame, e.g. after the window was resized,
+// are dropped.
+class RenderTargetPool {
+public:
+    RenderTargetPool();
+
+    // slot tells apart textures of the same size used in the same frame
+    sf::RenderTexture& get(const sf::Vector2u& size, int slot = 0);
+    void nextFrame();
+
+    void clear();
+    size_t size() const;
+
+private:
+    struct Target {
+        std::unique_ptr<sf::RenderTexture> texture;
+        unsigned long frame;
+    };
+
+    typedef std::tuple<unsigned int, unsigned int, int> Key;
+
+    std::map<Key, Target> m_targets;
+    unsigned long m_frame;
+};
+
+#endif
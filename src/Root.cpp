@@ -1,6 +1,9 @@
 #include "Root.hpp"
 
 ResourceManager Root::resources;
+ShapeCache Root::shapes;
+RenderTargetPool Root::renderTargets;
+TextCache Root::text;
 GameState Root::game_state;
 EditorState Root::editor_state;
 MenuState Root::menu_state;
@@ -8,3 +11,46 @@ std::stack<State*> Root::states;
 sf::RenderWindow* Root::window;
 
 bool Root::debug = true;
+
+void Root::loadResources() {
+    resources.addTexture("player",           "data/textures/player.png");
+    resources.addTexture("pair",             "data/textures/pair.png");
+    resources.addTexture("wall-box",         "data/textures/box.png");
+    resources.addTexture("wall-platform-1",  "data/textures/platform-1.png");
+    resources.addTexture("wall-platform-2",  "data/textures/platform-2.png");
+    resources.addTexture("wall-gradient",    "data/textures/gradient.png");
+    resources.addTexture("wall-godrays",     "data/textures/godrays.png");
+    resources.addTexture("spiderweb",        "data/textures/spiderweb.png");
+    resources.addTexture("blob",             "data/textures/blob.png");
+    resources.addTexture("cave-1",           "data/textures/cave-1.jpg");
+    resources.addTexture("perlin",           "data/textures/perlin.png");
+    resources.addTexture("egg",              "data/textures/egg.png");
+    resources.addTexture("egg-top",          "data/textures/egg-top.png");
+    resources.addTexture("egg-bottom",       "data/textures/egg-bottom.png");
+    resources.addTexture("egg-crack",        "data/textures/egg-crack.png");
+    resources.addTexture("body",             "data/textures/body.png");
+    // resources.addTexture("fang",             "data/textures/fang.png");
+    resources.addTexture("upper-leg",        "data/textures/upper-leg.png");
+    resources.addTexture("lower-leg",        "data/textures/lower-leg.png");
+    resources.addTexture("help-walk",        "data/textures/help/walk.png");
+    resources.addTexture("help-jump",        "data/textures/help/jump.png");
+    resources.addTexture("help-walls",       "data/textures/help/walls.png");
+
+    resources.addSound("crack",  "data/sounds/crack.ogg");
+    resources.addSound("rumble", "data/sounds/rumble.ogg");
+    resources.addSound("walk",   "data/sounds/walk.ogg");
+    resources.addSound("bell",   "data/sounds/bell.wav");
+
+    resources.addMusic("horror-ambience", "data/music/horror-ambience.wav");
+
+    resources.addFont("title",   "data/fonts/Supernova.ttf");
+    resources.addFont("default", "data/fonts/what-fish-died.ttf");
+    resources.addFont("mono",    "data/fonts/UbuntuMono-R.ttf");
+
+    resources.addShader("pixel",             "data/shaders/pixel.fragment.glsl", sf::Shader::Fragment);
+    resources.addShader("backdrop",          "data/shaders/backdrop.fragment.glsl", sf::Shader::Fragment);
+    resources.addShader("parallax",          "data/shaders/parallax.fragment.glsl", sf::Shader::Fragment);
+    resources.addShader("fog",               "data/shaders/fog.fragment.glsl", sf::Shader::Fragment);
+    resources.addShader("blur-horizontal",   "data/shaders/blur-horizontal.fragment.glsl", sf::Shader::Fragment);
+    resources.addShader("blur-vertical",     "data/shaders/blur-vertical.fragment.glsl", sf::Shader::Fragment);
+}
@@ -2,6 +2,9 @@
 #define ROOT_HPP
 
 #include "ResourceManager.hpp"
+#include "ShapeCache.hpp"
+#include "RenderTargetPool.hpp"
+#include "TextCache.hpp"
 #include "GameState.hpp"
 #include "EditorState.hpp"
 #include "MenuState.hpp"
@@ -13,6 +16,9 @@ class Root {
 public:
     // objects
     static ResourceManager resources;
+    static ShapeCache shapes;
+    static RenderTargetPool renderTargets;
+    static TextCache text;
     static GameState game_state;
     static EditorState editor_state;
     static MenuState menu_state;
@@ -21,6 +27,8 @@ public:
     static sf::RenderWindow* window;
 
     static bool debug;
+
+    static void loadResources();
 };
 
 #endif
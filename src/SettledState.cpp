@@ -0,0 +1,131 @@
+#include "SettledState.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#include "Entity.hpp"
+#include "CollisionBake.hpp"
+#include "CollisionShape.hpp"
+#include "PhysicsBackend.hpp"
+#include "PhysicsWorld.hpp"
+
+static const char SETTLED_MAGIC[8] = {'A', 'R', 'A', 'C', 'R', 'E', 'S', 'T'};
+static const unsigned int SETTLED_VERSION = 2;
+
+struct SettledHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int count;
+    unsigned long long sourceHash;
+    float spawnX, spawnY;
+    unsigned int seed;
+    unsigned int cooking;
+    unsigned int backend;
+    unsigned int reserved;
+};
+
+static bool isDynamic(const Entity* entity) {
+    return entity->physicsBody() && entity->physicsBody()->isDynamic();
+}
+
+SettledState::SettledState(const std::string& levelFilename, const glm::vec2& spawn, unsigned int seed)
+    : m_levelFilename(levelFilename),
+      m_filename(levelFilename + ".settled"),
+      m_spawn(spawn),
+      m_seed(seed),
+      m_sourceHash(0) {}
+
+bool SettledState::load() {
+    m_sourceHash = CollisionBake::hashFile(m_levelFilename) ^ SETTLED_VERSION;
+
+    std::ifstream stream(m_filename, std::ios::binary);
+    if(!stream) return false;
+
+    SettledHeader header;
+    if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+
+    if(std::memcmp(header.magic, SETTLED_MAGIC, sizeof(SETTLED_MAGIC)) != 0 || header.version != SETTLED_VERSION
+            || header.sourceHash != m_sourceHash || header.spawnX != m_spawn.x || header.spawnY != m_spawn.y
+            || header.seed != m_seed || header.cooking != (unsigned int)CollisionShape::cooking
+            || header.backend != (unsigned int)PhysicsBackend::type) {
+        return false;
+    }
+
+    m_bodies.resize(header.count);
+    if(!stream.read(reinterpret_cast<char*>(m_bodies.data()), header.count * sizeof(Body))) {
+        std::cerr << "Warning: " << m_filename << " is truncated, settling the level again." << std::endl;
+        m_bodies.clear();
+        return false;
+    }
+    return true;
+}
+
+void SettledState::save() {
+    if(m_sourceHash == 0) {
+        m_sourceHash = CollisionBake::hashFile(m_levelFilename) ^ SETTLED_VERSION;
+    }
+
+    std::ofstream stream(m_filename, std::ios::binary);
+    if(!stream) {
+        std::cerr << "Warning: could not write " << m_filename << "." << std::endl;
+        return;
+    }
+
+    SettledHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SETTLED_MAGIC, sizeof(SETTLED_MAGIC));
+    header.version = SETTLED_VERSION;
+    header.count = m_bodies.size();
+    header.sourceHash = m_sourceHash;
+    header.spawnX = m_spawn.x;
+    header.spawnY = m_spawn.y;
+    header.seed = m_seed;
+    header.cooking = CollisionShape::cooking;
+    header.backend = PhysicsBackend::type;
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(m_bodies.data()), m_bodies.size() * sizeof(Body));
+}
+
+bool SettledState::restore(const std::vector<std::shared_ptr<Entity>>& entities) {
+    unsigned int count = 0;
+    for(auto entity : entities) {
+        if(isDynamic(entity.get())) count++;
+    }
+    if(count != m_bodies.size()) return false;
+
+    unsigned int i = 0;
+    for(auto entity : entities) {
+        if(!isDynamic(entity.get())) continue;
+
+        const Body& body = m_bodies[i++];
+        entity->setPhysicsPosition(glm::vec2(body.x, body.y));
+        entity->setPhysicsRotation(body.rotation);
+
+        PhysicsBody::Motion motion;
+        motion.transform = entity->physicsBody()->transform();
+        motion.linearVelocity = btVector3(0, 0, 0);
+        motion.angularVelocity = 0;
+        motion.awake = false;
+        motion.restTime = 0;
+        entity->physicsBody()->setMotion(motion);
+    }
+    return true;
+}
+
+void SettledState::record(const std::vector<std::shared_ptr<Entity>>& entities) {
+    m_bodies.clear();
+    for(auto entity : entities) {
+        if(!isDynamic(entity.get())) continue;
+
+        // bodies only turn around Z
+        btTransform transform = entity->physicsBody()->transform();
+        btQuaternion rotation = transform.getRotation();
+
+        Body body;
+        body.x = transform.getOrigin().x();
+        body.y = transform.getOrigin().y();
+        body.rotation = 2 * btAtan2(rotation.z(), rotation.w());
+        m_bodies.push_back(body);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SETTLEDSTATE_HPP
+#define SETTLEDSTATE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Entity;
+
+// Remembers where the dynamic bodies of a level came to rest after the
+// warm-up simulation, in a file next to the level (<level>.settled). The
+// result only depends on the level, the spawn position, the random seed
+// used for spawning and the physics setup, which are all recorded. Any
+// change to them makes load() fail and the warm-up runs again.
+class SettledState {
+public:
+    SettledState(const std::string& levelFilename, const glm::vec2& spawn, unsigned int seed);
+
+    bool load();
+    void save();
+
+    // Restores the recorded transforms to the dynamic bodies of entities,
+    // which go to sleep. Fails if the bodies don't match the recording.
+    bool restore(const std::vector<std::shared_ptr<Entity>>& entities);
+    void record(const std::vector<std::shared_ptr<Entity>>& entities);
+
+private:
+    struct Body {
+        float x, y, rotation;
+    };
+
+    std::string m_levelFilename;
+    std::string m_filename;
+    glm::vec2 m_spawn;
+    unsigned int m_seed;
+    unsigned long long m_sourceHash;
+
+    std::vector<Body> m_bodies;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "ShapeCache.hpp"
+
+#include <tuple>
+
+ShapeCache::Key::Key(const std::string& kind_, btScalar x_, btScalar y_, btScalar z_)
+    : kind(kind_), x(x_), y(y_), z(z_) {}
+
+bool ShapeCache::Key::operator<(const ShapeCache::Key& other) const {
+    return std::tie(kind, x, y, z) < std::tie(other.kind, other.x, other.y, other.z);
+}
+
+std::shared_ptr<btCollisionShape> ShapeCache::get(const ShapeCache::Key& key, std::function<btCollisionShape*()> create) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_shapes.find(key);
+    if(it != m_shapes.end()) {
+        auto shape = it->second.lock();
+        if(shape) return shape;
+    }
+
+    // a miss is when new shapes come in, so drop the ones nobody uses anymore
+    for(auto i = m_shapes.begin(); i != m_shapes.end(); ) {
+        if(i->second.expired()) {
+            i = m_shapes.erase(i);
+        } else {
+            ++i;
+        }
+    }
+
+    auto shape = std::shared_ptr<btCollisionShape>(create());
+    m_shapes[key] = shape;
+    return shape;
+}
+
+std::shared_ptr<btCollisionShape> ShapeCache::sphere(btScalar radius) {
+    return get(Key("sphere", radius), [radius]() -> btCollisionShape* {
+        return new btSphereShape(radius);
+    });
+}
+
+std::shared_ptr<btCollisionShape> ShapeCache::box(const btVector3& halfExtents) {
+    return get(Key("box", halfExtents.x(), halfExtents.y(), halfExtents.z()), [halfExtents]() -> btCollisionShape* {
+        return new btBoxShape(halfExtents);
+    });
+}
+
+std::shared_ptr<btCollisionShape> ShapeCache::uniformScaled(std::shared_ptr<btCollisionShape> shape, btScalar scale) {
+    if(scale == 1 || !shape->isConvex()) return shape;
+
+    auto scaled = new btUniformScalingShape(static_cast<btConvexShape*>(shape.get()), scale);
+    return std::shared_ptr<btCollisionShape>(scaled, [shape](btCollisionShape* s) {
+        delete s;
+    });
+}
+
+size_t ShapeCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_shapes.size();
+}
@@ -0,0 +1,41 @@
+#ifndef SHAPECACHE_HPP
+#define SHAPECACHE_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <functional>
+#include <btBulletDynamicsCommon.h>
+
+// Hands out shared collision shapes, so that entities with equal shapes
+// don't each build and keep their own. Shapes are freed once the last
+// entity using them is gone, their entries on the next miss. Shared
+// shapes must never be scaled, use uniformScaled() for per-instance
+// scale. Safe to use from the threads cooking a level.
+class ShapeCache {
+public:
+    struct Key {
+        std::string kind;
+        btScalar x, y, z;
+
+        Key(const std::string& kind, btScalar x = 0, btScalar y = 0, btScalar z = 0);
+        bool operator<(const Key& other) const;
+    };
+
+    std::shared_ptr<btCollisionShape> get(const Key& key, std::function<btCollisionShape*()> create);
+
+    std::shared_ptr<btCollisionShape> sphere(btScalar radius);
+    std::shared_ptr<btCollisionShape> box(const btVector3& halfExtents);
+
+    // Wraps a shared convex shape for one instance, keeping the shared shape alive
+    static std::shared_ptr<btCollisionShape> uniformScaled(std::shared_ptr<btCollisionShape> shape, btScalar scale);
+
+    size_t size() const;
+
+private:
+    std::map<Key, std::weak_ptr<btCollisionShape>> m_shapes;
+    mutable std::mutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "SleepManager.hpp"
+
+#include <algorithm>
+
+#include "Entity.hpp"
+#include "PhysicsWorld.hpp"
+
+void SleepManager::setWorld(PhysicsWorld* world) {
+    m_world = world;
+}
+
+void SleepManager::addWakeVolume(Entity* entity, float radius) {
+    for(auto& volume : m_volumes) {
+        if(volume.entity == entity) {
+            volume.radius = radius;
+            return;
+        }
+    }
+    m_volumes.push_back(WakeVolume{entity, radius});
+}
+
+void SleepManager::removeWakeVolume(Entity* entity) {
+    m_volumes.erase(std::remove_if(m_volumes.begin(), m_volumes.end(), [entity](const WakeVolume& v) -> bool {
+        return v.entity == entity;
+    }), m_volumes.end());
+}
+
+void SleepManager::clear() {
+    m_volumes.clear();
+}
+
+void SleepManager::wake(Entity* entity) {
+    PhysicsBody* body = entity->physicsBody();
+    if(body && body->isDynamic()) {
+        body->wake();
+    }
+}
+
+void SleepManager::wakeRegion(const glm::vec2& center, float radius) {
+    if(!m_world) return;
+
+    btVector3 min(center.x - radius, center.y - radius, -radius);
+    btVector3 max(center.x + radius, center.y + radius, radius);
+    m_world->wakeRegion(min, max);
+}
+
+void SleepManager::update() {
+    for(auto& volume : m_volumes) {
+        wake(volume.entity);
+        wakeRegion(volume.entity->position(), volume.radius);
+    }
+}
+
+int SleepManager::countAwake() const {
+    if(!m_world) return 0;
+    return m_world->countAwake();
+}
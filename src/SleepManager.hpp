@@ -0,0 +1,42 @@
+#ifndef SLEEPMANAGER_HPP
+#define SLEEPMANAGER_HPP
+
+#include <vector>
+#include <btBulletDynamicsCommon.h>
+#include <glm/glm.hpp>
+
+class Entity;
+class PhysicsWorld;
+
+// Bodies are allowed to fall asleep when they come to rest. They are woken
+// again by contacts with awake bodies (the simulation islands), by the
+// wake volumes around entities like the player, and by explicit wake calls
+// from gameplay code.
+class SleepManager {
+public:
+    void setWorld(PhysicsWorld* world);
+
+    // keeps everything within radius around the entity awake, entity included
+    void addWakeVolume(Entity* entity, float radius);
+    void removeWakeVolume(Entity* entity);
+    void clear();
+
+    void wake(Entity* entity);
+    void wakeRegion(const glm::vec2& center, float radius);
+
+    // to be called before each simulation step
+    void update();
+
+    int countAwake() const;
+
+private:
+    struct WakeVolume {
+        Entity* entity;
+        float radius;
+    };
+
+    PhysicsWorld* m_world = nullptr;
+    std::vector<WakeVolume> m_volumes;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Entity.hpp"
+
+Snapshot::Snapshot()
+    : m_mode(SAVE),
+      m_cursor(0) {}
+
+void Snapshot::begin(Snapshot::Mode mode) {
+    m_mode = mode;
+    m_cursor = 0;
+    if(m_mode == SAVE) {
+        m_buffer.clear();
+    }
+}
+
+Snapshot::Mode Snapshot::mode() const {
+    return m_mode;
+}
+
+bool Snapshot::isEmpty() const {
+    return m_buffer.empty();
+}
+
+size_t Snapshot::size() const {
+    return m_buffer.size();
+}
+
+void Snapshot::io(btVector3& vector) {
+    btScalar x = vector.x(), y = vector.y(), z = vector.z();
+    io(x);
+    io(y);
+    io(z);
+    if(m_mode == RESTORE) {
+        vector.setValue(x, y, z);
+    }
+}
+
+void Snapshot::io(btTransform& transform) {
+    btVector3 origin = transform.getOrigin();
+    btQuaternion rotation = transform.getRotation();
+    btScalar x = rotation.x(), y = rotation.y(), z = rotation.z(), w = rotation.w();
+    io(origin);
+    io(x);
+    io(y);
+    io(z);
+    io(w);
+    if(m_mode == RESTORE) {
+        transform.setOrigin(origin);
+        transform.setRotation(btQuaternion(x, y, z, w));
+    }
+}
+
+void Snapshot::write(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+void Snapshot::read(void* data, size_t size) {
+    if(m_cursor + size > m_buffer.size()) {
+        std::cerr << "Warning: snapshot buffer underrun, state is incomplete." << std::endl;
+        return;
+    }
+    std::memcpy(data, m_buffer.data() + m_cursor, size);
+    m_cursor += size;
+}
+
+int Snapshot::indexOf(const Entity* entity) const {
+    if(!entity) return -1;
+
+    for(unsigned int i = 0; i < m_entities.size(); ++i) {
+        if(m_entities[i].get() == entity) return i;
+    }
+    return -1;
+}
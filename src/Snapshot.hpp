@@ -0,0 +1,75 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <btBulletDynamicsCommon.h>
+
+#include <CppTweener.h>
+
+class Entity;
+class State;
+
+// A compact in-memory copy of the simulation state of a State. The same
+// io() calls are used for saving and restoring, similar to cereal archives,
+// so entities only have to describe their state once in onSnapshot().
+// Snapshot objects are meant to be reused, the buffer keeps its capacity.
+class Snapshot {
+public:
+    enum Mode {
+        SAVE,
+        RESTORE
+    };
+
+    Snapshot();
+
+    void begin(Mode mode);
+    Mode mode() const;
+
+    bool isEmpty() const;
+    size_t size() const;
+
+    template<typename T>
+    void io(T& value) {
+        if(m_mode == SAVE) {
+            write(&value, sizeof(T));
+        } else {
+            read(&value, sizeof(T));
+        }
+    }
+
+    void io(btVector3& vector);
+    void io(btTransform& transform);
+
+    // Entity references are stored as indices into the captured entity list.
+    template<typename T>
+    void io(std::shared_ptr<T>& entity) {
+        int index = -1;
+        if(m_mode == SAVE) {
+            index = indexOf(entity.get());
+            io(index);
+        } else {
+            io(index);
+            entity = index < 0 ? nullptr : std::static_pointer_cast<T>(m_entities[index]);
+        }
+    }
+
+private:
+    void write(const void* data, size_t size);
+    void read(void* data, size_t size);
+    int indexOf(const Entity* entity) const;
+
+    Mode m_mode;
+    std::vector<char> m_buffer;
+    size_t m_cursor;
+
+    // captured alongside the buffer by State
+    std::vector<std::shared_ptr<Entity>> m_entities;
+    std::vector<const Entity*> m_sortedEntities;
+    tween::Tweener m_tweener;
+
+    friend class State;
+};
+
+#endif
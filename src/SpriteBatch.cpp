@@ -0,0 +1,223 @@
+#include "SpriteBatch.hpp"
+
+#include <algorithm>
+
+static bool sameStates(const sf::RenderStates& a, const sf::RenderStates& b) {
+    return a.texture == b.texture && a.shader == b.shader && a.blendMode == b.blendMode;
+}
+
+// unlike sf::FloatRect::intersects, touching edges and flat rects count
+static bool overlaps(const sf::FloatRect& a, const sf::FloatRect& b) {
+    return a.left <= b.left + b.width && b.left <= a.left + a.width
+        && a.top <= b.top + b.height && b.top <= a.top + a.height;
+}
+
+SpriteBatch::SpriteBatch()
+    : m_target(nullptr),
+      m_recording(nullptr),
+      m_vertices(sf::Triangles),
+      m_layered(false),
+      m_layer(0),
+      m_bucketCount(0),
+      m_drawCalls(0),
+      m_triangles(0) {}
+
+void SpriteBatch::begin(sf::RenderTarget& target) {
+    m_target = &target;
+    m_recording = nullptr;
+    m_vertices.clear();
+    m_bucketCount = 0;
+    m_layered = false;
+    m_drawCalls = 0;
+    m_triangles = 0;
+}
+
+void SpriteBatch::end() {
+    flush();
+    m_target = nullptr;
+    m_recording = nullptr;
+    m_layered = false;
+}
+
+void SpriteBatch::setLayer(int layer) {
+    if(!m_layered) {
+        // what was drawn in order so far goes first
+        flush();
+        m_layered = true;
+    }
+    m_layer = layer;
+}
+
+void SpriteBatch::draw(const sf::Sprite& sprite, const sf::RenderStates& states) {
+    if(!sprite.getTexture()) return;
+
+    sf::FloatRect bounds = sprite.getLocalBounds();
+    sf::IntRect rect = sprite.getTextureRect();
+    float left = rect.left, top = rect.top;
+    float right = left + rect.width, bottom = top + rect.height;
+    sf::Color color = sprite.getColor();
+
+    sf::Vertex quad[6] = {
+        sf::Vertex(sf::Vector2f(0, 0),                       color, sf::Vector2f(left, top)),
+        sf::Vertex(sf::Vector2f(bounds.width, 0),            color, sf::Vector2f(right, top)),
+        sf::Vertex(sf::Vector2f(bounds.width, bounds.height), color, sf::Vector2f(right, bottom)),
+        sf::Vertex(sf::Vector2f(0, 0),                       color, sf::Vector2f(left, top)),
+        sf::Vertex(sf::Vector2f(bounds.width, bounds.height), color, sf::Vector2f(right, bottom)),
+        sf::Vertex(sf::Vector2f(0, bounds.height),           color, sf::Vector2f(left, bottom))
+    };
+
+    sf::RenderStates spriteStates(states);
+    spriteStates.transform *= sprite.getTransform();
+    spriteStates.texture = sprite.getTexture();
+    draw(quad, 6, spriteStates);
+}
+
+void SpriteBatch::draw(const sf::Vertex* vertices, size_t count, const sf::RenderStates& states) {
+    if(!m_target && !m_recording) return;
+
+    if(!m_layered) {
+        if(m_vertices.getVertexCount() > 0 && !sameStates(states, m_states)) {
+            flush();
+        }
+        m_states.texture = states.texture;
+        m_states.shader = states.shader;
+        m_states.blendMode = states.blendMode;
+
+        for(size_t i = 0; i < count; ++i) {
+            sf::Vertex vertex = vertices[i];
+            vertex.position = states.transform.transformPoint(vertex.position);
+            m_vertices.append(vertex);
+        }
+        m_triangles += count / 3;
+        return;
+    }
+
+    if(count == 0) return;
+
+    m_transformed.assign(vertices, vertices + count);
+    sf::Vector2f lower = states.transform.transformPoint(vertices[0].position), upper = lower;
+    for(auto& vertex : m_transformed) {
+        vertex.position = states.transform.transformPoint(vertex.position);
+        lower.x = std::min(lower.x, vertex.position.x);
+        lower.y = std::min(lower.y, vertex.position.y);
+        upper.x = std::max(upper.x, vertex.position.x);
+        upper.y = std::max(upper.y, vertex.position.y);
+    }
+    sf::FloatRect bounds(lower, upper - lower);
+
+    // go back to the last bucket with equal states, unless something drawn
+    // after it on the same layer would end up below this
+    Bucket* bucket = nullptr;
+    for(unsigned int i = m_bucketCount; i > 0; --i) {
+        Bucket& b = m_buckets[i - 1];
+        if(b.layer != m_layer) continue;
+        if(sameStates(b.batch.states, states)) {
+            bucket = &b;
+            break;
+        }
+        if(overlaps(b.bounds, bounds)) break;
+    }
+
+    if(bucket) {
+        sf::FloatRect& b = bucket->bounds;
+        float right = std::max(b.left + b.width, upper.x), bottom = std::max(b.top + b.height, upper.y);
+        b.left = std::min(b.left, lower.x);
+        b.top = std::min(b.top, lower.y);
+        b.width = right - b.left;
+        b.height = bottom - b.top;
+    } else {
+        if(m_bucketCount == m_buckets.size()) {
+            m_buckets.push_back(Bucket());
+            m_buckets.back().batch.vertices.setPrimitiveType(sf::Triangles);
+        }
+        bucket = &m_buckets[m_bucketCount++];
+        bucket->layer = m_layer;
+        bucket->bounds = bounds;
+        bucket->batch.vertices.clear();
+        bucket->batch.states = sf::RenderStates::Default;
+        bucket->batch.states.texture = states.texture;
+        bucket->batch.states.shader = states.shader;
+        bucket->batch.states.blendMode = states.blendMode;
+    }
+
+    for(auto& vertex : m_transformed) {
+        bucket->batch.vertices.append(vertex);
+    }
+    m_triangles += count / 3;
+}
+
+void SpriteBatch::drawRect(const sf::FloatRect& rect, const sf::Color& color, const sf::RenderStates& states) {
+    float right = rect.left + rect.width, bottom = rect.top + rect.height;
+    sf::Vertex quad[6] = {
+        sf::Vertex(sf::Vector2f(rect.left, rect.top), color),
+        sf::Vertex(sf::Vector2f(right, rect.top),     color),
+        sf::Vertex(sf::Vector2f(right, bottom),       color),
+        sf::Vertex(sf::Vector2f(rect.left, rect.top), color),
+        sf::Vertex(sf::Vector2f(right, bottom),       color),
+        sf::Vertex(sf::Vector2f(rect.left, bottom),   color)
+    };
+
+    sf::RenderStates rectStates(states);
+    rectStates.texture = nullptr;
+    draw(quad, 6, rectStates);
+}
+
+void SpriteBatch::flush() {
+    if(m_vertices.getVertexCount() > 0) {
+        output(m_vertices, m_states);
+        m_vertices.clear();
+    }
+
+    if(m_bucketCount == 0) return;
+
+    // buckets of a layer stay in the order they were started
+    m_bucketOrder.resize(m_bucketCount);
+    for(unsigned int i = 0; i < m_bucketCount; ++i) {
+        m_bucketOrder[i] = i;
+    }
+    std::stable_sort(m_bucketOrder.begin(), m_bucketOrder.end(), [this](unsigned int a, unsigned int b) -> bool {
+        return m_buckets[a].layer < m_buckets[b].layer;
+    });
+    for(auto i : m_bucketOrder) {
+        output(m_buckets[i].batch.vertices, m_buckets[i].batch.states);
+    }
+    m_bucketCount = 0;
+}
+
+void SpriteBatch::output(const sf::VertexArray& vertices, const sf::RenderStates& states) {
+    if(m_recording) {
+        Batch batch;
+        batch.vertices = vertices;
+        batch.states = states;
+        m_recording->push_back(batch);
+    } else if(m_target) {
+        m_target->draw(vertices, states);
+        m_drawCalls++;
+    }
+}
+
+void SpriteBatch::record(std::vector<Batch>& batches) {
+    if(m_recording == &batches) return;
+
+    flush();
+    m_recording = &batches;
+}
+
+void SpriteBatch::draw(const std::vector<Batch>& batches) {
+    if(!m_target || m_recording) return;
+
+    flush();
+    for(auto& batch : batches) {
+        m_target->draw(batch.vertices, batch.states);
+        m_drawCalls++;
+        m_triangles += batch.vertices.getVertexCount() / 3;
+    }
+}
+
+int SpriteBatch::drawCalls() const {
+    return m_drawCalls;
+}
+
+int SpriteBatch::triangles() const {
+    return m_triangles;
+}
@@ -0,0 +1,82 @@
+#ifndef SPRITEBATCH_HPP
+#define SPRITEBATCH_HPP
+
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+// Collects sprites and triangles into one vertex array and draws them with
+// a single call for as long as texture, blend mode and shader stay the
+// same. Vertices are transformed on the CPU, so differently placed sprites
+// still end up in one batch. Draw order is kept: a change of render states
+// flushes what was collected before.
+//
+// Once setLayer() was called, draws are bucketed by layer and render
+// states instead, and flush() draws the buckets layer by layer. A draw
+// joins an earlier bucket of its layer with equal states only if nothing
+// drawn into a later bucket overlaps it, so painter's order still holds
+// and only sprites that don't cover each other are reordered.
+//
+// Entities draw through State::spriteBatch() in onDraw(). Anything drawn
+// straight to the target has to flush() the batch first.
+//
+// Instead of drawing, the batch can also record() into a list of finished
+// batches, which are drawn again later as they are, see StaticScenery.
+class SpriteBatch {
+public:
+    struct Batch {
+        sf::VertexArray vertices;
+        sf::RenderStates states;
+    };
+
+    SpriteBatch();
+
+    void begin(sf::RenderTarget& target);
+    void end();
+
+    // layer of the following draws, usually the z-level, until end()
+    void setLayer(int layer);
+
+    void draw(const sf::Sprite& sprite, const sf::RenderStates& states = sf::RenderStates::Default);
+    // vertices as sf::Triangles
+    void draw(const sf::Vertex* vertices, size_t count, const sf::RenderStates& states = sf::RenderStates::Default);
+    // untextured
+    void drawRect(const sf::FloatRect& rect, const sf::Color& color, const sf::RenderStates& states = sf::RenderStates::Default);
+    void flush();
+
+    // collects into batches until end() or the next begin()
+    void record(std::vector<Batch>& batches);
+    // draws recorded batches, one call each
+    void draw(const std::vector<Batch>& batches);
+
+    // since the last begin()
+    int drawCalls() const;
+    int triangles() const;
+
+private:
+    struct Bucket {
+        int layer;
+        Batch batch;
+        // of all vertices so far
+        sf::FloatRect bounds;
+    };
+
+    void output(const sf::VertexArray& vertices, const sf::RenderStates& states);
+
+    sf::RenderTarget* m_target;
+    std::vector<Batch>* m_recording;
+    sf::VertexArray m_vertices;
+    sf::RenderStates m_states;
+
+    bool m_layered;
+    int m_layer;
+    // the first m_bucketCount are in use, the rest keep their memory
+    std::vector<Bucket> m_buckets;
+    unsigned int m_bucketCount;
+    std::vector<unsigned int> m_bucketOrder;
+    std::vector<sf::Vertex> m_transformed;
+
+    int m_drawCalls;
+    int m_triangles;
+};
+
+#endif
@@ -1,18 +1,69 @@
 #include "State.hpp"
 
 #include "Root.hpp"
-#include "EntityMotionState.hpp"
+#include "CollisionShape.hpp"
+#include "PhysicsBackend.hpp"
+#include "BulletPhysicsWorld.hpp"
+#include "Physics2dWorld.hpp"
+#include "LevelFile.hpp"
 
 #include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <atomic>
+#include <thread>
 #include <cereal/archives/json.hpp>
 #include <cereal/archives/binary.hpp>
 #include <cereal/archives/portable_binary.hpp>
 #include <cereal/types/vector.hpp>
 #include <cereal/types/memory.hpp>
 
-void bulletTickCallback(btDynamicsWorld *world, btScalar timeStep) {
-    State* s = static_cast<State*>(world->getWorldUserInfo());
-    s->worldTickCallback(timeStep);
+int State::physicsThreads = 1;
+int State::loadThreads = 0;
+bool State::adaptiveStepping = true;
+bool State::reuseWorld = true;
+
+// adaptive stepping: bodies should not move more than this part of their
+// size in one substep, substeps stay within these limits. It only ever
+// refines fixed stepping, a quiet scene still runs at 60 Hz.
+static const float MAX_MOVE_PER_SUBSTEP = 0.25f;
+static const float MIN_SUBSTEP = 1.f / 240.f;
+static const float MAX_SUBSTEP = 1.f / 60.f;
+static const int MAX_SUBSTEPS = 10;
+
+// below this many entities per thread, cooking a level stays serial
+static const int MIN_ENTITIES_PER_COOK_THREAD = 16;
+State::BroadphaseType State::broadphase = State::BROADPHASE_AUTO;
+
+static bool contactOrder(const EntityContact& a, const EntityContact& b) {
+    std::less<Entity*> less;
+    return a.a != b.a ? less(a.a, b.a) : less(a.b, b.b);
+}
+
+static bool contactSamePair(const EntityContact& a, const EntityContact& b) {
+    return a.a == b.a && a.b == b.b;
+}
+
+// choices written by arachnonoia-bench broadphase --write, one "<level> <name>" per line
+static State::BroadphaseType levelBroadphase(const std::string& filename) {
+    static std::map<std::string, State::BroadphaseType> levels;
+    static bool loaded = false;
+    if(!loaded) {
+        std::ifstream stream("levels/broadphase.txt");
+        std::string level, name;
+        while(stream >> level >> name) {
+            levels[level] = State::broadphaseByName(name);
+        }
+        loaded = true;
+    }
+
+    std::string level = filename.substr(filename.find_last_of('/') + 1);
+    level = level.substr(0, level.find('.'));
+    auto it = levels.find(level);
+    return it == levels.end() || it->second == State::BROADPHASE_AUTO ? State::BROADPHASE_DBVT : it->second;
 }
 
 
@@ -21,33 +72,53 @@ State::~State() {
 }
 
 void State::init() {
+    m_broadphaseType = broadphase == BROADPHASE_AUTO ? BROADPHASE_DBVT : broadphase;
     initializeWorld();
     onInit();
 }
 
 void State::initializeWorld() {
-    m_broadphase = new btDbvtBroadphase();
-    m_collisionConfiguration = new btDefaultCollisionConfiguration();
-    m_collisionDispatcher = new btCollisionDispatcher(m_collisionConfiguration);
-    m_solver = new btSequentialImpulseConstraintSolver;
-    m_dynamicsWorld = new btDiscreteDynamicsWorld(m_collisionDispatcher, m_broadphase, m_solver, m_collisionConfiguration);
-    m_debugDrawer = new DebugDraw();
+    m_worldBroadphaseType = m_broadphaseType;
+    m_worldThreads = physicsThreads;
+    m_worldBackend = PhysicsBackend::type;
 
+    if(PhysicsBackend::type == PhysicsBackend::NATIVE_2D) {
+        m_physics = new Physics2dWorld();
+    } else {
+        // bodies outside of the axis sweep bounds still work, but are slow
+        btVector3 padding(50, 50, 0);
+        m_worldLower = btVector3(m_levelLower.x, m_levelLower.y, -10) - padding;
+        m_worldUpper = btVector3(m_levelUpper.x, m_levelUpper.y, 10) + padding;
+        m_physics = new BulletPhysicsWorld(m_broadphaseType, m_worldLower, m_worldUpper, physicsThreads);
+    }
+
+    m_debugDrawer = new DebugDraw();
     m_debugDrawer->setDebugMode(DebugDraw::DBG_DrawWireframe | DebugDraw::DBG_DrawContactPoints | DebugDraw::DBG_DrawConstraints | DebugDraw::DBG_DrawNormals);
-    m_dynamicsWorld->setDebugDrawer(m_debugDrawer);
 
-    m_dynamicsWorld->setWorldUserInfo(this);
-    m_dynamicsWorld->setInternalTickCallback(bulletTickCallback, static_cast<void *>(this));
-    m_dynamicsWorld->setGravity(btVector3(0, 9.81, 0));
+    m_sleepManager.setWorld(m_physics);
+    m_physics->setGravity(btVector3(0, 9.81, 0));
 }
 
 void State::deinitializeWorld() {
     delete m_debugDrawer;
-    delete m_dynamicsWorld;
-    delete m_solver;
-    delete m_collisionDispatcher;
-    delete m_collisionConfiguration;
-    delete m_broadphase;
+    delete m_physics;
+    m_debugDrawer = nullptr;
+    m_physics = nullptr;
+}
+
+void State::resetWorld() {
+    m_physics->reset();
+}
+
+bool State::canResetWorld() const {
+    if(!reuseWorld || !m_physics) return false;
+    if(m_broadphaseType != m_worldBroadphaseType || physicsThreads != m_worldThreads || PhysicsBackend::type != m_worldBackend) return false;
+
+    if(m_broadphaseType == BROADPHASE_AXIS_SWEEP && PhysicsBackend::type == PhysicsBackend::BULLET) {
+        return m_levelLower.x >= m_worldLower.x() && m_levelLower.y >= m_worldLower.y()
+            && m_levelUpper.x <= m_worldUpper.x() && m_levelUpper.y <= m_worldUpper.y();
+    }
+    return true;
 }
 
 void State::update(float dt) {
@@ -63,7 +134,25 @@ void State::update(float dt) {
         m_fps = (int)(1 / dt);
     }
 
-    m_dynamicsWorld->stepSimulation(dt, 10);
+    m_sleepManager.update();
+
+    m_profiler.beginFrame();
+    int maxSubsteps = MAX_SUBSTEPS;
+    float substep = 1.f / 60.f;
+    if(adaptiveStepping) {
+        substep = chooseSubsteps(dt, maxSubsteps);
+    } else {
+        m_profiler.recordStepping(substep, 0, 0);
+    }
+    sf::Clock stepClock;
+    int substeps = m_physics->step(dt, maxSubsteps, substep);
+    m_profiler.endFrame(m_physics, m_time, dt, substeps, maxSubsteps, stepClock.getElapsedTime().asMicroseconds() / 1000.f);
+
+    // contacts only change when the world actually stepped
+    if(substeps > 0) {
+        updateContacts();
+        dispatchContactEvents();
+    }
 
     m_total_elapsed += dt * 1000;
     m_tweener.step(m_total_elapsed);
@@ -82,39 +171,83 @@ void State::update(float dt) {
     }
 }
 
-void State::worldTickCallback(btScalar timestep) {
-    int numManifolds = m_dynamicsWorld->getDispatcher()->getNumManifolds();
-    for(int i=0;i<numManifolds;i++) {
-        btPersistentManifold* contactManifold =  m_dynamicsWorld->getDispatcher()->getManifoldByIndexInternal(i);
-        const btCollisionObject* obA = static_cast<const btCollisionObject*>(contactManifold->getBody0());
-        const btCollisionObject* obB = static_cast<const btCollisionObject*>(contactManifold->getBody1());
-
-        int numContacts = contactManifold->getNumContacts();
-        for (int j=0;j<numContacts;j++) {
-            btManifoldPoint& pt = contactManifold->getContactPoint(j);
-            if(pt.getLifeTime() == 1) {
-                if (obA->getUserPointer() && obB->getUserPointer()) {
-                    Entity* a = static_cast<Entity*>(obA->getUserPointer());
-                    Entity* b = static_cast<Entity*>(obB->getUserPointer());
-
-                    EntityCollision c;
-                    c.distance = pt.getDistance();
-                    c.other = b;
-                    c.position = pt.getPositionWorldOnA();
-                    c.otherPosition = pt.getPositionWorldOnB();
-                    c.collisionObject = obA;
-                    c.otherCollisionObject = obB;
-
-                    if(!a->onCollide(b, c)) {
-                        std::swap(c.position, c.otherPosition);
-                        std::swap(c.collisionObject, c.otherCollisionObject);
-                        c.other = a;
-                        b->onCollide(a, c);
-                    }
-                }
-            }
+void State::updateContacts() {
+    m_contacts.clear();
+
+    m_physics->getContacts(m_physicsContacts);
+    for(auto& pc : m_physicsContacts) {
+        Entity* a = pc.a->entity();
+        Entity* b = pc.b->entity();
+
+        // resting eggs and toys nobody listens to are skipped right here
+        if(a == b) continue;
+        if(!(a->contactEvents() | b->contactEvents())) continue;
+
+        EntityContact contact;
+        contact.a = a;
+        contact.b = b;
+        contact.collision.other = b;
+        contact.collision.position = pc.positionOnA;
+        contact.collision.otherPosition = pc.positionOnB;
+        contact.collision.distance = pc.distance;
+
+        if(std::less<Entity*>()(b, a)) {
+            std::swap(contact.a, contact.b);
+            std::swap(contact.collision.position, contact.collision.otherPosition);
+            contact.collision.other = a;
+        }
+
+        m_contacts.push_back(contact);
+    }
+
+    // every contact point of an entity pair is reported, the first one is kept
+    std::stable_sort(m_contacts.begin(), m_contacts.end(), contactOrder);
+    m_contacts.erase(std::unique(m_contacts.begin(), m_contacts.end(), contactSamePair), m_contacts.end());
+
+    // diff against the last frame
+    auto current = m_contacts.begin();
+    auto previous = m_previousContacts.begin();
+    while(current != m_contacts.end() || previous != m_previousContacts.end()) {
+        EntityContact event;
+        if(previous == m_previousContacts.end() || (current != m_contacts.end() && contactOrder(*current, *previous))) {
+            event = *current++;
+            event.collision.phase = EntityCollision::BEGIN;
+        } else if(current == m_contacts.end() || contactOrder(*previous, *current)) {
+            event = *previous++;
+            event.collision.phase = EntityCollision::END;
+        } else {
+            event = *current++;
+            event.collision.phase = EntityCollision::PERSIST;
+            previous++;
         }
+        m_contactEvents.push_back(event);
     }
+
+    std::swap(m_contacts, m_previousContacts);
+}
+
+void State::dispatchContactEvents() {
+    for(unsigned int i = 0; i < m_contactEvents.size(); ++i) {
+        EntityContact& event = m_contactEvents[i];
+        EntityCollision& c = event.collision;
+
+        bool handled = false;
+        if(event.a->contactEvents() & c.phase) {
+            handled = event.a->onCollide(event.b, c);
+        }
+        if(!handled && (event.b->contactEvents() & c.phase)) {
+            std::swap(c.position, c.otherPosition);
+            c.other = event.a;
+            event.b->onCollide(event.a, c);
+        }
+    }
+    m_contactEvents.clear();
+}
+
+void State::clearContacts() {
+    m_contacts.clear();
+    m_previousContacts.clear();
+    m_contactEvents.clear();
 }
 
 void State::draw(sf::RenderTarget& target) {
@@ -122,7 +255,7 @@ void State::draw(sf::RenderTarget& target) {
 
     setView(target);
     if(m_debugDrawEnabled) {
-        m_dynamicsWorld->debugDrawWorld();
+        m_physics->debugDraw(m_debugDrawer);
     }
 }
 
@@ -143,39 +276,118 @@ void State::onDraw(sf::RenderTarget& target) {
 
 void State::onHandleEvent(sf::Event& event) {}
 
+void State::onSnapshot(Snapshot& snapshot) {}
+
+float State::chooseSubsteps(float dt, int& maxSubsteps) {
+    // fastest body relative to its size, in sizes per second
+    float maxSpeed = 0;
+    int ccdBodies = 0;
+
+    for(auto& entity : m_entities) {
+        PhysicsBody* body = entity->physicsBody();
+        if(!body || !body->isInWorld() || !body->isDynamic() || !body->isAwake()) continue;
+
+        btScalar radius = body->boundingRadius();
+        if(radius <= 0) continue;
+
+        float speed = body->linearVelocity().length() + std::abs(body->angularVelocity()) * radius;
+        maxSpeed = std::max(maxSpeed, speed / radius);
+
+        // too fast even for the smallest substep, sweep it instead
+        if(speed * MIN_SUBSTEP > radius * MAX_MOVE_PER_SUBSTEP) {
+            body->setCcd(radius * MAX_MOVE_PER_SUBSTEP, radius * 0.5f);
+            ccdBodies++;
+        } else if(body->ccdMotionThreshold() > 0) {
+            body->setCcd(0, 0);
+        }
+    }
+
+    float substep = maxSpeed > 0 ? MAX_MOVE_PER_SUBSTEP / maxSpeed : MAX_SUBSTEP;
+    substep = std::max(MIN_SUBSTEP, std::min(MAX_SUBSTEP, substep));
+
+    // enough substeps to cover the frame, but never more than the limit
+    maxSubsteps = std::min(MAX_SUBSTEPS, (int)ceil(dt / substep) + 1);
+
+    m_profiler.recordStepping(substep, maxSpeed, ccdBodies);
+    return substep;
+}
+
 void State::add(std::shared_ptr<Entity> entity) {
     m_entities.push_back(entity);
+    if(entity->isScenery()) m_scenery.invalidate();
     initializeEntity(entity);
     entity->handleAddedToState(this);
 }
 
 void State::remove(std::shared_ptr<Entity> entity) {
+    if(entity->isScenery()) m_scenery.invalidate();
+    removeFromWorld(entity);
+    m_entities.erase(std::find(m_entities.begin(), m_entities.end(), entity));
+}
+
+void State::removeFromWorld(std::shared_ptr<Entity> entity) {
+    Entity* e = entity.get();
+    m_previousContacts.erase(std::remove_if(m_previousContacts.begin(), m_previousContacts.end(), [e](const EntityContact& c) -> bool {
+        return c.a == e || c.b == e;
+    }), m_previousContacts.end());
+
+    m_sleepManager.removeWakeVolume(e);
     entity->onRemove(this);
-    if(entity->physicsBody() != nullptr) {
-        m_dynamicsWorld->removeRigidBody(entity->physicsBody());
+    if(entity->physicsBody() != nullptr && entity->physicsBody()->isInWorld()) {
+        m_physics->removeBody(entity->physicsBody());
     }
-    m_entities.erase(std::find(m_entities.begin(), m_entities.end(), entity));
 }
 
 void State::initializeEntity(std::shared_ptr<Entity> entity) {
+    registerEntity(entity, cookEntity(entity));
+}
+
+btVector3 State::cookEntity(std::shared_ptr<Entity> entity) {
     entity->onInitialize();
-    // If there is no physics shape set, the entity probably doesn't like physics so leave it alone
+
+    btVector3 inertia(0, 0, 0);
     if(entity->physicsShape() != nullptr) {
-        EntityMotionState* motionstate = new EntityMotionState(btTransform(btQuaternion(0, 0, entity->rotation()), btVector3(entity->position().x, entity->position().y, 0)), entity);
-        entity->setMotionState(motionstate);
-        btVector3 inertia(0, 0, 0);
         entity->physicsShape()->calculateLocalInertia(entity->mass(), inertia);
-        btRigidBody::btRigidBodyConstructionInfo construction_info(entity->mass(), motionstate, entity->physicsShape(), inertia);
-        entity->setPhysicsBody(new btRigidBody(construction_info));
+    }
+    return inertia;
+}
+
+void State::cookEntities(const std::vector<std::shared_ptr<Entity>>& entities, std::vector<btVector3>& inertias) {
+    inertias.assign(entities.size(), btVector3(0, 0, 0));
+
+    int threads = loadThreads > 0 ? loadThreads : std::thread::hardware_concurrency();
+    threads = std::min<int>(threads, entities.size() / MIN_ENTITIES_PER_COOK_THREAD);
+    if(threads <= 1) {
+        for(unsigned int i = 0; i < entities.size(); ++i) {
+            inertias[i] = cookEntity(entities[i]);
+        }
+        return;
+    }
 
-        // We're in 2D land so don't allow Z movement
-        entity->physicsBody()->setLinearFactor(btVector3(1, 1, 0));
-        entity->physicsBody()->setAngularFactor(btVector3(0, 0, 1));
+    // entities differ a lot in cost, so the threads take them one by one
+    std::atomic<unsigned int> next(0);
+    auto cook = [&]() {
+        for(unsigned int i = next++; i < entities.size(); i = next++) {
+            inertias[i] = cookEntity(entities[i]);
+        }
+    };
 
-        // Store a pointer to the entity in there, maybe we'll need it
-        entity->physicsBody()->setUserPointer((void*)entity.get());
+    std::vector<std::thread> workers;
+    for(int i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(cook));
+    }
+    cook();
+    for(auto& worker : workers) {
+        worker.join();
+    }
+}
 
-        m_dynamicsWorld->addRigidBody(entity->physicsBody());
+void State::registerEntity(std::shared_ptr<Entity> entity, const btVector3& inertia) {
+    // If there is no physics shape set, the entity probably doesn't like physics so leave it alone
+    if(entity->physicsShape() != nullptr) {
+        btTransform transform(btQuaternion(btVector3(0, 0, 1), entity->rotation()), btVector3(entity->position().x, entity->position().y, 0));
+        entity->setPhysicsBody(m_physics->createBody(entity, entity->physicsShape(), entity->mass(), inertia, transform));
+        m_physics->addBody(entity->physicsBody());
     }
 }
 
@@ -198,9 +410,27 @@ void State::drawEntities(sf::RenderTarget& target) {
         }
     });
 
+    if(!m_scenery.isBaked()) {
+        m_scenery.bake(m_spriteBatch, target, m_entities);
+    }
+
+    m_spriteBatch.begin(target);
+    auto layer = m_scenery.layers().begin();
     for(auto entity : m_entities) {
-        entity->handleDraw(target);
+        // scenery goes below everything else on its z-level
+        for(; layer != m_scenery.layers().end() && layer->first <= entity->zLevel(); ++layer) {
+            m_spriteBatch.draw(layer->second);
+        }
+        if(!entity->isScenery()) {
+            // merges equal textures of a z-level into one draw call
+            m_spriteBatch.setLayer(entity->zLevel());
+            entity->handleDraw(target);
+        }
+    }
+    for(; layer != m_scenery.layers().end(); ++layer) {
+        m_spriteBatch.draw(layer->second);
     }
+    m_spriteBatch.end();
 }
 
 void State::setView(sf::RenderTarget& target) {
@@ -211,30 +441,124 @@ void State::setView(sf::RenderTarget& target) {
     target.setView(m_view);
 }
 
-btDiscreteDynamicsWorld* State::dynamicsWorld() const {
-    return m_dynamicsWorld;
+PhysicsWorld* State::physics() const {
+    return m_physics;
+}
+
+std::string State::broadphaseName(State::BroadphaseType type) {
+    if(type == BROADPHASE_DBVT) return "dbvt";
+    if(type == BROADPHASE_AXIS_SWEEP) return "axis-sweep";
+    if(type == BROADPHASE_GRID) return "grid";
+    return "auto";
+}
+
+State::BroadphaseType State::broadphaseByName(const std::string& name) {
+    if(name == "dbvt") return BROADPHASE_DBVT;
+    if(name == "axis-sweep") return BROADPHASE_AXIS_SWEEP;
+    if(name == "grid") return BROADPHASE_GRID;
+    if(name != "auto") {
+        std::cerr << "Warning: unknown broadphase " << name << ", choosing automatically." << std::endl;
+    }
+    return BROADPHASE_AUTO;
+}
+
+State::BroadphaseType State::broadphaseType() const {
+    return m_broadphaseType;
+}
+
+void State::getLevelBounds(glm::vec2& lower, glm::vec2& upper) {
+    lower = glm::vec2(0, 0);
+    upper = glm::vec2(0, 0);
+    bool first = true;
+
+    for(auto shape : getEntitiesByType<CollisionShape>("CollisionShape")) {
+        for(auto& points : shape->shapes()) {
+            for(auto p : points) {
+                glm::vec2 g = shape->position() + p * shape->scale();
+                if(first) {
+                    lower = upper = g;
+                    first = false;
+                }
+                lower = glm::min(lower, g);
+                upper = glm::max(upper, g);
+            }
+        }
+    }
+}
+
+SleepManager& State::sleepManager() {
+    return m_sleepManager;
+}
+
+PhysicsProfiler& State::profiler() {
+    return m_profiler;
+}
+
+SpriteBatch& State::spriteBatch() {
+    return m_spriteBatch;
+}
+
+StaticScenery& State::scenery() {
+    return m_scenery;
 }
 
 void State::loadFromFile(const std::string& filename) {
-    std::ifstream stream;
-    stream.open(filename);
+    std::vector<std::shared_ptr<Entity>> entities;
+    if(!LevelFile::read(filename, entities)) {
+        std::cerr << "Warning: could not read level " << filename << "." << std::endl;
+        entities.clear();
+    }
+    loadEntities(entities, filename);
+}
 
-    // cereal::JSONInputArchive ar(stream);
-    if(filename.substr(filename.length() - 4) == "json") {
-        cereal::JSONInputArchive ar(stream);
-        ar(cereal::make_nvp("entities", m_entities));
-    } else {
-        cereal::PortableBinaryInputArchive ar(stream);
-        ar(cereal::make_nvp("entities", m_entities));
+void State::loadEntities(const std::vector<std::shared_ptr<Entity>>& entities, const std::string& filename) {
+    // the old entities leave the world before they are replaced
+    for(auto entity : m_entities) {
+        removeFromWorld(entity);
     }
-    stream.close();
+    clearContacts();
+    m_sleepManager.clear();
+
+    m_entities = entities;
+    m_scenery.invalidate();
+
+    getLevelBounds(m_levelLower, m_levelUpper);
+    m_broadphaseType = broadphase == BROADPHASE_AUTO ? levelBroadphase(filename) : broadphase;
 
     // reset the physics world
-    deinitializeWorld();
-    initializeWorld();
-    for(auto entity: m_entities) {
-        initializeEntity(entity);
-        entity->handleAddedToState(this);
+    if(canResetWorld()) {
+        resetWorld();
+    } else {
+        deinitializeWorld();
+        initializeWorld();
+    }
+
+    // triangle mesh BVHs are loaded from the cooked level if it is up to date,
+    // the slots are handed out up front so the shapes can cook in any order
+    CollisionBake bake(filename);
+    if(CollisionShape::cooking == CollisionShape::TRIANGLE_MESH) {
+        unsigned int meshes = 0;
+        for(auto entity : m_entities) {
+            if(entity->getTypeFlag() != Entity::TYPE_COLLISION_SHAPE) continue;
+            auto shape = std::static_pointer_cast<CollisionShape>(entity);
+            shape->setBakeIndex(meshes);
+            meshes += shape->meshCount();
+        }
+        bake.load();
+        bake.expect(meshes);
+        CollisionShape::bake = &bake;
+    }
+
+    std::vector<btVector3> inertias;
+    cookEntities(m_entities, inertias);
+    for(unsigned int i = 0; i < m_entities.size(); ++i) {
+        registerEntity(m_entities[i], inertias[i]);
+        m_entities[i]->handleAddedToState(this);
+    }
+
+    CollisionShape::bake = nullptr;
+    if(bake.isDirty()) {
+        bake.save();
     }
 }
 
@@ -253,48 +577,93 @@ void State::saveToFile(const std::string& filename) {
     stream.close();
 }
 
-const std::vector<std::shared_ptr<Entity>>& State::getEntities() const {
-    return m_entities;
+void State::saveSnapshot(Snapshot& snapshot) {
+    snapshot.begin(Snapshot::SAVE);
+    snapshot.m_entities = m_entities;
+    snapshot.m_tweener = m_tweener;
+
+    snapshot.m_sortedEntities.clear();
+    for(auto entity : m_entities) {
+        snapshot.m_sortedEntities.push_back(entity.get());
+    }
+    std::sort(snapshot.m_sortedEntities.begin(), snapshot.m_sortedEntities.end());
+
+    snapshot.io(m_time);
+    snapshot.io(m_total_elapsed);
+    for(auto entity : snapshot.m_entities) {
+        entity->handleSnapshot(snapshot);
+    }
+    onSnapshot(snapshot);
 }
 
-std::map<Entity*, std::vector<EntityCollision>> State::getBodyContacts(btCollisionObject* from) {
-    std::map<Entity*, std::vector<EntityCollision>> map;
+void State::restoreSnapshot(Snapshot& snapshot) {
+    if(snapshot.isEmpty()) return;
 
-    int numManifolds = dynamicsWorld()->getDispatcher()->getNumManifolds();
-    for(int i = 0; i < numManifolds; i++) {
-        btPersistentManifold* contactManifold = dynamicsWorld()->getDispatcher()->getManifoldByIndexInternal(i);
-        const btCollisionObject* obA = static_cast<const btCollisionObject*>(contactManifold->getBody0());
-        const btCollisionObject* obB = static_cast<const btCollisionObject*>(contactManifold->getBody1());
+    // entities created after the snapshot leave the world, the world itself is kept
+    for(auto entity : m_entities) {
+        if(!std::binary_search(snapshot.m_sortedEntities.begin(), snapshot.m_sortedEntities.end(), entity.get())) {
+            removeFromWorld(entity);
+        }
+    }
 
-        if(obA != from && obB != from) continue;
+    // entities removed since then come back with their old bodies
+    for(auto entity : snapshot.m_entities) {
+        if(entity->physicsBody() != nullptr && !entity->physicsBody()->isInWorld()) {
+            m_physics->addBody(entity->physicsBody());
+        }
+    }
 
-        Entity* a = static_cast<Entity*>(obA->getUserPointer());
-        Entity* b = static_cast<Entity*>(obB->getUserPointer());
+    m_entities = snapshot.m_entities;
+    m_tweener = snapshot.m_tweener;
+    m_scenery.invalidate();
+    clearContacts();
 
-        std::vector<EntityCollision> collisions;
-        for (int j = 0; j < contactManifold->getNumContacts(); j++) {
-            btManifoldPoint& pt = contactManifold->getContactPoint(j);
+    snapshot.begin(Snapshot::RESTORE);
+    snapshot.io(m_time);
+    snapshot.io(m_total_elapsed);
+    for(auto entity : m_entities) {
+        entity->handleSnapshot(snapshot);
+    }
+    onSnapshot(snapshot);
 
-            EntityCollision c;
-            c.other = (obA == from) ? b : a;
-            c.position = pt.getPositionWorldOnA();
-            c.otherPosition = pt.getPositionWorldOnB();
-            c.distance = pt.getDistance();
-            c.collisionObject = obA;
-            c.otherCollisionObject = obB;
+    m_physics->bodiesMoved();
+}
 
-            if(obA == from) {
-                std::swap(c.position, c.otherPosition);
-                std::swap(c.collisionObject, c.otherCollisionObject); 
-            }
+const std::vector<std::shared_ptr<Entity>>& State::getEntities() const {
+    return m_entities;
+}
 
-            collisions.push_back(c);
-        }
-        map[obA == from ? b : a] = collisions;
+std::map<Entity*, std::vector<EntityCollision>> State::getBodyContacts(PhysicsBody* from) {
+    std::map<Entity*, std::vector<EntityCollision>> map;
+
+    m_physics->getContacts(m_physicsContacts);
+    for(auto& pc : m_physicsContacts) {
+        if(pc.a != from && pc.b != from) continue;
+
+        EntityCollision c;
+        c.other = pc.a == from ? pc.b->entity() : pc.a->entity();
+        c.position = pc.a == from ? pc.positionOnA : pc.positionOnB;
+        c.otherPosition = pc.a == from ? pc.positionOnB : pc.positionOnA;
+        c.distance = pc.distance;
+        map[c.other].push_back(c);
     }
     return map;
 }
 
+void State::rayTestBatch(RayQuery* rays, int count) {
+    m_physics->rayTest(rays, count);
+}
+
+int State::getGhostContacts(PhysicsGhost* ghost, EntityCollision* buffer, int capacity, int typeMask) {
+    int count = 0;
+    visitGhostContacts(ghost, typeMask, [&](const EntityCollision& c) {
+        if(count < capacity) {
+            buffer[count++] = c;
+        }
+    });
+    return count;
+}
+
 float State::getPixelSize() const {
     return m_pixelSize;
 }
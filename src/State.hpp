@@ -2,6 +2,7 @@
 #define STATE_HPP
 
 #include <memory>
+#include <string>
 #include <vector>
 #include <SFML/Graphics.hpp>
 #include <btBulletDynamicsCommon.h>
@@ -9,7 +10,19 @@
 #include <CppTweener.h>
 
 #include "Entity.hpp"
+#include "PhysicsWorld.hpp"
 #include "DebugDraw.hpp"
+#include "Snapshot.hpp"
+#include "SleepManager.hpp"
+#include "PhysicsProfiler.hpp"
+#include "SpriteBatch.hpp"
+#include "StaticScenery.hpp"
+
+struct EntityContact {
+    Entity* a;
+    Entity* b;
+    EntityCollision collision; // seen from a
+};
 
 class State {
 public:
@@ -19,16 +32,22 @@ public:
     void init();
     void initializeWorld();
     void deinitializeWorld();
+    // Takes everything out of the world but keeps the world objects and
+    // their memory pools for the next level.
+    void resetWorld();
 
     void update(float dt);
     void draw(sf::RenderTarget& target);
     void handleEvent(sf::Event& event);
-    void worldTickCallback(btScalar timestep);
+    void updateContacts();
+    void dispatchContactEvents();
+    void clearContacts();
 
     virtual void onInit();
     virtual void onUpdate(float dt);
     virtual void onDraw(sf::RenderTarget& target);
     virtual void onHandleEvent(sf::Event& event);
+    virtual void onSnapshot(Snapshot& snapshot);
 
     void add(std::shared_ptr<Entity> entity);
     void remove(std::shared_ptr<Entity> entity);
@@ -36,11 +55,21 @@ public:
 
     glm::vec2 getMousePosition(bool local = true);
 
-    btDiscreteDynamicsWorld* dynamicsWorld() const;
+    PhysicsWorld* physics() const;
+    SleepManager& sleepManager();
+    PhysicsProfiler& profiler();
+    SpriteBatch& spriteBatch();
+    StaticScenery& scenery();
 
     void loadFromFile(const std::string& filename);
+    // replaces the entities of the state by freshly read ones, filename is
+    // the level they were read from
+    void loadEntities(const std::vector<std::shared_ptr<Entity>>& entities, const std::string& filename);
     void saveToFile(const std::string& filename);
 
+    void saveSnapshot(Snapshot& snapshot);
+    void restoreSnapshot(Snapshot& snapshot);
+
     tween::Tweener m_tweener;
     sf::Uint64 m_total_elapsed = 0;
 
@@ -57,7 +86,57 @@ public:
         return r;
     }
 
-    std::map<Entity*, std::vector<EntityCollision>> getBodyContacts(btCollisionObject* from);
+    std::map<Entity*, std::vector<EntityCollision>> getBodyContacts(PhysicsBody* from);
+
+    // Calls visitor(const EntityCollision&) for every contact point of the
+    // ghost with an entity matching typeMask, see PhysicsWorld::getGhostContacts.
+    // No memory is allocated once warmed up.
+    template<typename Visitor>
+    void visitGhostContacts(PhysicsGhost* ghost, int typeMask, Visitor visitor) {
+        m_physics->getGhostContacts(ghost, typeMask, m_ghostContacts);
+        for(auto& c : m_ghostContacts) {
+            visitor(c);
+        }
+    }
+
+    // Casts all rays against entities matching their filters. The broadphase
+    // is only traversed once for the bounding box of the whole batch.
+    void rayTestBatch(RayQuery* rays, int count);
+
+    // Writes up to capacity ghost contacts into buffer and returns the number written.
+    int getGhostContacts(PhysicsGhost* ghost, EntityCollision* buffer, int capacity, int typeMask = Entity::TYPE_ALL);
+
+    enum BroadphaseType {
+        BROADPHASE_AUTO,        // per level from levels/broadphase.txt, else DBVT
+        BROADPHASE_DBVT,
+        BROADPHASE_AXIS_SWEEP,  // bounded by the level geometry
+        BROADPHASE_GRID         // see GridBroadphase
+    };
+
+    // broadphase of worlds created afterwards
+    static BroadphaseType broadphase;
+    static std::string broadphaseName(BroadphaseType type);
+    static BroadphaseType broadphaseByName(const std::string& name);
+    BroadphaseType broadphaseType() const;
+
+    // lower and upper corner of all collision shapes
+    void getLevelBounds(glm::vec2& lower, glm::vec2& upper);
+
+    // Adaptive stepping shortens the substeps below 60 Hz for fast bodies
+    // and enables CCD on bodies that would still tunnel. Fixed stepping
+    // always uses 60 Hz substeps.
+    static bool adaptiveStepping;
+
+    // Levels reuse the world of the previous level when its settings still
+    // fit, instead of building a new one.
+    static bool reuseWorld;
+
+    // Number of threads used by worlds created afterwards. More than one
+    // thread needs Bullet built with BT_THREADSAFE, see CMakeLists.txt.
+    static int physicsThreads;
+    // Threads cooking the collision shapes of a level while loading,
+    // 0 uses one per core.
+    static int loadThreads;
 
     bool m_debugDrawEnabled = false;
     float getPixelSize() const;
@@ -67,6 +146,16 @@ public:
 
 protected:
     void drawEntities(sf::RenderTarget& target);
+    void removeFromWorld(std::shared_ptr<Entity> entity);
+    // Loading is split into cooking, which builds shapes and computes the
+    // inertia without touching the world and may run on several threads,
+    // and registering, which builds the bodies and adds them to the world.
+    btVector3 cookEntity(std::shared_ptr<Entity> entity);
+    void cookEntities(const std::vector<std::shared_ptr<Entity>>& entities, std::vector<btVector3>& inertias);
+    void registerEntity(std::shared_ptr<Entity> entity, const btVector3& inertia);
+    bool canResetWorld() const;
+    // returns the substep size and sets maxSubsteps for a frame of length dt
+    float chooseSubsteps(float dt, int& maxSubsteps);
     void setView(sf::RenderTarget& target);
 
     std::vector<std::shared_ptr<Entity>> m_entities;
@@ -82,12 +171,31 @@ protected:
     int m_fpsCurrentCounter = 0;
 
     // physics stuff
-    btBroadphaseInterface* m_broadphase = nullptr;
-    btDefaultCollisionConfiguration* m_collisionConfiguration = nullptr;
-    btCollisionDispatcher* m_collisionDispatcher = nullptr;
-    btSequentialImpulseConstraintSolver* m_solver = nullptr;
-    btDiscreteDynamicsWorld* m_dynamicsWorld = nullptr;
+    BroadphaseType m_broadphaseType = BROADPHASE_DBVT;
+    glm::vec2 m_levelLower = glm::vec2(-500, -500);
+    glm::vec2 m_levelUpper = glm::vec2(500, 500);
+
+    // what the current world was built with, see canResetWorld()
+    BroadphaseType m_worldBroadphaseType = BROADPHASE_DBVT;
+    btVector3 m_worldLower;
+    btVector3 m_worldUpper;
+    int m_worldThreads = 1;
+    int m_worldBackend = 0;
+    PhysicsWorld* m_physics = nullptr;
     DebugDraw* m_debugDrawer = nullptr;
+    SleepManager m_sleepManager;
+    PhysicsProfiler m_profiler;
+    SpriteBatch m_spriteBatch;
+    // text and boxes over the scene, in window coordinates
+    SpriteBatch m_overlayBatch;
+    StaticScenery m_scenery;
+
+    // contacts of entities with contact events, sorted by entity pair
+    std::vector<EntityContact> m_contacts;
+    std::vector<EntityContact> m_previousContacts;
+    std::vector<EntityContact> m_contactEvents;
+    std::vector<PhysicsContact> m_physicsContacts;
+    std::vector<EntityCollision> m_ghostContacts;
 };
 
 #endif
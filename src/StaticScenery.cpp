@@ -0,0 +1,45 @@
+#include "StaticScenery.hpp"
+
+#include "Entity.hpp"
+
+StaticScenery::StaticScenery()
+    : m_baked(false),
+      m_bakes(0) {}
+
+void StaticScenery::invalidate() {
+    m_baked = false;
+}
+
+bool StaticScenery::isBaked() const {
+    return m_baked;
+}
+
+void StaticScenery::bake(SpriteBatch& batch, sf::RenderTarget& target, const std::vector<std::shared_ptr<Entity>>& entities) {
+    m_layers.clear();
+    m_baked = true;
+    m_bakes++;
+
+    for(auto entity : entities) {
+        if(!entity->isScenery()) continue;
+
+        // entities are not drawn before their first update, bake again then
+        if(entity->isFreshman()) {
+            m_baked = false;
+            continue;
+        }
+
+        // one batch per texture of a layer, whatever the y order
+        batch.record(m_layers[entity->zLevel()]);
+        batch.setLayer(entity->zLevel());
+        entity->handleDraw(target);
+    }
+    batch.end();
+}
+
+const StaticScenery::Layers& StaticScenery::layers() const {
+    return m_layers;
+}
+
+int StaticScenery::bakes() const {
+    return m_bakes;
+}
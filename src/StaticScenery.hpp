@@ -0,0 +1,42 @@
+#ifndef STATICSCENERY_HPP
+#define STATICSCENERY_HPP
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "SpriteBatch.hpp"
+
+class Entity;
+
+// Entities that never move outside the editor (see Entity::isScenery) are
+// drawn once into recorded sprite batches, one list per z-level with one
+// batch per render state, and the batches are drawn every frame instead of
+// the entities. A layer is drawn before the other entities of its z-level.
+//
+// Anything that changes scenery has to invalidate() it, the next frame
+// bakes it again.
+class StaticScenery {
+public:
+    typedef std::map<int, std::vector<SpriteBatch::Batch>> Layers;
+
+    StaticScenery();
+
+    void invalidate();
+    bool isBaked() const;
+
+    // entities in draw order
+    void bake(SpriteBatch& batch, sf::RenderTarget& target, const std::vector<std::shared_ptr<Entity>>& entities);
+    const Layers& layers() const;
+
+    // since the start
+    int bakes() const;
+
+private:
+    Layers m_layers;
+    bool m_baked;
+    int m_bakes;
+};
+
+#endif
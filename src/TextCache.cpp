@@ -0,0 +1,124 @@
+#include "TextCache.hpp"
+
+#include <algorithm>
+
+TextCache::TextCache()
+    : m_frame(0),
+      m_built(0) {}
+
+const TextCache::Layout& TextCache::layout(const sf::Font& font, unsigned int characterSize, const std::string& string, sf::Uint32 style) {
+    auto it = m_layouts.find(Key(&font, characterSize, style, string));
+    if(it == m_layouts.end()) {
+        it = m_layouts.insert(std::make_pair(Key(&font, characterSize, style, string), Layout())).first;
+        build(it->second, font, characterSize, string, style);
+    }
+    it->second.frame = m_frame;
+    return it->second;
+}
+
+void TextCache::draw(SpriteBatch& batch, const sf::Font& font, unsigned int characterSize, const std::string& string,
+                     const sf::Color& color, const sf::RenderStates& states, sf::Uint32 style) {
+    const Layout& l = layout(font, characterSize, string, style);
+    if(l.vertices.empty()) return;
+
+    m_vertices.assign(l.vertices.begin(), l.vertices.end());
+    for(auto& vertex : m_vertices) {
+        vertex.color = color;
+    }
+
+    sf::RenderStates textStates(states);
+    textStates.texture = l.texture;
+    batch.draw(m_vertices.data(), m_vertices.size(), textStates);
+}
+
+void TextCache::nextFrame() {
+    for(auto it = m_layouts.begin(); it != m_layouts.end(); ) {
+        if(it->second.frame < m_frame) {
+            it = m_layouts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_frame++;
+}
+
+void TextCache::clear() {
+    m_layouts.clear();
+}
+
+size_t TextCache::size() const {
+    return m_layouts.size();
+}
+
+int TextCache::layouts() const {
+    return m_built;
+}
+
+void TextCache::build(Layout& layout, const sf::Font& font, unsigned int characterSize, const std::string& string, sf::Uint32 style) {
+    m_built++;
+    layout.texture = &font.getTexture(characterSize);
+    layout.bounds = sf::FloatRect();
+
+    bool bold = (style & sf::Text::Bold) != 0;
+    float italic = (style & sf::Text::Italic) ? 0.208f : 0.f; // 12 degrees, as sf::Text
+    float hspace = font.getGlyph(L' ', characterSize, bold).advance;
+    float vspace = font.getLineSpacing(characterSize);
+
+    // the first baseline is one character size down, as in sf::Text
+    float x = 0.f;
+    float y = characterSize;
+    float minX = characterSize, minY = characterSize, maxX = 0.f, maxY = 0.f;
+    sf::Uint32 previous = 0;
+
+    for(char ch : string) {
+        sf::Uint32 c = (unsigned char)ch;
+        x += font.getKerning(previous, c, characterSize);
+        previous = c;
+
+        if(c == ' ') {
+            x += hspace;
+            continue;
+        } else if(c == '\t') {
+            x += hspace * 4;
+            continue;
+        } else if(c == '\n') {
+            y += vspace;
+            x = 0;
+            continue;
+        }
+
+        const sf::Glyph& glyph = font.getGlyph(c, characterSize, bold);
+        float left   = glyph.bounds.left;
+        float top    = glyph.bounds.top;
+        float right  = glyph.bounds.left + glyph.bounds.width;
+        float bottom = glyph.bounds.top + glyph.bounds.height;
+
+        float u1 = glyph.textureRect.left;
+        float v1 = glyph.textureRect.top;
+        float u2 = glyph.textureRect.left + glyph.textureRect.width;
+        float v2 = glyph.textureRect.top + glyph.textureRect.height;
+
+        sf::Vertex topLeft    (sf::Vector2f(x + left - italic * top,     y + top),    sf::Color::White, sf::Vector2f(u1, v1));
+        sf::Vertex topRight   (sf::Vector2f(x + right - italic * top,    y + top),    sf::Color::White, sf::Vector2f(u2, v1));
+        sf::Vertex bottomLeft (sf::Vector2f(x + left - italic * bottom,  y + bottom), sf::Color::White, sf::Vector2f(u1, v2));
+        sf::Vertex bottomRight(sf::Vector2f(x + right - italic * bottom, y + bottom), sf::Color::White, sf::Vector2f(u2, v2));
+
+        layout.vertices.push_back(topLeft);
+        layout.vertices.push_back(topRight);
+        layout.vertices.push_back(bottomLeft);
+        layout.vertices.push_back(bottomLeft);
+        layout.vertices.push_back(topRight);
+        layout.vertices.push_back(bottomRight);
+
+        minX = std::min(minX, x + left - italic * bottom);
+        maxX = std::max(maxX, x + right - italic * top);
+        minY = std::min(minY, y + top);
+        maxY = std::max(maxY, y + bottom);
+
+        x += glyph.advance;
+    }
+
+    if(!layout.vertices.empty()) {
+        layout.bounds = sf::FloatRect(minX, minY, maxX - minX, maxY - minY);
+    }
+}
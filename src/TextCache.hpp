@@ -0,0 +1,50 @@
+#ifndef TEXTCACHE_HPP
+#define TEXTCACHE_HPP
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "SpriteBatch.hpp"
+
+// Keeps strings laid out into glyph quads, the way sf::Text places them,
+// so labels that stay the same are not laid out again every frame. Drawn
+// through a SpriteBatch, all text of one font and size ends up in one draw
+// call as long as nothing else comes in between. Layouts that were not
+// used during the last frame are dropped.
+class TextCache {
+public:
+    struct Layout {
+        std::vector<sf::Vertex> vertices;   // sf::Triangles, white
+        sf::FloatRect bounds;               // like sf::Text::getLocalBounds()
+        const sf::Texture* texture;
+        unsigned long frame;
+    };
+
+    TextCache();
+
+    const Layout& layout(const sf::Font& font, unsigned int characterSize, const std::string& string, sf::Uint32 style = sf::Text::Regular);
+    // the top left of the text goes to the origin of states.transform
+    void draw(SpriteBatch& batch, const sf::Font& font, unsigned int characterSize, const std::string& string,
+              const sf::Color& color, const sf::RenderStates& states = sf::RenderStates::Default, sf::Uint32 style = sf::Text::Regular);
+
+    void nextFrame();
+    void clear();
+    size_t size() const;
+    // since the start
+    int layouts() const;
+
+private:
+    typedef std::tuple<const sf::Font*, unsigned int, sf::Uint32, std::string> Key;
+
+    void build(Layout& layout, const sf::Font& font, unsigned int characterSize, const std::string& string, sf::Uint32 style);
+
+    std::map<Key, Layout> m_layouts;
+    std::vector<sf::Vertex> m_vertices;
+    unsigned long m_frame;
+    int m_built;
+};
+
+#endif
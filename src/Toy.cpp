@@ -13,15 +13,27 @@
 Toy::Toy() {
     m_mass = 1.f;
     m_zLevel = 800;
-    m_physicsShape = new btBoxShape(btVector3(0.5, 0.5, 1));
+    updateShape();
 }
 
 std::string Toy::getTypeName() const {
     return "Toy";
 }
 
+Entity::TypeFlag Toy::getTypeFlag() const {
+    return TYPE_TOY;
+}
+
 void Toy::onUpdate(double dt) {
-    m_physicsShape->setLocalScaling(btVector3(m_scale.x, m_scale.y, 1));
+    if(m_shapeScale != m_scale) {
+        updateShape();
+    }
+}
+
+void Toy::updateShape() {
+    // boxes of the same size share their shape
+    m_shapeScale = m_scale;
+    setPhysicsShape(Root().shapes.box(btVector3(0.5 * m_scale.x, 0.5 * m_scale.y, 1)));
 }
 
 void Toy::onDraw(sf::RenderTarget& target) {
@@ -33,11 +45,10 @@ void Toy::onDraw(sf::RenderTarget& target) {
     sprite.setRotation(thor::toDegree(m_rotation));
     sprite.setScale(m_scale.x / s.x, m_scale.y / s.y);
     sprite.setOrigin(s.x / 2, s.y / 2);
-    target.draw(sprite);
+    m_state->spriteBatch().draw(sprite);
 }
 
 void Toy::onAdd(State* state) {
     m_physicsBody->setDamping(0.5, 5);
     m_physicsBody->setAngularFactor(0.2);
-    m_physicsBody->forceActivationState(DISABLE_DEACTIVATION);
 }
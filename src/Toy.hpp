@@ -9,12 +9,16 @@ class Toy : public Entity {
 public:
     Toy();
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
 
     void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget& target) override;
     void onAdd(State *state);
 
 private:
+    void updateShape();
+
+    glm::vec2 m_shapeScale = glm::vec2(0, 0);
 };
 
 #endif
@@ -25,6 +25,21 @@ std::string Wall::getTypeName() const {
     return "Wall";
 }
 
+Entity::TypeFlag Wall::getTypeFlag() const {
+    return TYPE_WALL;
+}
+
+std::shared_ptr<Entity> Wall::clone() const {
+    auto wall = std::make_shared<Wall>();
+    wall->copySavedFields(*this);
+    wall->setType(m_type);
+    return wall;
+}
+
+bool Wall::isScenery() const {
+    return true;
+}
+
 void Wall::onUpdate(double dt) {
     // m_physicsShape->setLocalScaling(btVector3(m_scale.x, m_scale.y, 1));
 }
@@ -35,7 +50,7 @@ void Wall::onDraw(sf::RenderTarget& target) {
     m_sprite.setPosition(m_position.x, m_position.y);
     m_sprite.setScale(m_scale.x / s.x, m_scale.y / s.y);
     m_sprite.setRotation(thor::toDegree(m_rotation));
-    target.draw(m_sprite);
+    m_state->spriteBatch().draw(m_sprite);
 }
 
 void Wall::setMetadata(int data) {
@@ -56,6 +71,10 @@ void Wall::setType(const std::string& type) {
     m_sprite = sf::Sprite(*Root().resources.getTexture("wall-" + m_type).get());
 }
 
+const std::string& Wall::getType() const {
+    return m_type;
+}
+
 glm::vec2 Wall::getSize() {
     return glm::vec2(1, 1);
 }
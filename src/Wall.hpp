@@ -16,6 +16,9 @@ public:
     Wall();
     
     std::string getTypeName() const override;
+    TypeFlag getTypeFlag() const override;
+    std::shared_ptr<Entity> clone() const override;
+    bool isScenery() const override;
 
     void onUpdate(double dt) override;
     void onDraw(sf::RenderTarget& target) override;
@@ -23,6 +26,7 @@ public:
 
     void setMetadata(int data);
     void setType(const std::string& type);
+    const std::string& getType() const;
 
     glm::vec2 getSize();
 
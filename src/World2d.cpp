@@ -0,0 +1,1023 @@
+#include "World2d.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <tuple>
+
+const float World2d::CONTACT_MARGIN = 0.02f;
+
+// same as bullet's defaults, so both backends behave alike
+static const int SOLVER_ITERATIONS = 10;
+static const float BAUMGARTE = 0.2f;
+static const float ALLOWED_PENETRATION = 0.005f;
+static const float MAX_FRICTION = 10.f;
+static const float SLEEP_LINEAR_VELOCITY = 0.8f;
+static const float SLEEP_ANGULAR_VELOCITY = 1.f;
+static const float TIME_TO_SLEEP = 2.f;
+
+// static shapes are sorted into a grid of this cell size, shapes covering
+// more cells than MAX_STATIC_CELLS are tested against everything instead
+static const float STATIC_CELL_SIZE = 2.f;
+static const int MAX_STATIC_CELLS = 1024;
+
+static const float PI = 3.14159265358979f;
+
+static float cross(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+// angular velocity w times r
+static glm::vec2 cross(float w, const glm::vec2& r) {
+    return glm::vec2(-w * r.y, w * r.x);
+}
+
+static glm::vec2 rotate(const glm::vec2& v, float c, float s) {
+    return glm::vec2(c * v.x - s * v.y, s * v.x + c * v.y);
+}
+
+static float elapsedMs(std::chrono::steady_clock::time_point& since) {
+    auto now = std::chrono::steady_clock::now();
+    float ms = std::chrono::duration<float, std::milli>(now - since).count();
+    since = now;
+    return ms;
+}
+
+bool World2d::Bounds::overlaps(const Bounds& other) const {
+    return lower.x <= other.upper.x && other.lower.x <= upper.x
+        && lower.y <= other.upper.y && other.lower.y <= upper.y;
+}
+
+World2d::Shape World2d::Shape::circle(const glm::vec2& center, float radius) {
+    Shape shape;
+    shape.vertices.push_back(center);
+    shape.radius = radius;
+    return shape;
+}
+
+World2d::Shape World2d::Shape::polygon(const std::vector<glm::vec2>& points, float radius) {
+    // monotone chain, collinear points are dropped
+    std::vector<glm::vec2> sorted = points;
+    std::sort(sorted.begin(), sorted.end(), [](const glm::vec2& a, const glm::vec2& b) -> bool {
+        return a.x != b.x ? a.x < b.x : a.y < b.y;
+    });
+
+    std::vector<glm::vec2> hull(2 * sorted.size());
+    int k = 0;
+    for(unsigned int i = 0; i < sorted.size(); ++i) {
+        while(k >= 2 && cross(hull[k-1] - hull[k-2], sorted[i] - hull[k-2]) <= 1e-9f) k--;
+        hull[k++] = sorted[i];
+    }
+    for(int i = (int)sorted.size() - 2, lower = k + 1; i >= 0; --i) {
+        while(k >= lower && cross(hull[k-1] - hull[k-2], sorted[i] - hull[k-2]) <= 1e-9f) k--;
+        hull[k++] = sorted[i];
+    }
+    hull.resize(std::max(0, k - 1));
+
+    // points closer than this are one vertex
+    Shape shape;
+    shape.radius = radius;
+    for(auto& p : hull) {
+        if(shape.vertices.empty() || glm::length(p - shape.vertices.back()) > 1e-5f) {
+            shape.vertices.push_back(p);
+        }
+    }
+    while(shape.vertices.size() > 1 && glm::length(shape.vertices.front() - shape.vertices.back()) <= 1e-5f) {
+        shape.vertices.pop_back();
+    }
+    if(shape.vertices.empty() && !points.empty()) {
+        shape.vertices.push_back(points[0]);
+    }
+
+    unsigned int n = shape.vertices.size();
+    if(n >= 2) {
+        for(unsigned int i = 0; i < n; ++i) {
+            glm::vec2 edge = shape.vertices[(i + 1) % n] - shape.vertices[i];
+            shape.normals.push_back(glm::normalize(glm::vec2(edge.y, -edge.x)));
+        }
+    }
+    return shape;
+}
+
+void World2d::Body::setMass(float new_mass) {
+    boundingRadius = 0;
+    for(auto& shape : shapes) {
+        for(auto& v : shape.vertices) {
+            boundingRadius = std::max(boundingRadius, glm::length(v) + shape.radius);
+        }
+    }
+
+    if(new_mass <= 0) {
+        mass = 0;
+        invMass = 0;
+        invInertia = 0;
+        return;
+    }
+
+    // area and second moment around the origin at unit density, the origin
+    // is the center of mass like in bullet
+    float area = 0;
+    float moment = 0;
+    for(auto& shape : shapes) {
+        unsigned int n = shape.vertices.size();
+        if(n == 1) {
+            const glm::vec2& c = shape.vertices[0];
+            float a = PI * shape.radius * shape.radius;
+            area += a;
+            moment += a * (0.5f * shape.radius * shape.radius + glm::dot(c, c));
+        } else if(n >= 3) {
+            for(unsigned int i = 0; i < n; ++i) {
+                const glm::vec2& e1 = shape.vertices[i];
+                const glm::vec2& e2 = shape.vertices[(i + 1) % n];
+                float d = cross(e1, e2);
+                area += 0.5f * d;
+                moment += (0.25f / 3.f) * d * (e1.x * e1.x + e2.x * e1.x + e2.x * e2.x + e1.y * e1.y + e2.y * e1.y + e2.y * e2.y);
+            }
+        }
+    }
+
+    mass = new_mass;
+    invMass = 1.f / mass;
+    float inertia = area > 0 ? mass / area * moment : 0.5f * mass * boundingRadius * boundingRadius;
+    invInertia = inertia > 0 ? 1.f / inertia : 0;
+}
+
+bool World2d::Body::isStatic() const {
+    return invMass == 0;
+}
+
+bool World2d::Body::isInWorld() const {
+    return m_world != nullptr;
+}
+
+bool World2d::Arbiter::touching() const {
+    return count > 0;
+}
+
+World2d::World2d() {}
+
+World2d::~World2d() {
+    for(auto body : m_bodies) {
+        body->m_world = nullptr;
+    }
+}
+
+void World2d::add(Body* body) {
+    body->m_world = this;
+    body->m_id = m_nextId++;
+    body->gravity = m_gravity;
+    m_bodies.push_back(body);
+
+    updateProxies(body);
+    if(body->isStatic()) {
+        m_staticGridDirty = true;
+    } else {
+        for(unsigned int i = 0; i < body->shapes.size(); ++i) {
+            m_dynamicShapes.push_back(ShapeRef{body, (int)i});
+        }
+    }
+}
+
+void World2d::remove(Body* body) {
+    if(body->m_world != this) return;
+
+    m_bodies.erase(std::find(m_bodies.begin(), m_bodies.end(), body));
+    m_dynamicShapes.erase(std::remove_if(m_dynamicShapes.begin(), m_dynamicShapes.end(), [body](const ShapeRef& ref) -> bool {
+        return ref.body == body;
+    }), m_dynamicShapes.end());
+    if(body->isStatic()) {
+        m_staticGridDirty = true;
+    }
+
+    dropArbiters(body);
+    m_previousArbiters.erase(std::remove_if(m_previousArbiters.begin(), m_previousArbiters.end(), [body](const Arbiter& a) -> bool {
+        return a.a == body || a.b == body;
+    }), m_previousArbiters.end());
+    body->m_world = nullptr;
+}
+
+void World2d::clear() {
+    for(auto body : m_bodies) {
+        body->m_world = nullptr;
+    }
+    m_bodies.clear();
+    m_dynamicShapes.clear();
+    m_staticGrid.clear();
+    m_largeStatics.clear();
+    m_staticGridDirty = true;
+    m_arbiters.clear();
+    m_previousArbiters.clear();
+    m_remainder = 0;
+}
+
+void World2d::setGravity(const glm::vec2& gravity) {
+    m_gravity = gravity;
+    for(auto body : m_bodies) {
+        body->gravity = gravity;
+    }
+}
+
+int World2d::step(float dt, int maxSubsteps, float substepSize) {
+    int substeps = 0;
+    if(maxSubsteps > 0) {
+        m_remainder += dt;
+        substeps = (int)(m_remainder / substepSize);
+        m_remainder -= substeps * substepSize;
+    } else {
+        // variable step
+        substepSize = dt;
+        substeps = dt > 0 ? 1 : 0;
+        maxSubsteps = 1;
+        m_remainder = 0;
+    }
+
+    m_stats.broadphaseTime = 0;
+    m_stats.narrowphaseTime = 0;
+    m_stats.solverTime = 0;
+    for(int i = 0; i < std::min(substeps, maxSubsteps); ++i) {
+        substep(substepSize);
+    }
+
+    // forces last for one step() call, like in bullet
+    for(auto body : m_bodies) {
+        body->force = glm::vec2(0, 0);
+        body->torque = 0;
+    }
+    return substeps;
+}
+
+float World2d::remainder() const {
+    return m_remainder;
+}
+
+void World2d::moved(Body* body) {
+    updateProxies(body);
+    if(!body->isInWorld()) return;
+
+    if(body->isStatic()) {
+        m_staticGridDirty = true;
+    }
+    // contacts of bodies at rest are kept between steps, now they are wrong
+    if(!isMoving(body)) {
+        dropArbiters(body);
+    }
+}
+
+void World2d::wake(Body* body) {
+    if(body->isStatic()) return;
+    body->awake = true;
+    body->restTime = 0;
+}
+
+const std::vector<World2d::Body*>& World2d::bodies() const {
+    return m_bodies;
+}
+
+const std::vector<World2d::Arbiter>& World2d::arbiters() const {
+    return m_arbiters;
+}
+
+const World2d::Stats& World2d::stats() const {
+    return m_stats;
+}
+
+void World2d::substep(float h) {
+    auto clock = std::chrono::steady_clock::now();
+    findPairs(h);
+    m_stats.broadphaseTime += elapsedMs(clock);
+    collidePairs();
+    m_stats.narrowphaseTime += elapsedMs(clock);
+
+    wakeTouching();
+    solve(h);
+    integrate(h);
+    updateSleep(h);
+    m_stats.solverTime += elapsedMs(clock);
+}
+
+void World2d::updateProxies(Body* body) {
+    body->m_proxies.resize(body->shapes.size());
+    float c = cos(body->angle);
+    float s = sin(body->angle);
+
+    for(unsigned int i = 0; i < body->shapes.size(); ++i) {
+        const Shape& shape = body->shapes[i];
+        Proxy& proxy = body->m_proxies[i];
+        proxy.vertices.resize(shape.vertices.size());
+        proxy.normals.resize(shape.normals.size());
+        proxy.radius = shape.radius;
+
+        for(unsigned int j = 0; j < shape.vertices.size(); ++j) {
+            proxy.vertices[j] = body->position + rotate(shape.vertices[j], c, s);
+        }
+        for(unsigned int j = 0; j < shape.normals.size(); ++j) {
+            proxy.normals[j] = rotate(shape.normals[j], c, s);
+        }
+
+        glm::vec2 lower(FLT_MAX, FLT_MAX), upper(-FLT_MAX, -FLT_MAX);
+        for(auto& v : proxy.vertices) {
+            lower = glm::min(lower, v);
+            upper = glm::max(upper, v);
+        }
+        glm::vec2 r(shape.radius, shape.radius);
+        proxy.bounds.lower = lower - r;
+        proxy.bounds.upper = upper + r;
+    }
+}
+
+World2d::CellKey World2d::cellKey(int x, int y) {
+    return ((CellKey)(unsigned int)x << 32) | (unsigned int)y;
+}
+
+void World2d::buildStaticGrid() {
+    for(auto& cell : m_staticGrid) {
+        cell.second.clear();
+    }
+    m_largeStatics.clear();
+
+    for(auto body : m_bodies) {
+        if(!body->isStatic()) continue;
+
+        for(unsigned int i = 0; i < body->m_proxies.size(); ++i) {
+            const Bounds& bounds = body->m_proxies[i].bounds;
+            int x0 = (int)floor(bounds.lower.x / STATIC_CELL_SIZE);
+            int y0 = (int)floor(bounds.lower.y / STATIC_CELL_SIZE);
+            int x1 = (int)floor(bounds.upper.x / STATIC_CELL_SIZE);
+            int y1 = (int)floor(bounds.upper.y / STATIC_CELL_SIZE);
+
+            ShapeRef ref{body, (int)i};
+            if((long long)(x1 - x0 + 1) * (y1 - y0 + 1) > MAX_STATIC_CELLS) {
+                m_largeStatics.push_back(ref);
+                continue;
+            }
+            for(int x = x0; x <= x1; ++x) {
+                for(int y = y0; y <= y1; ++y) {
+                    m_staticGrid[cellKey(x, y)].push_back(ref);
+                }
+            }
+        }
+    }
+    m_staticGridDirty = false;
+}
+
+bool World2d::canCollide(const Body* a, const Body* b) {
+    return a != b && (a->group & b->mask) && (b->group & a->mask);
+}
+
+bool World2d::isMoving(const Body* body) {
+    return !body->isStatic() && body->awake;
+}
+
+bool World2d::arbiterOrder(const Arbiter& x, const Arbiter& y) {
+    return std::make_tuple(x.a->m_id, x.b->m_id, x.shapeA, x.shapeB) < std::make_tuple(y.a->m_id, y.b->m_id, y.shapeA, y.shapeB);
+}
+
+void World2d::dropArbiters(Body* body) {
+    m_arbiters.erase(std::remove_if(m_arbiters.begin(), m_arbiters.end(), [body](const Arbiter& a) -> bool {
+        return a.a == body || a.b == body;
+    }), m_arbiters.end());
+}
+
+void World2d::queryBounds(const Bounds& bounds, std::vector<ShapeRef>& shapes) {
+    if(m_staticGridDirty) buildStaticGrid();
+    shapes.clear();
+
+    for(auto& ref : m_dynamicShapes) {
+        if(ref.body->m_proxies[ref.shape].bounds.overlaps(bounds)) {
+            shapes.push_back(ref);
+        }
+    }
+    queryStatics(bounds, shapes);
+}
+
+void World2d::findPairs(float h) {
+    if(m_staticGridDirty) buildStaticGrid();
+    m_candidates.clear();
+
+    // contacts between bodies that don't move stay as they are
+    m_previousArbiters.swap(m_arbiters);
+    m_arbiters.clear();
+    for(auto& arbiter : m_previousArbiters) {
+        if(!isMoving(arbiter.a) && !isMoving(arbiter.b)) {
+            m_arbiters.push_back(arbiter);
+        }
+    }
+
+    // how far each body may move in this step, contacts are made that far
+    // ahead so fast bodies don't pass through thin walls
+    float maxSweep = 0;
+    for(auto& ref : m_dynamicShapes) {
+        Body* body = ref.body;
+        body->m_sweep = 0;
+        if(isMoving(body)) {
+            glm::vec2 velocity = body->velocity + h * (body->gravity + body->invMass * body->force);
+            body->m_sweep = h * (glm::length(velocity) + body->boundingRadius * std::abs(body->angularVelocity));
+        }
+        maxSweep = std::max(maxSweep, body->m_sweep);
+    }
+
+    // dynamic shapes against each other, sweep and prune along x. The order
+    // barely changes between steps, so insertion sort is close to linear.
+    for(unsigned int i = 1; i < m_dynamicShapes.size(); ++i) {
+        ShapeRef ref = m_dynamicShapes[i];
+        float x = ref.body->m_proxies[ref.shape].bounds.lower.x;
+        int j = i - 1;
+        while(j >= 0 && m_dynamicShapes[j].body->m_proxies[m_dynamicShapes[j].shape].bounds.lower.x > x) {
+            m_dynamicShapes[j + 1] = m_dynamicShapes[j];
+            j--;
+        }
+        m_dynamicShapes[j + 1] = ref;
+    }
+
+    for(unsigned int i = 0; i < m_dynamicShapes.size(); ++i) {
+        const ShapeRef& a = m_dynamicShapes[i];
+        float reach = CONTACT_MARGIN + a.body->m_sweep;
+        Bounds bounds = a.body->m_proxies[a.shape].bounds;
+        bounds.lower -= glm::vec2(reach, reach);
+        bounds.upper += glm::vec2(reach, reach);
+
+        for(unsigned int j = i + 1; j < m_dynamicShapes.size(); ++j) {
+            const ShapeRef& b = m_dynamicShapes[j];
+            Bounds other = b.body->m_proxies[b.shape].bounds;
+            if(other.lower.x - maxSweep > bounds.upper.x) break;
+
+            if(!isMoving(a.body) && !isMoving(b.body)) continue;
+            if(!canCollide(a.body, b.body)) continue;
+            other.lower -= glm::vec2(b.body->m_sweep, b.body->m_sweep);
+            other.upper += glm::vec2(b.body->m_sweep, b.body->m_sweep);
+            if(other.overlaps(bounds)) {
+                m_candidates.push_back(std::make_pair(a, b));
+            }
+        }
+    }
+
+    // moving shapes against the static ones around them
+    for(auto& a : m_dynamicShapes) {
+        if(!isMoving(a.body)) continue;
+
+        float reach = CONTACT_MARGIN + a.body->m_sweep;
+        Bounds bounds = a.body->m_proxies[a.shape].bounds;
+        bounds.lower -= glm::vec2(reach, reach);
+        bounds.upper += glm::vec2(reach, reach);
+        m_queryShapes.clear();
+        queryStatics(bounds, m_queryShapes);
+        for(auto& b : m_queryShapes) {
+            if(canCollide(a.body, b.body)) {
+                m_candidates.push_back(std::make_pair(a, b));
+            }
+        }
+    }
+}
+
+void World2d::queryStatics(const Bounds& bounds, std::vector<ShapeRef>& shapes) {
+    for(auto& ref : m_largeStatics) {
+        if(ref.body->m_proxies[ref.shape].bounds.overlaps(bounds)) {
+            shapes.push_back(ref);
+        }
+    }
+
+    // shapes spanning several cells are only reported once
+    m_stamp++;
+    int x0 = (int)floor(bounds.lower.x / STATIC_CELL_SIZE);
+    int y0 = (int)floor(bounds.lower.y / STATIC_CELL_SIZE);
+    int x1 = (int)floor(bounds.upper.x / STATIC_CELL_SIZE);
+    int y1 = (int)floor(bounds.upper.y / STATIC_CELL_SIZE);
+    for(int x = x0; x <= x1; ++x) {
+        for(int y = y0; y <= y1; ++y) {
+            auto cell = m_staticGrid.find(cellKey(x, y));
+            if(cell == m_staticGrid.end()) continue;
+
+            for(auto& ref : cell->second) {
+                Proxy& proxy = ref.body->m_proxies[ref.shape];
+                if(proxy.stamp == m_stamp) continue;
+                proxy.stamp = m_stamp;
+                if(proxy.bounds.overlaps(bounds)) {
+                    shapes.push_back(ref);
+                }
+            }
+        }
+    }
+}
+
+void World2d::collidePairs() {
+    for(auto& candidate : m_candidates) {
+        ShapeRef a = candidate.first;
+        ShapeRef b = candidate.second;
+        if(b.body->m_id < a.body->m_id) std::swap(a, b);
+
+        Arbiter arbiter;
+        arbiter.a = a.body;
+        arbiter.b = b.body;
+        arbiter.shapeA = a.shape;
+        arbiter.shapeB = b.shape;
+        float margin = CONTACT_MARGIN + a.body->m_sweep + b.body->m_sweep;
+        if(!collide(a.body->m_proxies[a.shape], b.body->m_proxies[b.shape], margin, arbiter)) continue;
+
+        // warm start from the same features in the last step
+        auto previous = std::lower_bound(m_previousArbiters.begin(), m_previousArbiters.end(), arbiter, arbiterOrder);
+        if(previous != m_previousArbiters.end() && !arbiterOrder(arbiter, *previous)) {
+            for(int i = 0; i < arbiter.count; ++i) {
+                for(int j = 0; j < previous->count; ++j) {
+                    if(arbiter.contacts[i].id == previous->contacts[j].id) {
+                        arbiter.contacts[i].normalImpulse = previous->contacts[j].normalImpulse;
+                        arbiter.contacts[i].tangentImpulse = previous->contacts[j].tangentImpulse;
+                        break;
+                    }
+                }
+            }
+        }
+        m_arbiters.push_back(arbiter);
+    }
+    std::sort(m_arbiters.begin(), m_arbiters.end(), arbiterOrder);
+
+    m_stats.pairs = m_candidates.size();
+    m_stats.manifolds = m_arbiters.size();
+    m_stats.contacts = 0;
+    for(auto& arbiter : m_arbiters) {
+        m_stats.contacts += arbiter.count;
+    }
+}
+
+void World2d::wakeTouching() {
+    for(auto& arbiter : m_arbiters) {
+        Body* a = arbiter.a;
+        Body* b = arbiter.b;
+        if(!arbiter.touching() || a->sensor || b->sensor || a->isStatic() || b->isStatic()) continue;
+
+        if(a->awake != b->awake) {
+            wake(a->awake ? b : a);
+        }
+    }
+}
+
+void World2d::solve(float h) {
+    for(auto body : m_bodies) {
+        if(isMoving(body)) {
+            body->velocity += h * (body->gravity + body->invMass * body->force);
+            body->angularVelocity += h * body->invInertia * body->angularFactor * body->torque;
+            body->velocity *= pow(1.f - std::min(1.f, body->linearDamping), h);
+            body->angularVelocity *= pow(1.f - std::min(1.f, body->angularDamping), h);
+            body->m_solverInvMass = body->invMass;
+            body->m_solverInvInertia = body->invInertia * body->angularFactor;
+        } else {
+            body->m_solverInvMass = 0;
+            body->m_solverInvInertia = 0;
+        }
+    }
+
+    // impulses of the last step were for its substep size
+    float warmStart = m_previousSubstep > 0 ? h / m_previousSubstep : 0;
+    m_previousSubstep = h;
+
+    for(auto& arbiter : m_arbiters) {
+        Body* a = arbiter.a;
+        Body* b = arbiter.b;
+        if(a->sensor || b->sensor || (a->m_solverInvMass == 0 && b->m_solverInvMass == 0)) continue;
+
+        glm::vec2 n = arbiter.normal;
+        glm::vec2 t(n.y, -n.x);
+        for(int i = 0; i < arbiter.count; ++i) {
+            Contact& c = arbiter.contacts[i];
+            glm::vec2 p = (c.pointA + c.pointB) * 0.5f;
+            c.rA = p - a->position;
+            c.rB = p - b->position;
+
+            float rnA = cross(c.rA, n);
+            float rnB = cross(c.rB, n);
+            float k = a->m_solverInvMass + b->m_solverInvMass + a->m_solverInvInertia * rnA * rnA + b->m_solverInvInertia * rnB * rnB;
+            c.normalMass = k > 0 ? 1.f / k : 0;
+
+            float rtA = cross(c.rA, t);
+            float rtB = cross(c.rB, t);
+            k = a->m_solverInvMass + b->m_solverInvMass + a->m_solverInvInertia * rtA * rtA + b->m_solverInvInertia * rtB * rtB;
+            c.tangentMass = k > 0 ? 1.f / k : 0;
+
+            // pushes overlapping shapes apart, lets separated ones close the gap
+            if(c.separation > 0) {
+                c.bias = -c.separation / h;
+            } else {
+                c.bias = BAUMGARTE / h * std::max(0.f, -c.separation - ALLOWED_PENETRATION);
+            }
+
+            c.normalImpulse *= warmStart;
+            c.tangentImpulse *= warmStart;
+            glm::vec2 impulse = c.normalImpulse * n + c.tangentImpulse * t;
+            a->velocity -= a->m_solverInvMass * impulse;
+            a->angularVelocity -= a->m_solverInvInertia * cross(c.rA, impulse);
+            b->velocity += b->m_solverInvMass * impulse;
+            b->angularVelocity += b->m_solverInvInertia * cross(c.rB, impulse);
+        }
+    }
+
+    for(int iteration = 0; iteration < SOLVER_ITERATIONS; ++iteration) {
+        for(auto& arbiter : m_arbiters) {
+            Body* a = arbiter.a;
+            Body* b = arbiter.b;
+            if(a->sensor || b->sensor || (a->m_solverInvMass == 0 && b->m_solverInvMass == 0)) continue;
+
+            glm::vec2 n = arbiter.normal;
+            glm::vec2 t(n.y, -n.x);
+            float friction = std::min(MAX_FRICTION, a->friction * b->friction);
+
+            for(int i = 0; i < arbiter.count; ++i) {
+                Contact& c = arbiter.contacts[i];
+
+                glm::vec2 dv = b->velocity + cross(b->angularVelocity, c.rB) - a->velocity - cross(a->angularVelocity, c.rA);
+                float impulse = c.normalMass * (c.bias - glm::dot(dv, n));
+                float accumulated = std::max(c.normalImpulse + impulse, 0.f);
+                impulse = accumulated - c.normalImpulse;
+                c.normalImpulse = accumulated;
+
+                glm::vec2 p = impulse * n;
+                a->velocity -= a->m_solverInvMass * p;
+                a->angularVelocity -= a->m_solverInvInertia * cross(c.rA, p);
+                b->velocity += b->m_solverInvMass * p;
+                b->angularVelocity += b->m_solverInvInertia * cross(c.rB, p);
+
+                dv = b->velocity + cross(b->angularVelocity, c.rB) - a->velocity - cross(a->angularVelocity, c.rA);
+                impulse = -c.tangentMass * glm::dot(dv, t);
+                float limit = friction * c.normalImpulse;
+                accumulated = std::max(-limit, std::min(limit, c.tangentImpulse + impulse));
+                impulse = accumulated - c.tangentImpulse;
+                c.tangentImpulse = accumulated;
+
+                p = impulse * t;
+                a->velocity -= a->m_solverInvMass * p;
+                a->angularVelocity -= a->m_solverInvInertia * cross(c.rA, p);
+                b->velocity += b->m_solverInvMass * p;
+                b->angularVelocity += b->m_solverInvInertia * cross(c.rB, p);
+            }
+        }
+    }
+}
+
+void World2d::integrate(float h) {
+    for(auto body : m_bodies) {
+        if(!isMoving(body)) continue;
+
+        body->position += h * body->velocity;
+        body->angle += h * body->angularVelocity;
+        if(body->angle > PI) body->angle -= 2 * PI;
+        if(body->angle < -PI) body->angle += 2 * PI;
+        updateProxies(body);
+    }
+}
+
+static int findIsland(std::vector<int>& parents, int i) {
+    while(parents[i] != i) {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+void World2d::updateSleep(float h) {
+    m_islandParents.resize(m_bodies.size());
+    m_islandRest.assign(m_bodies.size(), FLT_MAX);
+    for(unsigned int i = 0; i < m_bodies.size(); ++i) {
+        m_bodies[i]->m_island = i;
+        m_islandParents[i] = i;
+
+        Body* body = m_bodies[i];
+        if(!isMoving(body)) continue;
+
+        float linear = glm::dot(body->velocity, body->velocity);
+        float angular = body->angularVelocity * body->angularVelocity;
+        if(linear > SLEEP_LINEAR_VELOCITY * SLEEP_LINEAR_VELOCITY || angular > SLEEP_ANGULAR_VELOCITY * SLEEP_ANGULAR_VELOCITY) {
+            body->restTime = 0;
+        } else {
+            body->restTime += h;
+        }
+    }
+
+    // bodies touching each other fall asleep together
+    for(auto& arbiter : m_arbiters) {
+        if(!arbiter.touching() || !isMoving(arbiter.a) || !isMoving(arbiter.b) || arbiter.a->sensor || arbiter.b->sensor) continue;
+        int a = findIsland(m_islandParents, arbiter.a->m_island);
+        int b = findIsland(m_islandParents, arbiter.b->m_island);
+        if(a != b) m_islandParents[a] = b;
+    }
+
+    m_stats.islands = 0;
+    m_stats.awakeBodies = 0;
+    for(unsigned int i = 0; i < m_bodies.size(); ++i) {
+        if(!isMoving(m_bodies[i])) continue;
+        int island = findIsland(m_islandParents, i);
+        if(m_islandRest[island] == FLT_MAX) m_stats.islands++;
+        m_islandRest[island] = std::min(m_islandRest[island], m_bodies[i]->restTime);
+    }
+
+    for(unsigned int i = 0; i < m_bodies.size(); ++i) {
+        Body* body = m_bodies[i];
+        if(!isMoving(body)) continue;
+
+        if(m_islandRest[findIsland(m_islandParents, i)] >= TIME_TO_SLEEP) {
+            body->awake = false;
+            body->velocity = glm::vec2(0, 0);
+            body->angularVelocity = 0;
+        } else {
+            m_stats.awakeBodies++;
+        }
+    }
+}
+
+struct ClipVertex {
+    glm::vec2 v;
+    unsigned int id;
+};
+
+// keeps the part of the segment behind the plane
+static int clipSegment(ClipVertex out[2], const ClipVertex in[2], const glm::vec2& normal, float offset, unsigned int clipId) {
+    int count = 0;
+    float d0 = glm::dot(normal, in[0].v) - offset;
+    float d1 = glm::dot(normal, in[1].v) - offset;
+    if(d0 <= 0) out[count++] = in[0];
+    if(d1 <= 0) out[count++] = in[1];
+    if(d0 * d1 < 0) {
+        out[count].v = in[0].v + (d0 / (d0 - d1)) * (in[1].v - in[0].v);
+        out[count].id = clipId;
+        count++;
+    }
+    return count;
+}
+
+// largest distance of p2 in front of an edge of p1
+static float maxSeparation(int& edge, const World2d::Proxy& p1, const World2d::Proxy& p2) {
+    float best = -FLT_MAX;
+    edge = 0;
+    for(unsigned int i = 0; i < p1.normals.size(); ++i) {
+        const glm::vec2& n = p1.normals[i];
+        const glm::vec2& v1 = p1.vertices[i];
+        float separation = FLT_MAX;
+        for(auto& v2 : p2.vertices) {
+            separation = std::min(separation, glm::dot(n, v2 - v1));
+        }
+        if(separation > best) {
+            best = separation;
+            edge = i;
+        }
+    }
+    return best;
+}
+
+static void resetContact(World2d::Contact& c) {
+    c.normalImpulse = 0;
+    c.tangentImpulse = 0;
+}
+
+static bool collideCircles(const World2d::Proxy& a, const World2d::Proxy& b, float margin, World2d::Arbiter& arbiter) {
+    glm::vec2 d = b.vertices[0] - a.vertices[0];
+    float radius = a.radius + b.radius;
+    float reach = radius + margin;
+    float distance2 = glm::dot(d, d);
+    if(distance2 > reach * reach) return false;
+
+    float distance = sqrt(distance2);
+    glm::vec2 n = distance > 1e-6f ? d / distance : glm::vec2(0, 1);
+
+    World2d::Contact& c = arbiter.contacts[0];
+    resetContact(c);
+    c.pointA = a.vertices[0] + n * a.radius;
+    c.pointB = b.vertices[0] - n * b.radius;
+    c.separation = distance - radius;
+    c.id = 0;
+    arbiter.normal = n;
+    arbiter.count = 1;
+    return true;
+}
+
+static bool collidePolygonCircle(const World2d::Proxy& a, const World2d::Proxy& b, float margin, World2d::Arbiter& arbiter) {
+    const glm::vec2& center = b.vertices[0];
+    float radius = a.radius + b.radius;
+    float reach = radius + margin;
+
+    // edge with the largest separation
+    int n = a.vertices.size();
+    int edge = 0;
+    float separation = -FLT_MAX;
+    for(int i = 0; i < n; ++i) {
+        float s = glm::dot(a.normals[i], center - a.vertices[i]);
+        if(s > reach) return false;
+        if(s > separation) {
+            separation = s;
+            edge = i;
+        }
+    }
+
+    const glm::vec2& v1 = a.vertices[edge];
+    const glm::vec2& v2 = a.vertices[(edge + 1) % n];
+    glm::vec2 normal = a.normals[edge];
+    glm::vec2 closest = center - normal * separation;
+
+    // outside of the edge, the closest feature may be one of its vertices
+    if(separation > 1e-6f) {
+        const glm::vec2* vertex = nullptr;
+        if(glm::dot(center - v1, v2 - v1) <= 0) {
+            vertex = &v1;
+        } else if(glm::dot(center - v2, v1 - v2) <= 0) {
+            vertex = &v2;
+        }
+        if(vertex) {
+            glm::vec2 d = center - *vertex;
+            if(glm::dot(d, d) > reach * reach) return false;
+            float length = glm::length(d);
+            if(length > 1e-6f) normal = d / length;
+            closest = *vertex;
+        }
+    }
+
+    World2d::Contact& c = arbiter.contacts[0];
+    resetContact(c);
+    c.pointA = closest + normal * a.radius;
+    c.pointB = center - normal * b.radius;
+    c.separation = glm::dot(center - closest, normal) - radius;
+    c.id = edge;
+    arbiter.normal = normal;
+    arbiter.count = 1;
+    return true;
+}
+
+static bool collidePolygons(const World2d::Proxy& a, const World2d::Proxy& b, float margin, World2d::Arbiter& arbiter) {
+    float radius = a.radius + b.radius;
+    float reach = radius + margin;
+
+    int edgeA, edgeB;
+    float separationA = maxSeparation(edgeA, a, b);
+    if(separationA > reach) return false;
+    float separationB = maxSeparation(edgeB, b, a);
+    if(separationB > reach) return false;
+
+    // the reference face is the one separating best, a is preferred
+    bool flip = separationB > separationA + 0.001f;
+    const World2d::Proxy& p1 = flip ? b : a;
+    const World2d::Proxy& p2 = flip ? a : b;
+    int edge = flip ? edgeB : edgeA;
+
+    // incident edge of p2, the one facing the reference face most
+    int n1 = p1.vertices.size();
+    int n2 = p2.vertices.size();
+    int incident = 0;
+    float minDot = FLT_MAX;
+    for(int i = 0; i < n2; ++i) {
+        float d = glm::dot(p1.normals[edge], p2.normals[i]);
+        if(d < minDot) {
+            minDot = d;
+            incident = i;
+        }
+    }
+    ClipVertex incidentEdge[2] = {
+        {p2.vertices[incident], (unsigned int)incident},
+        {p2.vertices[(incident + 1) % n2], (unsigned int)((incident + 1) % n2)}
+    };
+
+    const glm::vec2& v11 = p1.vertices[edge];
+    const glm::vec2& v12 = p1.vertices[(edge + 1) % n1];
+    glm::vec2 tangent = v12 - v11;
+    float length = glm::length(tangent);
+    if(length < 1e-6f) return false;
+    tangent /= length;
+    glm::vec2 normal(tangent.y, -tangent.x);
+
+    float frontOffset = glm::dot(normal, v11);
+    float sideOffset1 = -glm::dot(tangent, v11) + radius;
+    float sideOffset2 = glm::dot(tangent, v12) + radius;
+
+    // clip the incident edge to the sides of the reference face
+    ClipVertex clip1[2], clip2[2];
+    if(clipSegment(clip1, incidentEdge, -tangent, sideOffset1, 0x8000) < 2) return false;
+    if(clipSegment(clip2, clip1, tangent, sideOffset2, 0x8001) < 2) return false;
+
+    arbiter.normal = flip ? -normal : normal;
+    arbiter.count = 0;
+    for(int i = 0; i < 2; ++i) {
+        float separation = glm::dot(normal, clip2[i].v) - frontOffset;
+        if(separation > reach) continue;
+
+        glm::vec2 onIncident = clip2[i].v - normal * p2.radius;
+        glm::vec2 onReference = clip2[i].v - normal * (separation - p1.radius);
+
+        World2d::Contact& c = arbiter.contacts[arbiter.count++];
+        resetContact(c);
+        c.pointA = flip ? onIncident : onReference;
+        c.pointB = flip ? onReference : onIncident;
+        c.separation = separation - radius;
+        c.id = (flip ? 1u << 31 : 0) | ((unsigned int)edge << 16) | clip2[i].id;
+    }
+    return arbiter.count > 0;
+}
+
+bool World2d::collide(const Proxy& a, const Proxy& b, float margin, Arbiter& arbiter) {
+    arbiter.count = 0;
+    bool circleA = a.vertices.size() == 1;
+    bool circleB = b.vertices.size() == 1;
+
+    if(circleA && circleB) {
+        return collideCircles(a, b, margin, arbiter);
+    } else if(circleB) {
+        return collidePolygonCircle(a, b, margin, arbiter);
+    } else if(circleA) {
+        if(!collidePolygonCircle(b, a, margin, arbiter)) return false;
+        arbiter.normal = -arbiter.normal;
+        std::swap(arbiter.contacts[0].pointA, arbiter.contacts[0].pointB);
+        return true;
+    }
+    return collidePolygons(a, b, margin, arbiter);
+}
+
+bool World2d::rayCast(const ShapeRef& ref, const glm::vec2& from, const glm::vec2& to, float maxFraction, RayHit& hit) {
+    const Proxy& proxy = ref.body->m_proxies[ref.shape];
+    glm::vec2 d = to - from;
+    float fraction;
+    glm::vec2 normal;
+
+    if(proxy.vertices.size() == 1) {
+        glm::vec2 m = from - proxy.vertices[0];
+        float b = glm::dot(m, d);
+        float c = glm::dot(m, m) - proxy.radius * proxy.radius;
+        float a = glm::dot(d, d);
+        if(c < 0 || a < 1e-12f) return false;
+
+        float discriminant = b * b - a * c;
+        if(discriminant < 0) return false;
+        fraction = (-b - sqrt(discriminant)) / a;
+        if(fraction < 0 || fraction > maxFraction) return false;
+        normal = glm::normalize(m + d * fraction);
+    } else {
+        // clip the ray against the planes of the edges, moved out by the radius
+        float lower = 0;
+        float upper = maxFraction;
+        int index = -1;
+        unsigned int n = proxy.vertices.size();
+        unsigned int planes = n == 2 ? 4 : n;
+
+        for(unsigned int i = 0; i < planes; ++i) {
+            glm::vec2 planeNormal, planePoint;
+            if(i < n) {
+                planeNormal = proxy.normals[i];
+                planePoint = proxy.vertices[i];
+            } else {
+                // the ends of a capsule
+                glm::vec2 t = glm::normalize(proxy.vertices[1] - proxy.vertices[0]);
+                planeNormal = i == 2 ? t : -t;
+                planePoint = proxy.vertices[i == 2 ? 1 : 0];
+            }
+
+            float numerator = glm::dot(planeNormal, planePoint - from) + proxy.radius;
+            float denominator = glm::dot(planeNormal, d);
+            if(denominator == 0) {
+                if(numerator < 0) return false;
+            } else if(denominator < 0 && numerator < lower * denominator) {
+                lower = numerator / denominator;
+                index = i;
+            } else if(denominator > 0 && numerator < upper * denominator) {
+                upper = numerator / denominator;
+            }
+            if(upper < lower) return false;
+        }
+        if(index < 0) return false;
+
+        fraction = lower;
+        normal = index < (int)n ? proxy.normals[index] : (index == 2 ? glm::normalize(proxy.vertices[1] - proxy.vertices[0]) : glm::normalize(proxy.vertices[0] - proxy.vertices[1]));
+    }
+
+    hit.body = ref.body;
+    hit.shape = ref.shape;
+    hit.fraction = fraction;
+    hit.point = from + d * fraction;
+    hit.normal = normal;
+    return true;
+}
+
+void World2d::queryShape(const Shape& shape, const glm::vec2& position, float angle, short group, short mask, std::vector<Arbiter>& arbiters) {
+    arbiters.clear();
+    if(m_staticGridDirty) buildStaticGrid();
+
+    Body query;
+    query.shapes.push_back(shape);
+    query.position = position;
+    query.angle = angle;
+    query.group = group;
+    query.mask = mask;
+    updateProxies(&query);
+    const Proxy& proxy = query.m_proxies[0];
+
+    Bounds bounds = proxy.bounds;
+    glm::vec2 margin(CONTACT_MARGIN, CONTACT_MARGIN);
+    bounds.lower -= margin;
+    bounds.upper += margin;
+    queryBounds(bounds, m_queryShapes);
+
+    for(auto& ref : m_queryShapes) {
+        if(!canCollide(&query, ref.body)) continue;
+
+        Arbiter arbiter;
+        arbiter.a = nullptr;
+        arbiter.b = ref.body;
+        arbiter.shapeA = 0;
+        arbiter.shapeB = ref.shape;
+        if(collide(proxy, ref.body->m_proxies[ref.shape], CONTACT_MARGIN, arbiter)) {
+            arbiters.push_back(arbiter);
+        }
+    }
+}
@@ -0,0 +1,216 @@
+#ifndef WORLD2D_HPP
+#define WORLD2D_HPP
+
+#include <utility>
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+// A small rigid body simulation in the XY plane: rounded convex polygons
+// and circles, sequential impulses with friction and warm starting, and
+// islands that fall asleep. It knows nothing about entities or bullet,
+// Physics2dWorld puts it behind the PhysicsWorld interface.
+class World2d {
+public:
+    // Contacts are kept up to this distance apart, so fast bodies slow down
+    // before they hit something (speculative contacts).
+    static const float CONTACT_MARGIN;
+
+    struct Bounds {
+        glm::vec2 lower;
+        glm::vec2 upper;
+
+        bool overlaps(const Bounds& other) const;
+    };
+
+    // A convex polygon, counter-clockwise in body space, with everything
+    // within radius of it. A single vertex makes a circle, two a capsule.
+    struct Shape {
+        std::vector<glm::vec2> vertices;
+        std::vector<glm::vec2> normals;
+        float radius = 0;
+
+        static Shape circle(const glm::vec2& center, float radius);
+        // convex hull of the points
+        static Shape polygon(const std::vector<glm::vec2>& points, float radius = 0);
+    };
+
+    // a shape placed in the world
+    struct Proxy {
+        std::vector<glm::vec2> vertices;
+        std::vector<glm::vec2> normals;
+        float radius = 0;
+        Bounds bounds;
+        unsigned int stamp = 0;
+    };
+
+    struct Body {
+        std::vector<Shape> shapes;
+
+        glm::vec2 position = glm::vec2(0, 0);
+        float angle = 0;
+        glm::vec2 velocity = glm::vec2(0, 0);
+        float angularVelocity = 0;
+        glm::vec2 force = glm::vec2(0, 0);
+        float torque = 0;
+        glm::vec2 gravity = glm::vec2(0, 0);
+
+        float mass = 0;
+        float invMass = 0;
+        float invInertia = 0;
+        float friction = 0.5f;
+        float linearDamping = 0;
+        float angularDamping = 0;
+        float angularFactor = 1;
+        float boundingRadius = 0;
+        bool sensor = false;
+        short group = 1;
+        short mask = -1;
+
+        bool awake = true;
+        // seconds spent below the sleep thresholds
+        float restTime = 0;
+        void* user = nullptr;
+
+        // mass 0 makes the body static, the inertia comes from the shapes
+        void setMass(float mass);
+        bool isStatic() const;
+        bool isInWorld() const;
+
+    private:
+        friend class World2d;
+        std::vector<Proxy> m_proxies;
+        World2d* m_world = nullptr;
+        unsigned int m_id = 0;
+        int m_island = 0;
+        float m_solverInvMass = 0;
+        float m_solverInvInertia = 0;
+        float m_sweep = 0;
+    };
+
+    struct Contact {
+        glm::vec2 pointA;     // on the surface of a
+        glm::vec2 pointB;     // on the surface of b
+        float separation;     // negative when overlapping
+        unsigned int id;      // identifies the features across steps
+
+        // solver
+        glm::vec2 rA, rB;
+        float normalMass, tangentMass, bias;
+        float normalImpulse, tangentImpulse;
+    };
+
+    // the contacts between one shape of a and one of b
+    struct Arbiter {
+        Body* a;
+        Body* b;
+        int shapeA;
+        int shapeB;
+        glm::vec2 normal;     // from a to b
+        Contact contacts[2];
+        int count;
+
+        bool touching() const;
+    };
+
+    struct RayHit {
+        Body* body;
+        int shape;
+        float fraction;
+        glm::vec2 point;
+        glm::vec2 normal;
+    };
+
+    struct ShapeRef {
+        Body* body;
+        int shape;
+    };
+
+    struct Stats {
+        int pairs = 0;
+        int manifolds = 0;
+        int contacts = 0;
+        int islands = 0;
+        int awakeBodies = 0;
+        // milliseconds of the last step() call
+        float broadphaseTime = 0;
+        float narrowphaseTime = 0;
+        float solverTime = 0;
+    };
+
+    World2d();
+    ~World2d();
+
+    void add(Body* body);
+    void remove(Body* body);
+    // removes all bodies, keeping the memory
+    void clear();
+
+    void setGravity(const glm::vec2& gravity);
+    // Steps in fixed substeps of the given size like btDynamicsWorld::stepSimulation,
+    // and returns the number of substeps that were due.
+    int step(float dt, int maxSubsteps, float substep);
+    // time left over from the last step(), bodies are drawn that far ahead
+    float remainder() const;
+
+    // to be called after moving a body or changing its shapes by hand
+    void moved(Body* body);
+    void wake(Body* body);
+
+    const std::vector<Body*>& bodies() const;
+    const std::vector<Arbiter>& arbiters() const;
+    const Stats& stats() const;
+
+    // all shapes whose bounds overlap the box
+    void queryBounds(const Bounds& bounds, std::vector<ShapeRef>& shapes);
+    // Casts a ray against one shape, hits closer than maxFraction count.
+    // Rays starting inside a shape don't hit it.
+    static bool rayCast(const ShapeRef& ref, const glm::vec2& from, const glm::vec2& to, float maxFraction, RayHit& hit);
+    // contacts of a free shape with the shapes overlapping it, a is the query
+    void queryShape(const Shape& shape, const glm::vec2& position, float angle, short group, short mask, std::vector<Arbiter>& arbiters);
+
+private:
+    typedef unsigned long long CellKey;
+
+    void substep(float h);
+    void updateProxies(Body* body);
+    void buildStaticGrid();
+    // appends the static shapes overlapping the box
+    void queryStatics(const Bounds& bounds, std::vector<ShapeRef>& shapes);
+    void findPairs(float h);
+    void collidePairs();
+    void wakeTouching();
+    void solve(float h);
+    void integrate(float h);
+    void updateSleep(float h);
+    void dropArbiters(Body* body);
+
+    static bool collide(const Proxy& a, const Proxy& b, float margin, Arbiter& arbiter);
+    static bool arbiterOrder(const Arbiter& x, const Arbiter& y);
+    static bool canCollide(const Body* a, const Body* b);
+    static bool isMoving(const Body* body);
+    static CellKey cellKey(int x, int y);
+
+    std::vector<Body*> m_bodies;
+    std::vector<ShapeRef> m_dynamicShapes;
+    std::unordered_map<CellKey, std::vector<ShapeRef>> m_staticGrid;
+    // static shapes too large for the grid
+    std::vector<ShapeRef> m_largeStatics;
+    bool m_staticGridDirty = true;
+    unsigned int m_stamp = 0;
+    unsigned int m_nextId = 1;
+
+    glm::vec2 m_gravity = glm::vec2(0, 0);
+    float m_remainder = 0;
+
+    std::vector<std::pair<ShapeRef, ShapeRef>> m_candidates;
+    std::vector<Arbiter> m_arbiters;
+    std::vector<Arbiter> m_previousArbiters;
+    float m_previousSubstep = 0;
+    std::vector<int> m_islandParents;
+    std::vector<float> m_islandRest;
+    std::vector<ShapeRef> m_queryShapes;
+    Stats m_stats;
+};
+
+#endif
@@ -1,5 +1,8 @@
 #include <iostream>
 #include <stack>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
 
 #include <SFML/System.hpp>
 #include <SFML/Window.hpp>
@@ -11,6 +14,8 @@
 #include "GameState.hpp"
 #include "Level.hpp"
 #include "Pair.hpp"
+#include "PhysicsBackend.hpp"
+#include "PostProcessing.hpp"
 
 bool isFullscreen = false;
 sf::VideoMode defaultMode(1200, 900);
@@ -28,7 +33,23 @@ void createWindow() {
     Root().window->setFramerateLimit(0);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    for(int i = 1; i < argc; ++i) {
+        if(std::string(argv[i]) == "--physics-threads" && i + 1 < argc) {
+            State::physicsThreads = std::max(1, std::atoi(argv[++i]));
+        } else if(std::string(argv[i]) == "--load-threads" && i + 1 < argc) {
+            State::loadThreads = std::max(0, std::atoi(argv[++i]));
+        } else if(std::string(argv[i]) == "--broadphase" && i + 1 < argc) {
+            State::broadphase = State::broadphaseByName(argv[++i]);
+        } else if(std::string(argv[i]) == "--fixed-physics-steps") {
+            State::adaptiveStepping = false;
+        } else if(std::string(argv[i]) == "--quality" && i + 1 < argc) {
+            PostProcessing::quality = PostProcessing::qualityByName(argv[++i]);
+        } else if(std::string(argv[i]) == "--physics-2d") {
+            PhysicsBackend::type = PhysicsBackend::NATIVE_2D;
+        }
+    }
+
     if(!sf::Shader::isAvailable()) {
         std::cerr << "Sorry, your system does not support shaders. Please upgrade your video driver, enable your graphics card, or use a different device." << std::endl;
         exit(1);
@@ -41,45 +62,7 @@ int main() {
 
     sf::Clock clock;
 
-    Root().resources.addTexture("player",           "data/textures/player.png");
-    Root().resources.addTexture("pair",             "data/textures/pair.png");
-    Root().resources.addTexture("wall-box",         "data/textures/box.png");
-    Root().resources.addTexture("wall-platform-1",  "data/textures/platform-1.png");
-    Root().resources.addTexture("wall-platform-2",  "data/textures/platform-2.png");
-    Root().resources.addTexture("wall-gradient",    "data/textures/gradient.png");
-    Root().resources.addTexture("wall-godrays",     "data/textures/godrays.png");
-    Root().resources.addTexture("spiderweb",        "data/textures/spiderweb.png");
-    Root().resources.addTexture("blob",             "data/textures/blob.png");
-    Root().resources.addTexture("cave-1",           "data/textures/cave-1.jpg");
-    Root().resources.addTexture("perlin",           "data/textures/perlin.png");
-    Root().resources.addTexture("egg",              "data/textures/egg.png");
-    Root().resources.addTexture("egg-top",          "data/textures/egg-top.png");
-    Root().resources.addTexture("egg-bottom",       "data/textures/egg-bottom.png");
-    Root().resources.addTexture("egg-crack",        "data/textures/egg-crack.png");
-    Root().resources.addTexture("body",             "data/textures/body.png");
-    // Root().resources.addTexture("fang",             "data/textures/fang.png");
-    Root().resources.addTexture("upper-leg",        "data/textures/upper-leg.png");
-    Root().resources.addTexture("lower-leg",        "data/textures/lower-leg.png");
-    Root().resources.addTexture("help-walk",        "data/textures/help/walk.png");
-    Root().resources.addTexture("help-jump",        "data/textures/help/jump.png");
-    Root().resources.addTexture("help-walls",       "data/textures/help/walls.png");
-
-    Root().resources.addSound("crack",  "data/sounds/crack.ogg");
-    Root().resources.addSound("rumble", "data/sounds/rumble.ogg");
-    Root().resources.addSound("walk",   "data/sounds/walk.ogg");
-    Root().resources.addSound("bell",   "data/sounds/bell.wav");
-
-    Root().resources.addMusic("horror-ambience", "data/music/horror-ambience.wav");
-
-    Root().resources.addFont("title",   "data/fonts/Supernova.ttf");
-    Root().resources.addFont("default", "data/fonts/what-fish-died.ttf");
-    Root().resources.addFont("mono",    "data/fonts/UbuntuMono-R.ttf");
-
-    Root().resources.addShader("pixel",             "data/shaders/pixel.fragment.glsl", sf::Shader::Fragment);
-    Root().resources.addShader("backdrop",          "data/shaders/backdrop.fragment.glsl", sf::Shader::Fragment);
-    Root().resources.addShader("fog",               "data/shaders/fog.fragment.glsl", sf::Shader::Fragment);
-    Root().resources.addShader("blur-horizontal",   "data/shaders/blur-horizontal.fragment.glsl", sf::Shader::Fragment);
-    Root().resources.addShader("blur-vertical",     "data/shaders/blur-vertical.fragment.glsl", sf::Shader::Fragment);
+    Root().loadResources();
 
     // Initialize all the states
     Root().editor_state.init();
@@ -118,6 +101,7 @@ int main() {
         window.clear();
         Root().states.top()->draw(window);
         window.display();
+        Root().text.nextFrame();
     }
 
     return 0;
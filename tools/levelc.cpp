@@ -0,0 +1,83 @@
+#include <iostream>
+#include <vector>
+
+#include "Root.hpp"
+#include "Entity.hpp"
+#include "LevelFile.hpp"
+#include "LevelCompiler.hpp"
+#include "CollisionBake.hpp"
+
+// Compiles editor levels (.dat or .json) to the runtime format, next to the
+// source: bin/arachnonoia-levelc levels/spawn.dat -> levels/spawn.lvl
+// Levels that fail validation are not written. With --check nothing is
+// written at all. The hash of the source goes into the header, so the game
+// notices when the source was edited after compiling.
+int main(int argc, char** argv) {
+    std::vector<std::string> sources;
+    bool check = false;
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--check") {
+            check = true;
+        } else {
+            sources.push_back(arg);
+        }
+    }
+
+    if(sources.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--check] <level.dat|level.json> [...]" << std::endl;
+        return 1;
+    }
+
+    // entities pick their textures and sounds up in their constructors
+    Root().loadResources();
+
+    int failed = 0;
+    for(auto source : sources) {
+        std::string target = source.substr(0, source.find_last_of('.')) + ".lvl";
+
+        std::vector<std::shared_ptr<Entity>> entities;
+        if(!LevelFile::read(source, entities)) {
+            std::cerr << "Error: could not read " << source << "." << std::endl;
+            failed++;
+            continue;
+        }
+
+        LevelCompiler::Report report;
+        LevelCompiler::validate(source, entities, report);
+        LevelCompiler::optimize(entities, report);
+        if(report.errors > 0) {
+            failed++;
+            continue;
+        }
+        if(check) {
+            std::cout << source << " ok" << std::endl;
+            continue;
+        }
+
+        if(!LevelFile::write(target, entities, CollisionBake::hashFile(source))) {
+            failed++;
+            continue;
+        }
+
+        // read it back to make sure the runtime sees the same level
+        LevelFile file;
+        std::vector<std::shared_ptr<Entity>> compiled;
+        if(!file.open(target)) {
+            failed++;
+            continue;
+        }
+        file.createEntities(compiled);
+        if(compiled.size() != entities.size()) {
+            std::cerr << "Error: " << target << " holds " << compiled.size() << " of " << entities.size() << " entities." << std::endl;
+            failed++;
+            continue;
+        }
+
+        std::cout << source << " -> " << target << ": " << compiled.size() << " entities, "
+                  << report.mergedVertices << " collinear vertices merged, "
+                  << report.removedPolygons << " empty polygons and "
+                  << report.removedShapes << " empty shapes removed" << std::endl;
+    }
+    return failed > 0 ? 1 : 0;
+}